@@ -0,0 +1,234 @@
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
+#include <cstdint>
+
+#include <dearimgui/imgui.h>
+
+#include "allocation-tracker.h"
+
+namespace
+{
+    thread_local AllocationCounters threadCounters;
+    std::atomic<uint64_t> liveBytes{0};
+    // the most since the last frameStarted()
+    std::atomic<uint64_t> framePeakBytes{0};
+
+#ifdef ALLOCATION_TRACKING
+    // keeps the alignment that malloc() gives
+    const size_t headerSize = 16;
+
+    void *trackedAllocate(size_t size)
+    {
+        unsigned char *base = static_cast<unsigned char *>(std::malloc(size + headerSize));
+        if (base == NULL) { return NULL; }
+        *reinterpret_cast<size_t *>(base) = size;
+
+        threadCounters.allocations++;
+        threadCounters.bytes += size;
+        uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        uint64_t peak = framePeakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !framePeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        return base + headerSize;
+    }
+
+    void trackedFree(void *pointer)
+    {
+        if (pointer == NULL) { return; }
+
+        unsigned char *base = static_cast<unsigned char *>(pointer) - headerSize;
+        threadCounters.frees++;
+        liveBytes.fetch_sub(*reinterpret_cast<size_t *>(base), std::memory_order_relaxed);
+        std::free(base);
+    }
+
+    void *imguiAllocate(size_t size, void *)
+    {
+        threadCounters.imguiAllocations++;
+        threadCounters.imguiBytes += size;
+        return trackedAllocate(size);
+    }
+
+    void imguiFree(void *pointer, void *)
+    {
+        trackedFree(pointer);
+    }
+#endif
+}
+
+#ifdef ALLOCATION_TRACKING
+// all the forms that can be paired with each other have to be replaced,
+// otherwise something could be freed without the header or the other way around
+void *operator new(size_t size)
+{
+    void *pointer = trackedAllocate(size == 0 ? 1 : size);
+    if (pointer == NULL) { throw std::bad_alloc(); }
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, std::nothrow_t const &) noexcept
+{
+    return trackedAllocate(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, std::nothrow_t const &) noexcept
+{
+    return trackedAllocate(size == 0 ? 1 : size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void *pointer, std::nothrow_t const &) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::nothrow_t const &) noexcept
+{
+    trackedFree(pointer);
+}
+#endif
+
+bool allocationTrackingEnabled()
+{
+#ifdef ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationCounters const &threadAllocationCounters()
+{
+    return threadCounters;
+}
+
+uint64_t liveHeapBytes()
+{
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+void installImGuiAllocationTracking()
+{
+#ifdef ALLOCATION_TRACKING
+    ImGui::SetAllocatorFunctions(imguiAllocate, imguiFree, NULL);
+#endif
+}
+
+void AllocationTracker::frameStarted()
+{
+    AllocationCounters const &now = threadCounters;
+    uint64_t live = liveBytes.load(std::memory_order_relaxed);
+    if (started)
+    {
+        last.allocations = now.allocations - frameStart.allocations;
+        last.bytes = now.bytes - frameStart.bytes;
+        last.imguiAllocations = now.imguiAllocations - frameStart.imguiAllocations;
+        last.imguiBytes = now.imguiBytes - frameStart.imguiBytes;
+        last.peakLiveBytes = std::max(framePeakBytes.load(std::memory_order_relaxed), live);
+        peak = std::max(peak, last.peakLiveBytes);
+        cleanFrames = last.allocations == 0 ? cleanFrames + 1 : 0;
+    }
+    started = true;
+    frameStart = now;
+    framePeakBytes.store(live, std::memory_order_relaxed);
+}
+
+FrameArena::FrameArena(size_t initialCapacity)
+{
+    blocks.emplace_back();
+    blocks.back().data.resize(initialCapacity);
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    auto alignedOffset = [alignment](Block const &block)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.data.data()) + block.offset;
+        return block.offset + (alignment - address % alignment) % alignment;
+    };
+
+    Block *block = &blocks.back();
+    size_t offset = alignedOffset(*block);
+    if (offset + size > block->data.size())
+    {
+        // only until the next reset, which merges the blocks
+        size_t previousSize = block->data.size();
+        blocks.emplace_back();
+        block = &blocks.back();
+        block->data.resize(std::max(size + alignment, previousSize * 2));
+        offset = alignedOffset(*block);
+    }
+
+    usedBytes += offset - block->offset + size;
+    block->offset = offset + size;
+    return block->data.data() + offset;
+}
+
+const char *FrameArena::format(const char *format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    va_list measuring;
+    va_copy(measuring, arguments);
+    int length = std::vsnprintf(NULL, 0, format, measuring);
+    va_end(measuring);
+    if (length < 0)
+    {
+        va_end(arguments);
+        return "";
+    }
+
+    char *text = static_cast<char *>(allocate(static_cast<size_t>(length) + 1, 1));
+    std::vsnprintf(text, static_cast<size_t>(length) + 1, format, arguments);
+    va_end(arguments);
+    return text;
+}
+
+void FrameArena::reset()
+{
+    highWaterBytes = std::max(highWaterBytes, usedBytes);
+    if (blocks.size() > 1)
+    {
+        // one block that fits the whole frame next time
+        size_t total = capacity();
+        blocks.clear();
+        blocks.emplace_back();
+        blocks.back().data.resize(total);
+    }
+    blocks.back().offset = 0;
+    usedBytes = 0;
+}
+
+size_t FrameArena::capacity() const
+{
+    size_t total = 0;
+    for (Block const &block : blocks) { total += block.data.size(); }
+    return total;
+}
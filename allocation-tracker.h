@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Heap allocations are counted by replaced global operator new/delete
+// and by Dear ImGui allocator functions (built with ALLOCATION_TRACKING).
+// Every allocation gets a small header with its size, so frees are counted
+// in bytes as well and live/peak heap usage is known
+struct AllocationCounters
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;
+    // the part of the above that came from Dear ImGui
+    uint64_t imguiAllocations = 0;
+    uint64_t imguiBytes = 0;
+};
+
+bool allocationTrackingEnabled();
+// allocations of the calling thread, cheap to read (no atomics)
+AllocationCounters const &threadAllocationCounters();
+// all threads
+uint64_t liveHeapBytes();
+
+// has to be called before anything is allocated with IM_ALLOC,
+// including the shared font atlas, which exists before the context
+void installImGuiAllocationTracking();
+
+// allocations of one frame of the thread that calls frameStarted()
+struct FrameAllocationStatistics
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t imguiAllocations = 0;
+    uint64_t imguiBytes = 0;
+    // the most the heap had during the frame (all threads)
+    uint64_t peakLiveBytes = 0;
+};
+
+class AllocationTracker
+{
+public:
+    // the previous frame ends where the next one starts
+    void frameStarted();
+
+    FrameAllocationStatistics const &lastFrame() const { return last; }
+    // the most of any frame since the start
+    uint64_t peakLiveBytes() const { return peak; }
+    // frames in a row without a single heap allocation
+    uint64_t framesWithoutAllocations() const { return cleanFrames; }
+
+private:
+    bool started = false;
+    AllocationCounters frameStart;
+    FrameAllocationStatistics last;
+    uint64_t peak = 0;
+    uint64_t cleanFrames = 0;
+};
+
+// Bump allocator for data that only lives until the end of the frame
+// (formatted strings, temporary arrays). Resetting just rewinds it,
+// and once it has grown to what a frame needs, it doesn't touch the heap
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t initialCapacity = 64 * 1024);
+    FrameArena(FrameArena const &) = delete;
+    FrameArena &operator=(FrameArena const &) = delete;
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T *allocateArray(size_t count) { return static_cast<T *>(allocate(count * sizeof(T), alignof(T))); }
+    // printf into the arena, valid until reset()
+    const char *format(const char *format, ...);
+
+    // everything allocated since the previous reset is gone; if the frame
+    // didn't fit into one block, the blocks are merged into a bigger one
+    void reset();
+
+    size_t used() const { return usedBytes; }
+    size_t capacity() const;
+    // the most a frame has used
+    size_t highWater() const { return highWaterBytes; }
+
+private:
+    struct Block
+    {
+        std::vector<unsigned char> data;
+        size_t offset = 0;
+    };
+
+    std::vector<Block> blocks;
+    size_t usedBytes = 0;
+    size_t highWaterBytes = 0;
+};
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cstring>
+
+#include "batch-renderer.h"
+
+namespace
+{
+    const size_t initialVerticesCapacity = 64 * 1024,
+                 initialIndicesCapacity = 192 * 1024,
+                 initialInstancesCapacity = 1024;
+
+    // vertex attributes locations in the shader
+    const GLuint positionLocation = 0,
+                 instanceTransformLocation = 1,
+                 instanceColorLocation = 2;
+}
+
+bool BatchRenderer::initialize()
+{
+    multiDrawIndirect = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &instanceBuffer);
+
+    verticesCapacity = initialVerticesCapacity;
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, verticesCapacity * 3 * sizeof(float), NULL, GL_STATIC_DRAW);
+
+    indicesCapacity = initialIndicesCapacity;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, indicesCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    instancesCapacity = initialInstancesCapacity;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instancesCapacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (multiDrawIndirect)
+    {
+        glGenBuffers(1, &indirectBuffer);
+    }
+
+    instanceStream.initialize(GL_ARRAY_BUFFER, initialInstancesCapacity * sizeof(InstanceData));
+
+    setupVertexArray();
+    return true;
+}
+
+void BatchRenderer::shutdown()
+{
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    if (indirectBuffer != 0) { glDeleteBuffers(1, &indirectBuffer); }
+    instanceStream.shutdown();
+    vertexArray = vertexBuffer = indexBuffer = instanceBuffer = indirectBuffer = 0;
+    meshes.clear();
+}
+
+void BatchRenderer::setupVertexArray()
+{
+    glBindVertexArray(vertexArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(positionLocation);
+
+    glEnableVertexAttribArray(instanceTransformLocation);
+    glVertexAttribDivisor(instanceTransformLocation, 1);
+    glEnableVertexAttribArray(instanceColorLocation);
+    glVertexAttribDivisor(instanceColorLocation, 1);
+    setInstanceAttributes(instanceBuffer, 0);
+
+    // element buffer binding is a part of VAO state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// instance attributes point either to the static buffer or to the current
+// partition of the stream, and without base instance support they also
+// have to be pointed at the first instance of every draw
+void BatchRenderer::setInstanceAttributes(GLuint buffer, size_t offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(
+        instanceTransformLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        reinterpret_cast<void*>(offset + offsetof(InstanceData, offset))
+    );
+    glVertexAttribPointer(
+        instanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        reinterpret_cast<void*>(offset + offsetof(InstanceData, color))
+    );
+}
+
+void BatchRenderer::growBuffer(GLuint &buffer, size_t usedBytes, size_t newCapacityBytes)
+{
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacityBytes, NULL, GL_STATIC_DRAW);
+    if (usedBytes > 0)
+    {
+        // copying happens on GPU, there are no CPU-side copies of the meshes
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = newBuffer;
+}
+
+int BatchRenderer::addMesh(const float *positions, size_t verticesCount, const uint32_t *indices, size_t indicesCount)
+{
+    int mesh = reserveMesh(verticesCount, indicesCount);
+    if (mesh < 0) { return -1; }
+    uploadMeshVertices(mesh, 0, positions, verticesCount);
+    uploadMeshIndices(mesh, 0, indices, indicesCount);
+    completeMesh(mesh);
+    return mesh;
+}
+
+int BatchRenderer::reserveMesh(size_t verticesCount, size_t indicesCount)
+{
+    if (verticesCount == 0 || indicesCount == 0) { return -1; }
+
+    bool buffersChanged = false;
+    if (verticesUsed + verticesCount > verticesCapacity)
+    {
+        size_t newCapacity = std::max(verticesCapacity * 2, verticesUsed + verticesCount);
+        growBuffer(vertexBuffer, verticesUsed * 3 * sizeof(float), newCapacity * 3 * sizeof(float));
+        verticesCapacity = newCapacity;
+        buffersChanged = true;
+    }
+    if (indicesUsed + indicesCount > indicesCapacity)
+    {
+        size_t newCapacity = std::max(indicesCapacity * 2, indicesUsed + indicesCount);
+        growBuffer(indexBuffer, indicesUsed * sizeof(uint32_t), newCapacity * sizeof(uint32_t));
+        indicesCapacity = newCapacity;
+        buffersChanged = true;
+    }
+    if (buffersChanged) { setupVertexArray(); }
+
+    // indices stay relative to the mesh, base vertex takes care of the rest
+    Mesh mesh;
+    mesh.firstIndex = static_cast<GLuint>(indicesUsed);
+    mesh.baseVertex = static_cast<GLint>(verticesUsed);
+    mesh.reservedVertices = static_cast<GLuint>(verticesCount);
+    mesh.reservedIndices = static_cast<GLuint>(indicesCount);
+    meshes.push_back(mesh);
+
+    verticesUsed += verticesCount;
+    indicesUsed += indicesCount;
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+void BatchRenderer::uploadMeshVertices(int mesh, size_t firstVertex, const float *positions, size_t verticesCount)
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) { return; }
+    Mesh const &target = meshes[mesh];
+    if (verticesCount == 0 || firstVertex + verticesCount > target.reservedVertices) { return; }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(
+        GL_COPY_WRITE_BUFFER,
+        (target.baseVertex + firstVertex) * 3 * sizeof(float),
+        verticesCount * 3 * sizeof(float),
+        positions
+    );
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void BatchRenderer::uploadMeshIndices(int mesh, size_t firstIndex, const uint32_t *indices, size_t indicesCount)
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) { return; }
+    Mesh const &target = meshes[mesh];
+    if (indicesCount == 0 || firstIndex + indicesCount > target.reservedIndices) { return; }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(
+        GL_COPY_WRITE_BUFFER,
+        (target.firstIndex + firstIndex) * sizeof(uint32_t),
+        indicesCount * sizeof(uint32_t),
+        indices
+    );
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void BatchRenderer::completeMesh(int mesh)
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) { return; }
+    meshes[mesh].indicesCount = meshes[mesh].reservedIndices;
+    instancesDirty = true;
+}
+
+size_t BatchRenderer::meshIndicesCount(int mesh) const
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) { return 0; }
+    return meshes[mesh].indicesCount;
+}
+
+void BatchRenderer::setStreamInstances(bool stream)
+{
+    if (stream == streamInstances) { return; }
+    streamInstances = stream;
+    instancesDirty = true;
+}
+
+void BatchRenderer::clearInstances()
+{
+    for (Mesh &mesh : meshes) { mesh.instances.clear(); }
+    instancesDirty = true;
+}
+
+void BatchRenderer::addInstance(int mesh, InstanceData const &instance)
+{
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) { return; }
+    meshes[mesh].instances.push_back(instance);
+    instancesDirty = true;
+}
+
+size_t BatchRenderer::instancesCount() const
+{
+    size_t count = 0;
+    for (Mesh const &mesh : meshes) { count += mesh.instances.size(); }
+    return count;
+}
+
+// instances of the same mesh have to be next to each other,
+// so every mesh is one indirect command
+void BatchRenderer::buildCommands()
+{
+    commands.clear();
+    lastStatistics = BatchStatistics();
+    lastStatistics.meshes = static_cast<int>(meshes.size());
+
+    GLuint instancesTotal = 0;
+    for (Mesh const &mesh : meshes)
+    {
+        if (mesh.instances.empty() || mesh.indicesCount == 0) { continue; }
+
+        DrawElementsIndirectCommand command;
+        command.count = mesh.indicesCount;
+        command.instanceCount = static_cast<GLuint>(mesh.instances.size());
+        command.firstIndex = mesh.firstIndex;
+        command.baseVertex = mesh.baseVertex;
+        command.baseInstance = instancesTotal;
+        commands.push_back(command);
+
+        instancesTotal += command.instanceCount;
+        lastStatistics.triangles += static_cast<size_t>(mesh.indicesCount / 3) * mesh.instances.size();
+    }
+    lastStatistics.instances = instancesTotal;
+
+    if (multiDrawIndirect && !commands.empty())
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        if (commands.size() > indirectCapacity)
+        {
+            indirectCapacity = commands.size();
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
+void BatchRenderer::uploadStaticInstances()
+{
+    packedInstances.clear();
+    for (Mesh const &mesh : meshes)
+    {
+        // the same meshes as in the commands, so base instances match
+        if (mesh.indicesCount == 0) { continue; }
+        packedInstances.insert(packedInstances.end(), mesh.instances.begin(), mesh.instances.end());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (packedInstances.size() > instancesCapacity)
+    {
+        instancesCapacity = std::max(instancesCapacity * 2, packedInstances.size());
+        glBufferData(GL_ARRAY_BUFFER, instancesCapacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+    }
+    if (!packedInstances.empty())
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, packedInstances.size() * sizeof(InstanceData), packedInstances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// instances go straight from the meshes into the mapped partition,
+// without packing them anywhere first
+bool BatchRenderer::streamInstancesData()
+{
+    size_t size = lastStatistics.instances * sizeof(InstanceData);
+    char *destination = static_cast<char *>(instanceStream.beginWrite(size));
+    if (destination == NULL) { return false; }
+
+    size_t written = 0;
+    for (Mesh const &mesh : meshes)
+    {
+        if (mesh.instances.empty() || mesh.indicesCount == 0) { continue; }
+        size_t meshBytes = mesh.instances.size() * sizeof(InstanceData);
+        std::memcpy(destination + written, mesh.instances.data(), meshBytes);
+        written += meshBytes;
+    }
+    instanceStream.endWrite(written);
+    return true;
+}
+
+void BatchRenderer::draw()
+{
+    if (instancesDirty)
+    {
+        buildCommands();
+        // static instances are uploaded once, until they change
+        if (!streamInstances) { uploadStaticInstances(); }
+        instancesDirty = false;
+    }
+    if (commands.empty())
+    {
+        lastStatistics.drawCalls = 0;
+        return;
+    }
+
+    // attributes are pointed to the base of the buffer or of the partition,
+    // base instance of every command is relative to that
+    GLuint instancesSource = instanceBuffer;
+    size_t instancesOffset = 0;
+    if (streamInstances)
+    {
+        // the partition holds instances of some older frame, drawing from it
+        // would put the meshes in the wrong places, so skip the frame instead
+        if (!streamInstancesData())
+        {
+            lastStatistics.drawCalls = 0;
+            return;
+        }
+        instancesSource = instanceStream.buffer();
+        instancesOffset = instanceStream.offset();
+    }
+
+    glBindVertexArray(vertexArray);
+    setInstanceAttributes(instancesSource, instancesOffset);
+    if (multiDrawIndirect)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            (void*)0,
+            static_cast<GLsizei>(commands.size()),
+            0
+        );
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        lastStatistics.drawCalls = 1;
+    }
+    else
+    {
+        for (DrawElementsIndirectCommand const &command : commands)
+        {
+            setInstanceAttributes(instancesSource, instancesOffset + command.baseInstance * sizeof(InstanceData));
+            glDrawElementsInstancedBaseVertex(
+                GL_TRIANGLES,
+                command.count,
+                GL_UNSIGNED_INT,
+                reinterpret_cast<void*>(command.firstIndex * sizeof(uint32_t)),
+                command.instanceCount,
+                command.baseVertex
+            );
+        }
+        lastStatistics.drawCalls = static_cast<int>(commands.size());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    if (streamInstances) { instanceStream.fence(); }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "stream-buffer.h"
+
+// per-instance attributes, layout matches the instance attributes in the vertex shader
+struct InstanceData
+{
+    float offset[2] = { 0.0f, 0.0f };
+    float scale = 1.0f;
+    float rotation = 0.0f; // radians
+    float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+struct BatchStatistics
+{
+    int meshes = 0;
+    size_t instances = 0;
+    size_t triangles = 0;
+    int drawCalls = 0;
+};
+
+// Packs many meshes into shared vertex and index buffers and their instances
+// into one per-instance attributes buffer, so the whole batch is submitted
+// with a single glMultiDrawElementsIndirect() (core in GL 4.3). On older
+// contexts (macOS has only 4.1) it falls back to one instanced draw per mesh.
+// Instances which change every frame are streamed through a StreamBuffer
+class BatchRenderer
+{
+public:
+    bool initialize();
+    void shutdown();
+
+    // positions are 3 floats per vertex, returns mesh index or -1
+    int addMesh(const float *positions, size_t verticesCount, const uint32_t *indices, size_t indicesCount);
+    size_t meshIndicesCount(int mesh) const;
+
+    // a mesh can also be uploaded in parts over several frames: it takes
+    // space in the buffers right away, but isn't drawn until it's completed
+    int reserveMesh(size_t verticesCount, size_t indicesCount);
+    // offsets and counts are in vertices and indices of the mesh
+    void uploadMeshVertices(int mesh, size_t firstVertex, const float *positions, size_t verticesCount);
+    void uploadMeshIndices(int mesh, size_t firstIndex, const uint32_t *indices, size_t indicesCount);
+    void completeMesh(int mesh);
+
+    void clearInstances();
+    void addInstance(int mesh, InstanceData const &instance);
+    size_t instancesCount() const;
+    // for updating instances in place, amount of instances should not change
+    std::vector<InstanceData> &meshInstances(int mesh) { return meshes[mesh].instances; }
+    // static instances have to be uploaded again after updating them in place,
+    // streamed ones are written every frame anyway
+    void instancesUpdated() { if (!streamInstances) { instancesDirty = true; } }
+
+    // if instances change every frame, they are written straight into
+    // a mapped partition of the stream buffer instead of being re-uploaded
+    void setStreamInstances(bool stream);
+    bool streamingInstances() const { return streamInstances; }
+    StreamBuffer const &instancesStream() const { return instanceStream; }
+
+    // uploads instances (only if they've changed) and draws everything,
+    // the shader program has to be already in use
+    void draw();
+
+    BatchStatistics const &statistics() const { return lastStatistics; }
+    bool usingMultiDrawIndirect() const { return multiDrawIndirect; }
+
+private:
+    // matches GL spec layout of indirect elements commands
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct Mesh
+    {
+        GLuint firstIndex = 0;
+        GLuint indicesCount = 0;
+        GLint baseVertex = 0;
+        // what is taken in the buffers, indicesCount stays 0 until the mesh is completed
+        GLuint reservedVertices = 0;
+        GLuint reservedIndices = 0;
+        std::vector<InstanceData> instances;
+    };
+
+    bool multiDrawIndirect = false;
+    GLuint vertexArray = 0,
+           vertexBuffer = 0,
+           indexBuffer = 0,
+           instanceBuffer = 0,
+           indirectBuffer = 0;
+    // in elements, not bytes
+    size_t verticesCapacity = 0,
+           verticesUsed = 0,
+           indicesCapacity = 0,
+           indicesUsed = 0,
+           instancesCapacity = 0;
+    size_t indirectCapacity = 0;
+    std::vector<Mesh> meshes;
+    std::vector<InstanceData> packedInstances;
+    std::vector<DrawElementsIndirectCommand> commands;
+    bool instancesDirty = true;
+    BatchStatistics lastStatistics;
+
+    void setupVertexArray();
+    bool streamInstances = false;
+    StreamBuffer instanceStream;
+
+    void setInstanceAttributes(GLuint buffer, size_t firstInstanceOffset);
+    void buildCommands();
+    // false if the partition couldn't be mapped, then there is nothing to draw from
+    bool streamInstancesData();
+    // grows a buffer keeping its contents
+    void growBuffer(GLuint &buffer, size_t usedBytes, size_t newCapacityBytes);
+    void uploadStaticInstances();
+};
@@ -0,0 +1,303 @@
+// Microbenchmarks of the utility functions and of composing the UI.
+// Dear ImGui runs without any backends and with a made up display size,
+// so there is no window or GL context and it runs on any machine
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+#include <dearimgui/imgui.h>
+
+#include "functions.h"
+#include "benchmark.h"
+#include "time-series.h"
+#include "allocation-tracker.h"
+#include "list-view.h"
+#include "controls.h"
+
+namespace
+{
+    // results go here, so the compiler can't throw the calls away
+    volatile size_t sink = 0;
+
+    struct BenchOptions
+    {
+        // only benchmarks with names that contain it
+        std::string filter = "";
+        // how long every benchmark is measured
+        double seconds = 0.5;
+        std::string output = "";
+    };
+
+    struct BenchResult
+    {
+        std::string name;
+        uint64_t operations = 0;
+        // nanoseconds per operation of every batch
+        std::vector<double> batchNanoseconds;
+        double allocationsPerOperation = 0.0;
+        double bytesPerOperation = 0.0;
+    };
+
+    // Calls operation() in batches that take at least a few dozen microseconds,
+    // so the clock doesn't add much to cheap operations, and reports per-batch
+    // nanoseconds per operation (percentiles show how stable it is)
+    template<typename Operation>
+    BenchResult runBench(std::string const &name, double seconds, Operation operation)
+    {
+        using Clock = std::chrono::steady_clock;
+        const double minimumBatchNanoseconds = 50000.0;
+        const size_t minimumBatches = 20;
+
+        BenchResult result;
+        result.name = name;
+
+        // batch size doubles until a batch is long enough, which also warms up
+        uint64_t batchSize = 1;
+        while (true)
+        {
+            auto start = Clock::now();
+            for (uint64_t i = 0; i < batchSize; i++) { operation(); }
+            double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            if (nanoseconds >= minimumBatchNanoseconds || batchSize >= (1u << 24)) { break; }
+            batchSize *= 2;
+        }
+
+        // only the measuring thread, the logger could be allocating at the same time
+        AllocationCounters before = threadAllocationCounters();
+        auto started = Clock::now();
+        while (
+            result.batchNanoseconds.size() < minimumBatches
+            || std::chrono::duration<double>(Clock::now() - started).count() < seconds
+        )
+        {
+            auto start = Clock::now();
+            for (uint64_t i = 0; i < batchSize; i++) { operation(); }
+            double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            result.batchNanoseconds.push_back(nanoseconds / batchSize);
+            result.operations += batchSize;
+        }
+        AllocationCounters const &after = threadAllocationCounters();
+        result.allocationsPerOperation = static_cast<double>(after.allocations - before.allocations) / result.operations;
+        result.bytesPerOperation = static_cast<double>(after.bytes - before.bytes) / result.operations;
+        return result;
+    }
+
+    std::string resultJSON(BenchResult const &result)
+    {
+        std::vector<double> sorted = result.batchNanoseconds;
+        std::sort(sorted.begin(), sorted.end());
+        TimingStatistics statistics = calculateTimingStatistics(sorted);
+
+        std::ostringstream json;
+        json << "{\"name\": \"" << jsonEscape(result.name) << "\""
+             << ", \"operations\": " << result.operations
+             << ", \"batches\": " << statistics.count
+             << ", \"ns_per_op\": " << statistics.median
+             << ", \"ns_per_op_p90\": " << percentile(sorted, 90.0)
+             << ", \"ns_per_op_p99\": " << statistics.p99
+             << ", \"ns_per_op_all\": " << timingStatisticsJSON(statistics)
+             << ", \"allocs_per_op\": " << result.allocationsPerOperation
+             << ", \"bytes_per_op\": " << result.bytesPerOperation
+             << "}";
+        return json.str();
+    }
+
+    std::vector<std::string> generateItems(size_t count)
+    {
+        const char *folders[] = { "textures", "models", "sounds", "shaders", "levels" };
+        const char *extensions[] = { "png", "obj", "wav", "glsl", "json" };
+        std::vector<std::string> items;
+        items.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            std::ostringstream item;
+            item << folders[i % 5] << "/asset-" << i << "." << extensions[(i / 5) % 5];
+            items.push_back(item.str());
+        }
+        return items;
+    }
+
+    // what the application would show, so the windows have the same widgets
+    ControlsStatistics benchControlsStatistics()
+    {
+        ControlsStatistics statistics;
+        ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+        statistics.windowWidth = static_cast<int>(displaySize.x);
+        statistics.windowHeight = static_cast<int>(displaySize.y);
+        statistics.glfwVersion = "none, the bench has no window";
+        statistics.renderedFrames = 1000;
+        statistics.skippedFrames = 100;
+        statistics.inputLatency.median = 8.3;
+        statistics.inputLatency.p99 = 16.6;
+        statistics.inputLatency.max = 33.3;
+        statistics.allocationTracking = allocationTrackingEnabled();
+        statistics.instancesMax = 2000000;
+        statistics.scene.batch.triangles = 12000;
+        statistics.scene.batch.drawCalls = 1;
+        return statistics;
+    }
+
+    // the same frame that the application composes, from NewFrame() to Render()
+    void composeBenchFrame(ControlsState &state, ControlsStatistics const &statistics, FrameArena &arena)
+    {
+        static const ControlsHooks hooks;
+        arena.reset();
+        ImGui::NewFrame();
+        composeControls(state, statistics, hooks, arena);
+        ImGui::Render();
+        sink += static_cast<size_t>(ImGui::GetDrawData()->TotalVtxCount);
+    }
+
+    bool parseBenchOptions(int argc, char *argv[], BenchOptions &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (argument == "--filter" && hasValue)
+            {
+                options.filter = argv[++i];
+            }
+            else if (argument == "--seconds" && hasValue)
+            {
+                options.seconds = std::atof(argv[++i]);
+            }
+            else if (argument == "--output" && hasValue)
+            {
+                options.output = argv[++i];
+            }
+            else
+            {
+                std::cout << "Usage: " << argv[0] << " [options]\n\n"
+                          << "  --filter TEXT    only run benchmarks with TEXT in their names\n"
+                          << "  --seconds S      measure every benchmark for S seconds (default: 0.5)\n"
+                          << "  --output PATH    save JSON report to PATH instead of stdout\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    installImGuiAllocationTracking();
+
+    BenchOptions options;
+    if (!parseBenchOptions(argc, argv, options)) { return EXIT_FAILURE; }
+
+    std::vector<BenchResult> results;
+    auto bench = [&options, &results](std::string const &name, auto operation)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) { return; }
+        results.push_back(runBench(name, options.seconds, operation));
+        BenchResult const &result = results.back();
+        std::vector<double> sorted = result.batchNanoseconds;
+        std::sort(sorted.begin(), sorted.end());
+        std::cerr << name << ": " << percentile(sorted, 50.0) << " ns/op (p99 " << percentile(sorted, 99.0)
+                  << "), " << result.allocationsPerOperation << " allocs/op" << std::endl;
+    };
+
+    // functions.cpp
+    bench("currentTime/milliseconds", []() { sink += currentTime(std::chrono::system_clock::now(), true).size(); });
+    bench("currentTime/seconds", []() { sink += currentTime(std::chrono::system_clock::now(), false).size(); });
+    {
+        TimestampFormatter formatter;
+        char buffer[timestampMaxLength];
+        bench(
+            "TimestampFormatter/format",
+            [&formatter, &buffer]() { sink += formatter.format(std::chrono::system_clock::now(), true, buffer); }
+        );
+    }
+    {
+        std::string fileName = "JetBrainsMono-ExtraLight.ttf",
+                    matching = ".ttf",
+                    different = ".otf",
+                    longer = std::string(64, 'x') + fileName;
+        bench("endsWith/match", [&fileName, &matching]() { sink += endsWith(fileName, matching); });
+        bench("endsWith/mismatch", [&fileName, &different]() { sink += endsWith(fileName, different); });
+        bench("endsWith/ending-longer", [&fileName, &longer]() { sink += endsWith(fileName, longer); });
+    }
+
+    // random indices, so bigger lists show cache misses
+    for (size_t count : { size_t(100), size_t(10000), size_t(1000000) })
+    {
+        std::vector<std::string> items = generateItems(count);
+        uint32_t index = 12345;
+        bench(
+            "vector_getter/" + std::to_string(count),
+            [&items, &index, count]()
+            {
+                index = index * 1664525u + 1013904223u;
+                const char *text = NULL;
+                if (vector_getter(&items, static_cast<int>(index % count), &text)) { sink += static_cast<size_t>(text[0]); }
+            }
+        );
+    }
+
+    // Dear ImGui without backends
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = NULL;
+    io.DisplaySize = ImVec2(1200.0f, 800.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+#if IMGUI_VERSION_NUM >= 19200
+    // glyphs are rasterized on demand, nobody uploads them anyway
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+#else
+    unsigned char *pixels = NULL;
+    int width = 0,
+        height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+#endif
+    {
+        ControlsState state;
+        state.showCustomWindow = true;
+        state.instances = 1000;
+        state.frameTimeGraph = true;
+        ControlsStatistics statistics = benchControlsStatistics();
+        FrameArena arena;
+        auto compose = [&state, &statistics, &arena]() { composeBenchFrame(state, statistics, arena); };
+        bench("ui/controls", compose);
+        state.showDemoWindow = true;
+        bench("ui/controls+demo", compose);
+        state.showDemoWindow = false;
+
+        std::vector<std::string> items = generateItems(1000000);
+        ListView listView(vector_getter, &items);
+        listView.setItemsCount(static_cast<int>(items.size()));
+        // the index is built in the background, it would only add noise
+        while (listView.indexedItems() < static_cast<int>(items.size()))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        state.listView = &listView;
+        state.listViewItems = &items;
+        state.showListView = true;
+        bench("ui/controls+list-1000000", compose);
+        state.showListView = false;
+        state.listView = NULL;
+    }
+    ImGui::DestroyContext();
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"imgui_version\": \"" << IMGUI_VERSION << "\",\n"
+           << "  \"seconds_per_benchmark\": " << options.seconds << ",\n"
+           << "  \"benchmarks\": [\n";
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        report << (r == 0 ? "" : ",\n") << "    " << resultJSON(results[r]);
+    }
+    report << "\n  ]\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), options.output) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,547 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+#include <thread>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <atomic>
+#include <limits>
+
+#include "benchmark.h"
+#include "logger.h"
+#include "font-cache.h"
+#include "time-series.h"
+#include "mesh-data.h"
+
+std::vector<double> runFrameLoop(
+    std::function<void()> const &renderFrame,
+    int warmupFrames,
+    int frames,
+    double seconds
+)
+{
+    for (int i = 0; i < warmupFrames; i++) { renderFrame(); }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(frames > 0 ? frames : 1024);
+
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        if (frames > 0 && static_cast<int>(frameTimes.size()) >= frames) { break; }
+        if (seconds > 0.0
+            && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds)
+        {
+            break;
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        renderFrame();
+        frameTimes.push_back(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count()
+        );
+    }
+    return frameTimes;
+}
+
+std::vector<double> measureOperation(
+    std::function<void()> const &operation,
+    int iterations,
+    int burstSize,
+    std::function<void()> const &betweenBursts
+)
+{
+    std::vector<double> durations;
+    durations.reserve(iterations);
+    for (int i = 0; i < iterations; i++)
+    {
+        if (i > 0 && i % burstSize == 0 && betweenBursts) { betweenBursts(); }
+
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        durations.push_back(
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+        );
+    }
+    return durations;
+}
+
+std::string jsonEscape(std::string const &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) >= 0x20) { escaped += c; }
+            break;
+        }
+    }
+    return escaped;
+}
+
+std::string timingStatisticsJSON(TimingStatistics const &statistics)
+{
+    std::ostringstream json;
+    json << "{"
+         << "\"min\": " << statistics.min
+         << ", \"median\": " << statistics.median
+         << ", \"p99\": " << statistics.p99
+         << ", \"max\": " << statistics.max
+         << ", \"mean\": " << statistics.mean
+         << "}";
+    return json.str();
+}
+
+std::string frameTimeStatisticsJSON(TimingStatistics const &statistics)
+{
+    std::ostringstream json;
+    json << "\"frames\": " << statistics.count << ",\n"
+         << "  \"total_seconds\": " << statistics.total / 1000.0 << ",\n"
+         << "  \"frame_time_ms\": " << timingStatisticsJSON(statistics);
+    return json.str();
+}
+
+bool writeBenchmarkReport(std::string const &report, std::string const &outputPath)
+{
+    if (outputPath.empty())
+    {
+        std::cout << report << std::endl;
+        return true;
+    }
+
+    std::ofstream output(outputPath);
+    if (!output)
+    {
+        logError("Couldn't open %s for writing", outputPath.c_str());
+        return false;
+    }
+    output << report << std::endl;
+    logInfo("Benchmark report saved to %s", outputPath.c_str());
+    return true;
+}
+
+namespace
+{
+    // how currentTime() used to be implemented: a new stream and two localtime() calls
+    std::string legacyCurrentTime(std::chrono::time_point<std::chrono::system_clock> now)
+    {
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch()
+            ) % 1000;
+        auto timeNow = std::chrono::system_clock::to_time_t(now);
+
+        std::ostringstream currentTimeStream;
+        currentTimeStream << std::put_time(localtime(&timeNow), "%d.%m.%Y %H:%M:%S")
+                          << "." << std::setfill('0') << std::setw(3) << milliseconds.count()
+                          << " " << std::put_time(localtime(&timeNow), "%z");
+        return currentTimeStream.str();
+    }
+}
+
+bool runLoggerBenchmark(std::string const &outputPath)
+{
+    const int iterations = 50000;
+    // a burst is a frame with lots of logging, the pause lets the writer thread catch up
+    const int burstSize = 256;
+    const std::string logPath = "logger-benchmark.log";
+    auto pause = []() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); };
+
+    logInfo("Benchmarking logging, %d messages to %s", iterations, logPath.c_str());
+
+    std::vector<double> legacyDurations;
+    auto legacyStart = std::chrono::steady_clock::now();
+    {
+        std::ofstream legacyOutput(logPath);
+        legacyDurations = measureOperation(
+            [&legacyOutput]()
+            {
+                legacyOutput << "[" << legacyCurrentTime(std::chrono::system_clock::now()) << "] "
+                             << "counter button clicked" << std::endl;
+            },
+            iterations,
+            burstSize,
+            pause
+        );
+    }
+    double legacyTotalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - legacyStart
+    ).count();
+
+    std::vector<double> asyncDurations;
+    auto asyncStart = std::chrono::steady_clock::now();
+    uint64_t dropped = 0;
+    {
+        FILE *asyncOutput = std::fopen(logPath.c_str(), "w");
+        if (asyncOutput == NULL)
+        {
+            logError("Couldn't open %s for writing", logPath.c_str());
+            return false;
+        }
+        startLogger(asyncOutput);
+        asyncDurations = measureOperation(
+            []() { logInfo("counter button clicked"); },
+            iterations,
+            burstSize,
+            pause
+        );
+        dropped = droppedLogMessages();
+        // total time includes writing out whatever is left
+        stopLogger();
+        std::fclose(asyncOutput);
+    }
+    double asyncTotalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - asyncStart
+    ).count();
+
+    std::remove(logPath.c_str());
+
+    TimingStatistics legacy = calculateTimingStatistics(legacyDurations);
+    TimingStatistics async = calculateTimingStatistics(asyncDurations);
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"benchmark\": \"logger\",\n"
+           << "  \"messages\": " << iterations << ",\n"
+           << "  \"burst_size\": " << burstSize << ",\n"
+           << "  \"legacy_ostream_endl\": {\"call_ns\": " << timingStatisticsJSON(legacy)
+           << ", \"total_ms\": " << legacyTotalMs << "},\n"
+           << "  \"async_ring\": {\"call_ns\": " << timingStatisticsJSON(async)
+           << ", \"total_ms\": " << asyncTotalMs << ", \"dropped\": " << dropped << "},\n"
+           << "  \"median_speedup\": " << (async.median > 0.0 ? legacy.median / async.median : 0.0) << "\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), outputPath);
+}
+
+bool runFontAtlasBenchmark(std::string const &fontPath, std::string const &outputPath)
+{
+    const int iterations = 10;
+    const float fontSize = 24.0f;
+    const std::string cacheDirectory = "font-atlas-benchmark-cache";
+
+    logInfo("Benchmarking font atlas building, %d times each", iterations);
+
+    // every iteration is a fresh atlas, as on startup
+    auto buildAtlas = [&](std::string const &directory, bool &fromCache)
+    {
+        FontAtlasCache cache;
+        cache.setDirectory(directory);
+        ImFontAtlas *atlas = IM_NEW(ImFontAtlas)();
+        ImFont *font = cache.addFont(atlas, fontPath, fontSize, 1.0f);
+        fromCache = cache.loadedFromCache();
+        cache.release(atlas);
+        IM_DELETE(atlas);
+        return font != NULL;
+    };
+
+    bool built = true,
+         fromCache = false;
+    std::vector<double> coldDurations = measureOperation(
+        [&]() { built = buildAtlas("", fromCache) && built; },
+        iterations,
+        iterations,
+        nullptr
+    );
+
+    std::error_code error;
+    std::filesystem::remove_all(cacheDirectory, error);
+    // fills the cache
+    built = buildAtlas(cacheDirectory, fromCache) && built;
+    bool allFromCache = true;
+    std::vector<double> cachedDurations = measureOperation(
+        [&]() { built = buildAtlas(cacheDirectory, fromCache) && built; allFromCache = allFromCache && fromCache; },
+        iterations,
+        iterations,
+        nullptr
+    );
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    if (!built)
+    {
+        logError("Couldn't build the font atlas from %s", fontPath.c_str());
+        return false;
+    }
+
+    for (auto &duration : coldDurations) { duration /= 1000000.0; }
+    for (auto &duration : cachedDurations) { duration /= 1000000.0; }
+    TimingStatistics cold = calculateTimingStatistics(coldDurations);
+    TimingStatistics cached = calculateTimingStatistics(cachedDurations);
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"benchmark\": \"font-atlas\",\n"
+           << "  \"font\": \"" << jsonEscape(std::filesystem::path(fontPath).filename().string()) << "\",\n"
+           << "  \"size_pixels\": " << fontSize << ",\n"
+           << "  \"iterations\": " << iterations << ",\n"
+           << "  \"cold_rasterize_ms\": " << timingStatisticsJSON(cold) << ",\n"
+           << "  \"cached_mmap_ms\": " << timingStatisticsJSON(cached) << ",\n"
+           << "  \"all_cached_loads_hit\": " << (allFromCache ? "true" : "false") << ",\n"
+           << "  \"median_speedup\": " << (cached.median > 0.0 ? cold.median / cached.median : 0.0) << "\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), outputPath);
+}
+
+bool runTimeSeriesBenchmark(std::string const &outputPath)
+{
+    const int samplesPerProducer = 4000000;
+    const int columns = 1920;
+    const int iterations = 20;
+
+    logInfo("Benchmarking time series ingestion and decimation");
+
+    // producers push as fast as they can, the consumer drains into the pyramid meanwhile
+    std::ostringstream ingestion;
+    for (int producers : { 1, 2, 4 })
+    {
+        TimeSeries series(1 << 20, static_cast<size_t>(samplesPerProducer) * producers);
+        std::atomic<bool> producing{true};
+        std::thread consumer([&]()
+        {
+            while (producing) { series.update(); }
+            series.update();
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&series, p]()
+            {
+                for (int i = 0; i < samplesPerProducer; i++) { series.push(static_cast<float>(i + p)); }
+            });
+        }
+        for (auto &thread : threads) { thread.join(); }
+        double pushSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        producing = false;
+        consumer.join();
+
+        double pushed = static_cast<double>(samplesPerProducer) * producers;
+        ingestion << (producers == 1 ? "" : ",\n")
+                  << "    {\"producers\": " << producers
+                  << ", \"samples\": " << static_cast<uint64_t>(pushed)
+                  << ", \"push_msamples_per_second\": " << pushed / pushSeconds / 1000000.0
+                  << ", \"received\": " << series.totalSamples()
+                  << ", \"dropped\": " << series.dropped() << "}";
+    }
+
+    // plotting cost: min/max of every column through the pyramid against going through all the samples
+    std::ostringstream decimation;
+    std::vector<float> mins(columns),
+                       maxs(columns);
+    size_t sampleCount = 1000;
+    for (int step = 0; step < 5; step++, sampleCount *= 10)
+    {
+        std::vector<float> samples(sampleCount);
+        for (size_t i = 0; i < sampleCount; i++) { samples[i] = std::sin(i * 0.001f) + (i % 7) * 0.01f; }
+
+        MinMaxPyramid pyramid;
+        auto start = std::chrono::steady_clock::now();
+        pyramid.append(samples.data(), samples.size());
+        double buildMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+
+        std::vector<double> pyramidDurations = measureOperation(
+            [&]() { pyramid.decimate(0.0, static_cast<double>(sampleCount), columns, mins.data(), maxs.data()); },
+            iterations,
+            iterations,
+            nullptr
+        );
+        std::vector<double> scanDurations = measureOperation(
+            [&]()
+            {
+                for (int c = 0; c < columns; c++)
+                {
+                    size_t from = sampleCount * c / columns,
+                           to = std::max(from + 1, sampleCount * (c + 1) / columns);
+                    float min = std::numeric_limits<float>::max(),
+                          max = std::numeric_limits<float>::lowest();
+                    for (size_t i = from; i < to; i++)
+                    {
+                        min = std::min(min, samples[i]);
+                        max = std::max(max, samples[i]);
+                    }
+                    mins[c] = min;
+                    maxs[c] = max;
+                }
+            },
+            iterations,
+            iterations,
+            nullptr
+        );
+        for (auto &duration : pyramidDurations) { duration /= 1000000.0; }
+        for (auto &duration : scanDurations) { duration /= 1000000.0; }
+        TimingStatistics pyramidTime = calculateTimingStatistics(pyramidDurations);
+        TimingStatistics scanTime = calculateTimingStatistics(scanDurations);
+
+        decimation << (step == 0 ? "" : ",\n")
+                   << "    {\"samples\": " << sampleCount
+                   << ", \"build_ms\": " << buildMilliseconds
+                   << ", \"pyramid_ms\": " << timingStatisticsJSON(pyramidTime)
+                   << ", \"full_scan_ms\": " << timingStatisticsJSON(scanTime)
+                   << ", \"vertices\": " << columns * 2 << "}";
+    }
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"benchmark\": \"time-series\",\n"
+           << "  \"columns\": " << columns << ",\n"
+           << "  \"ingestion\": [\n" << ingestion.str() << "\n  ],\n"
+           << "  \"decimation\": [\n" << decimation.str() << "\n  ]\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), outputPath);
+}
+
+namespace
+{
+    // a wavy surface of quads, written the way exporters usually write it
+    bool generateObj(std::string const &path, int gridSize)
+    {
+        FILE *file = std::fopen(path.c_str(), "w");
+        if (file == NULL) { return false; }
+        std::fprintf(file, "# generated by the mesh-loading benchmark\no surface\n");
+        for (int y = 0; y < gridSize; y++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                float u = static_cast<float>(x) / (gridSize - 1),
+                      v = static_cast<float>(y) / (gridSize - 1);
+                std::fprintf(file, "v %.6f %.6f %.6f\n", u - 0.5f, v - 0.5f, 0.05f * std::sin(u * 40.0f) * std::cos(v * 30.0f));
+            }
+        }
+        for (int y = 0; y + 1 < gridSize; y++)
+        {
+            for (int x = 0; x + 1 < gridSize; x++)
+            {
+                int corner = y * gridSize + x + 1;
+                std::fprintf(file, "f %d %d %d %d\n", corner, corner + 1, corner + gridSize + 1, corner + gridSize);
+            }
+        }
+        return std::fclose(file) == 0;
+    }
+}
+
+bool runMeshLoadingBenchmark(std::string const &meshPath, std::string const &outputPath)
+{
+    const int iterations = 3;
+    const int gridSize = 1024;
+    const std::string generatedPath = "mesh-benchmark.obj",
+                      binaryPath = "mesh-benchmark.mesh";
+
+    std::string objPath = meshPath;
+    if (objPath.empty())
+    {
+        logInfo("Generating a %dx%d grid mesh", gridSize, gridSize);
+        if (!generateObj(generatedPath, gridSize))
+        {
+            logError("Couldn't write %s", generatedPath.c_str());
+            return false;
+        }
+        objPath = generatedPath;
+    }
+    logInfo("Benchmarking mesh loading of %s", objPath.c_str());
+
+    // 1, 2, 4... and all the cores
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < cores; threads *= 2) { threadCounts.push_back(threads); }
+    threadCounts.push_back(cores);
+
+    std::ostringstream parsing;
+    MeshData mesh;
+    MeshImportStatistics importStatistics;
+    double singleThreadMilliseconds = 0.0;
+    for (size_t i = 0; i < threadCounts.size(); i++)
+    {
+        std::vector<double> durations;
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (!importObj(objPath, mesh, threadCounts[i], &importStatistics))
+            {
+                logError("Couldn't import %s", objPath.c_str());
+                return false;
+            }
+            durations.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        TimingStatistics time = calculateTimingStatistics(durations);
+        if (i == 0) { singleThreadMilliseconds = time.median; }
+        double megabytes = importStatistics.fileBytes / (1024.0 * 1024.0);
+        parsing << (i == 0 ? "" : ",\n")
+                << "    {\"threads\": " << threadCounts[i]
+                << ", \"chunks\": " << importStatistics.threads
+                << ", \"load_ms\": " << timingStatisticsJSON(time)
+                << ", \"mb_per_second\": " << (time.median > 0.0 ? megabytes / (time.median / 1000.0) : 0.0)
+                << ", \"speedup\": " << (time.median > 0.0 ? singleThreadMilliseconds / time.median : 0.0) << "}";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t duplicates = deduplicateVertices(mesh);
+    double deduplicateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double acmrBefore = averageCacheMissRatio(mesh.indices, mesh.verticesCount());
+    start = std::chrono::steady_clock::now();
+    optimizeMesh(mesh);
+    double optimizeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double acmrAfter = averageCacheMissRatio(mesh.indices, mesh.verticesCount());
+
+    // the same mesh from the binary file: mapped, validated and prefaulted, nothing is parsed or copied
+    if (!saveMeshFile(binaryPath, mesh))
+    {
+        logError("Couldn't write %s", binaryPath.c_str());
+        return false;
+    }
+    std::vector<double> binaryDurations;
+    size_t binaryBytes = 0;
+    for (int iteration = 0; iteration < iterations * 3; iteration++)
+    {
+        MeshFile file;
+        auto binaryStart = std::chrono::steady_clock::now();
+        if (!file.open(binaryPath))
+        {
+            logError("Couldn't load %s", binaryPath.c_str());
+            return false;
+        }
+        file.prefault();
+        binaryDurations.push_back(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - binaryStart).count()
+        );
+        binaryBytes = file.size();
+    }
+    TimingStatistics binaryTime = calculateTimingStatistics(binaryDurations);
+
+    std::error_code error;
+    std::filesystem::remove(binaryPath, error);
+    if (objPath == generatedPath) { std::filesystem::remove(generatedPath, error); }
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"benchmark\": \"mesh-loading\",\n"
+           << "  \"mesh\": \"" << jsonEscape(objPath) << "\",\n"
+           << "  \"obj_bytes\": " << importStatistics.fileBytes << ",\n"
+           << "  \"vertices\": " << importStatistics.sourceVertices << ",\n"
+           << "  \"triangles\": " << importStatistics.triangles << ",\n"
+           << "  \"obj_parsing\": [\n" << parsing.str() << "\n  ],\n"
+           << "  \"deduplication\": {\"ms\": " << deduplicateMilliseconds
+           << ", \"removed_vertices\": " << duplicates << "},\n"
+           << "  \"vertex_cache_optimization\": {\"ms\": " << optimizeMilliseconds
+           << ", \"acmr_before\": " << acmrBefore << ", \"acmr_after\": " << acmrAfter << "},\n"
+           << "  \"binary\": {\"bytes\": " << binaryBytes << ", \"load_ms\": " << timingStatisticsJSON(binaryTime)
+           << ", \"mb_per_second\": "
+           << (binaryTime.median > 0.0 ? binaryBytes / (1024.0 * 1024.0) / (binaryTime.median / 1000.0) : 0.0) << "}\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), outputPath);
+}
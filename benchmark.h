@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "statistics.h"
+
+// calls renderFrame() until either frames amount or seconds are reached
+// and returns the time of every measured frame
+std::vector<double> runFrameLoop(
+    std::function<void()> const &renderFrame,
+    int warmupFrames,
+    int frames,
+    double seconds
+);
+
+// calls operation() the given amount of times in bursts, with a pause between them
+// (which is not measured), and returns the duration of every call in nanoseconds
+std::vector<double> measureOperation(
+    std::function<void()> const &operation,
+    int iterations,
+    int burstSize,
+    std::function<void()> const &betweenBursts
+);
+
+std::string jsonEscape(std::string const &text);
+
+// {"min": ..., "median": ..., ...} object
+std::string timingStatisticsJSON(TimingStatistics const &statistics);
+// "frames", "total_seconds" and "frame_time_ms" fields (frame times are in milliseconds),
+// to be embedded into reports
+std::string frameTimeStatisticsJSON(TimingStatistics const &statistics);
+
+// compares the asynchronous logger with std::cout-style logging
+bool runLoggerBenchmark(std::string const &outputPath);
+// compares rasterizing the font atlas with loading it from the cache
+bool runFontAtlasBenchmark(std::string const &fontPath, std::string const &outputPath);
+// ingestion rate of the time series ring and plotting cost with and without the min/max pyramid
+bool runTimeSeriesBenchmark(std::string const &outputPath);
+// OBJ parsing rate by the amount of threads, mesh optimization and loading of the binary mesh,
+// of the given mesh or of a generated one if the path is empty
+bool runMeshLoadingBenchmark(std::string const &meshPath, std::string const &outputPath);
+
+// to stdout if outputPath is empty
+bool writeBenchmarkReport(std::string const &report, std::string const &outputPath);
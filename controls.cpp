@@ -0,0 +1,440 @@
+#include <chrono>
+#include <algorithm>
+
+#include "controls.h"
+#include "retained-windows.h"
+#include "logger.h"
+
+ControlsChanges composeControls(
+    ControlsState &state,
+    ControlsStatistics const &statistics,
+    ControlsHooks const &hooks,
+    FrameArena &arena
+)
+{
+    ControlsChanges changes;
+
+    // standard demo window
+    if (state.showDemoWindow) { ImGui::ShowDemoWindow(&state.showDemoWindow); }
+
+    // a window is defined by Begin/End pair
+    {
+        // make controls widget width to be 1/3 of the main window width
+        int controls_width = statistics.windowWidth;
+        if ((controls_width /= 3) < 300) { controls_width = 300; }
+
+        // position the controls widget in the top-right corner with some margin
+        ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
+        // here we set the calculated width and also make the height to be
+        // be the height of the main window also with some margin
+        ImGui::SetNextWindowSize(
+            ImVec2(static_cast<float>(controls_width), static_cast<float>(statistics.windowHeight - 20)),
+            ImGuiCond_Always
+            );
+
+        ImGui::SetNextWindowBgAlpha(0.7f);
+        // create a window and append into it
+        ImGui::Begin("Controls", NULL, ImGuiWindowFlags_NoResize);
+        if (state.retainWindows) { retainCurrentWindow(); }
+
+        ImGui::Dummy(ImVec2(0.0f, 1.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Time");
+        // formatted in the frame arena instead of a new std::string every frame
+        char *timestamp = arena.allocateArray<char>(timestampMaxLength);
+        state.timestampFormatter.format(std::chrono::system_clock::now(), state.showMilliseconds, timestamp);
+        // what changes every frame is drawn over the retained layer, so the rest of the window is reused
+        beginVolatileRegion();
+        ImGui::TextUnformatted(timestamp);
+        endVolatileRegion();
+
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Application");
+        ImGui::Text("Main window width: %d", statistics.windowWidth);
+        ImGui::Text("Main window height: %d", statistics.windowHeight);
+
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Rendering");
+        changes.powerSaving = ImGui::Checkbox("power saving", &state.powerSaving);
+        ImGui::Checkbox("show milliseconds", &state.showMilliseconds);
+        beginVolatileRegion();
+        ImGui::Text("Frames rendered: %llu", static_cast<unsigned long long>(statistics.renderedFrames));
+        ImGui::Text("Frames skipped: %llu", static_cast<unsigned long long>(statistics.skippedFrames));
+        endVolatileRegion();
+        if (statistics.targetFPS > 0.0)
+        {
+            ImGui::Text("Swap interval: %d, frame limit: %.0f FPS", statistics.swapInterval, statistics.targetFPS);
+        }
+        else
+        {
+            ImGui::Text("Swap interval: %d%s", statistics.swapInterval, statistics.swapInterval == 0 ? " (uncapped)" : "");
+        }
+        if (statistics.framePacing)
+        {
+            changes.lateInput = ImGui::Checkbox("late input sampling", &state.lateInput);
+            ImGui::SameLine();
+            beginVolatileRegion();
+            ImGui::TextDisabled("(frame takes %.1f ms)", statistics.frameWorkMilliseconds);
+            endVolatileRegion();
+        }
+        beginVolatileRegion();
+        ImGui::Text(
+            "Input to swap: median %.1f ms, p99 %.1f ms, max %.1f ms",
+            statistics.inputLatency.median,
+            statistics.inputLatency.p99,
+            statistics.inputLatency.max
+        );
+        endVolatileRegion();
+        if (statistics.pipelined)
+        {
+            beginVolatileRegion();
+            ImGui::Text(
+                "Pipelined: %d frames ahead at most, UI waited %.1f ms",
+                statistics.pipelineDepth,
+                statistics.pipelineBlockedMilliseconds
+            );
+            endVolatileRegion();
+            // its GPU queries would need the context on both threads
+            ImGui::TextDisabled("frame profiler is not available in pipelined mode");
+        }
+        else
+        {
+            changes.profiler = ImGui::Checkbox("frame profiler", &state.profiler);
+        }
+        if (state.profiler)
+        {
+            if (hooks.drawProfilerGraph)
+            {
+                beginVolatileRegion();
+                hooks.drawProfilerGraph();
+                endVolatileRegion();
+            }
+            ImGui::TextDisabled("F12 saves a trace of the last %d frames", statistics.profilerFrames);
+        }
+        if (statistics.imguiRenderer)
+        {
+            beginVolatileRegion();
+            ImGui::Text(
+                "Dear ImGui: %d commands in %d draw calls%s",
+                statistics.scene.imgui.commands,
+                statistics.scene.imgui.drawCalls,
+                statistics.persistentlyMapped ? " (persistent buffer)" : ""
+            );
+            endVolatileRegion();
+        }
+        if (statistics.retainedLayers)
+        {
+            changes.retainWindows = ImGui::Checkbox("retained window layers", &state.retainWindows);
+            if (state.retainWindows)
+            {
+                RetainedLayersStatistics const &layers = statistics.scene.retainedLayers;
+                beginVolatileRegion();
+                ImGui::Text(
+                    "Layers: %d (%.1f MB), hit rate %.1f%%, %.1f ms GPU time saved",
+                    layers.layers,
+                    layers.textureBytes / 1024.0 / 1024.0,
+                    layers.hitRate() * 100.0,
+                    layers.gpuMillisecondsSaved
+                );
+                endVolatileRegion();
+            }
+        }
+        if (statistics.allocationTracking)
+        {
+            FrameAllocationStatistics const &allocations = statistics.allocations;
+            beginVolatileRegion();
+            ImGui::Text(
+                "Heap: %llu allocations (%.1f KB) per frame, %llu by Dear ImGui",
+                static_cast<unsigned long long>(allocations.allocations),
+                allocations.bytes / 1024.0,
+                static_cast<unsigned long long>(allocations.imguiAllocations)
+            );
+            ImGui::Text(
+                "Heap in use: %.1f MB, peak %.1f MB, %llu frames without allocations",
+                statistics.liveHeapBytes / 1024.0 / 1024.0,
+                statistics.peakLiveBytes / 1024.0 / 1024.0,
+                static_cast<unsigned long long>(statistics.framesWithoutAllocations)
+            );
+            ImGui::Text("Frame arena: %zu of %zu bytes at most", statistics.arenaHighWater, statistics.arenaCapacity);
+            endVolatileRegion();
+        }
+        beginVolatileRegion();
+        ImGui::Text(
+            "Shader cache: %d hits, %d misses, %d rejected",
+            statistics.shaderCacheHits,
+            statistics.shaderCacheMisses,
+            statistics.shaderCacheRejected
+        );
+        endVolatileRegion();
+
+        SceneStatistics const &scene = statistics.scene;
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Scene");
+        ImGui::SliderInt(
+            "instances",
+            &state.instances,
+            0,
+            statistics.instancesMax,
+            "%d",
+            ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp
+        );
+        // regenerating millions of instances on every step of dragging would be too slow
+        changes.instances = ImGui::IsItemDeactivatedAfterEdit();
+        changes.animate = ImGui::Checkbox("animate", &state.animate);
+        beginVolatileRegion();
+        ImGui::Text(
+            "Triangles: %zu, draw calls: %d%s",
+            scene.batch.triangles,
+            scene.batch.drawCalls,
+            scene.multiDrawIndirect ? " (indirect)" : ""
+        );
+        ImGui::Text("Triangles per second: %.1f M", scene.trianglesPerSecond / 1000000.0);
+        endVolatileRegion();
+        if (statistics.particles)
+        {
+            changes.particles = ImGui::Checkbox("particles", &state.particles);
+            if (state.particles)
+            {
+                ImGui::SliderInt(
+                    "particles count",
+                    &state.particlesCount,
+                    1000,
+                    statistics.particlesCountMax,
+                    "%d",
+                    ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp
+                );
+                // the particles start over with every new count
+                changes.particlesCount = ImGui::IsItemDeactivatedAfterEdit();
+                // compute shaders need GL 4.3, which is not there on macOS
+                if (scene.particles.computeSupported)
+                {
+                    changes.particlesBackend |= ImGui::RadioButton("GPU", &state.particlesBackend, static_cast<int>(ParticleBackend::GPU));
+                    ImGui::SameLine();
+                }
+                changes.particlesBackend |= ImGui::RadioButton("CPU", &state.particlesBackend, static_cast<int>(ParticleBackend::CPU));
+                ImGui::SameLine();
+                changes.validateParticles = ImGui::Button("validate");
+                beginVolatileRegion();
+                ImGui::Text(
+                    "Simulation: %.2f ms on %s, rendering: %.2f ms on GPU",
+                    scene.particles.simulationMilliseconds,
+                    scene.particles.backend == ParticleBackend::GPU ? "GPU" : "CPU",
+                    scene.particles.renderMilliseconds
+                );
+                if (scene.particles.backend == ParticleBackend::CPU)
+                {
+                    ImGui::Text("CPU: %d threads, %s", scene.particles.threads, scene.particles.simd);
+                }
+                if (scene.particles.gpuDifference >= 0.0)
+                {
+                    ImGui::Text(
+                        "Largest difference from scalar: %s %g, compute shader %g",
+                        scene.particles.simd,
+                        scene.particles.scalarDifference,
+                        scene.particles.gpuDifference
+                    );
+                }
+                else if (scene.particles.scalarDifference >= 0.0)
+                {
+                    ImGui::Text(
+                        "Largest difference from scalar: %s %g",
+                        scene.particles.simd,
+                        scene.particles.scalarDifference
+                    );
+                }
+                endVolatileRegion();
+            }
+        }
+        if (statistics.dynamicResolution)
+        {
+            changes.dynamicResolution = ImGui::Checkbox("dynamic resolution", &state.dynamicResolution);
+            if (state.dynamicResolution)
+            {
+                changes.sceneBudget = ImGui::SliderFloat("scene budget, ms", &state.sceneBudget, 1.0f, 33.0f, "%.1f");
+                uint64_t measured = scene.resolution.withinBudget + scene.resolution.overBudget;
+                beginVolatileRegion();
+                ImGui::Text(
+                    "Scale: %.2f (%dx%d), scene %.2f ms on GPU",
+                    scene.resolution.scale,
+                    scene.resolution.width,
+                    scene.resolution.height,
+                    scene.resolution.sceneMilliseconds
+                );
+                ImGui::Text(
+                    "Within budget: %.1f%% (%llu hits, %llu misses), %llu scale changes",
+                    measured > 0 ? 100.0 * scene.resolution.withinBudget / measured : 0.0,
+                    static_cast<unsigned long long>(scene.resolution.withinBudget),
+                    static_cast<unsigned long long>(scene.resolution.overBudget),
+                    static_cast<unsigned long long>(scene.resolution.scaleChanges)
+                );
+                endVolatileRegion();
+            }
+        }
+        if (statistics.mesh)
+        {
+            beginVolatileRegion();
+            if (scene.mesh.totalBytes > 0 && scene.mesh.uploadedBytes < scene.mesh.totalBytes)
+            {
+                ImGui::Text(
+                    "Mesh: uploading, %zu of %zu MB",
+                    scene.mesh.uploadedBytes / (1024 * 1024),
+                    scene.mesh.totalBytes / (1024 * 1024)
+                );
+            }
+            else if (scene.mesh.totalBytes > 0)
+            {
+                ImGui::Text(
+                    "Mesh: %zu vertices, %zu triangles, loaded in %.1f ms%s",
+                    scene.mesh.vertices,
+                    scene.mesh.triangles,
+                    scene.mesh.loadMilliseconds,
+                    scene.mesh.fromBinary ? " (mapped)" : ""
+                );
+                if (!scene.mesh.fromBinary)
+                {
+                    ImGui::Text(
+                        "Parsed at %.1f MB/s on %d threads, ACMR %.2f -> %.2f",
+                        scene.mesh.import.fileBytes / (1024.0 * 1024.0)
+                            / ((scene.mesh.import.parseMilliseconds + scene.mesh.import.mergeMilliseconds) / 1000.0),
+                        scene.mesh.import.threads,
+                        scene.mesh.import.acmrBefore,
+                        scene.mesh.import.acmrAfter
+                    );
+                }
+            }
+            else { ImGui::Text("Mesh: %s", scene.mesh.state); }
+            endVolatileRegion();
+        }
+        if (state.animate)
+        {
+            beginVolatileRegion();
+            ImGui::Text(
+                "Stream writes: %llu, fence waits: %llu (%.1f ms)",
+                static_cast<unsigned long long>(scene.streamWrites),
+                static_cast<unsigned long long>(scene.streamFenceWaits),
+                scene.streamFenceWaitMilliseconds
+            );
+            endVolatileRegion();
+        }
+
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Telemetry");
+        ImGui::Checkbox("frame time", &state.frameTimeGraph);
+        if (state.frameTimeGraph)
+        {
+            // every frame is rendered while the plot is shown, so every one gets a sample
+            changes.forceRender = true;
+            state.frameTimeSeries.push(ImGui::GetIO().DeltaTime * 1000.0f);
+            state.frameTimeSeries.update();
+            beginVolatileRegion();
+            state.frameTimePlot.draw("frame time, ms", state.frameTimeSeries, ImVec2(0.0f, 60.0f));
+            endVolatileRegion();
+        }
+        changes.signalGenerator = ImGui::Checkbox("signal generator", &state.signalGenerator);
+        if (state.signalGenerator)
+        {
+            changes.forceRender = true;
+            state.signalSeries.update();
+            beginVolatileRegion();
+            state.signalPlot.draw("signal", state.signalSeries, ImVec2(0.0f, 80.0f));
+            ImGui::TextDisabled(
+                "%llu samples received, %llu dropped",
+                static_cast<unsigned long long>(state.signalSeries.totalSamples()),
+                static_cast<unsigned long long>(state.signalSeries.dropped())
+            );
+            endVolatileRegion();
+        }
+        if (state.frameTimeGraph || state.signalGenerator)
+        {
+            ImGui::TextDisabled("wheel zooms, dragging pans, double click resets");
+        }
+
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "GLFW");
+        ImGui::Text("%s", statistics.glfwVersion);
+
+        ImGui::Dummy(ImVec2(0.0f, 3.0f));
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Dear ImGui");
+        ImGui::Text("%s", IMGUI_VERSION);
+
+        ImGui::Dummy(ImVec2(0.0f, 10.0f));
+        ImGui::Separator();
+        ImGui::Dummy(ImVec2(0.0f, 10.0f));
+
+        // buttons and most other widgets return true when clicked/edited/activated
+        if (ImGui::Button("Counter button"))
+        {
+            logInfo("counter button clicked");
+            state.counter++;
+            if (state.counter == 9) { ImGui::OpenPopup("Easter egg"); }
+        }
+        ImGui::SameLine();
+        ImGui::Text("counter = %d", state.counter);
+
+        if (ImGui::BeginPopupModal("Easter egg", NULL))
+        {
+            ImGui::Text("Ho-ho, you found me!");
+            if (ImGui::Button("Buy Ultimate Orb")) { ImGui::CloseCurrentPopup(); }
+            ImGui::EndPopup();
+        }
+
+        ImGui::Dummy(ImVec2(0.0f, 15.0f));
+        if (!state.showDemoWindow)
+        {
+            if (ImGui::Button("Open standard demo"))
+            {
+                state.showDemoWindow = true;
+            }
+        }
+
+        ImGui::Checkbox("show a custom window", &state.showCustomWindow);
+        if (state.showCustomWindow)
+        {
+            ImGui::SetNextWindowSize(
+                ImVec2(460.0f, 360.0f),
+                ImGuiCond_FirstUseEver // after first launch it will use values from imgui.ini
+                );
+            // the window will have a closing button that will clear the bool variable
+            ImGui::Begin("A custom window", &state.showCustomWindow);
+            if (state.retainWindows) { retainCurrentWindow(); }
+
+            ImGui::Dummy(ImVec2(0.0f, 1.0f));
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Some label");
+
+            ImGui::TextColored(ImVec4(128 / 255.0f, 128 / 255.0f, 128 / 255.0f, 1.0f), "%s", "another label");
+            ImGui::Dummy(ImVec2(0.0f, 0.5f));
+
+            if (hooks.drawImages) { hooks.drawImages(); }
+
+            ImGui::Dummy(ImVec2(0.0f, 1.0f));
+            if (ImGui::Button("Close"))
+            {
+                logInfo("close button clicked");
+                state.showCustomWindow = false;
+            }
+
+            ImGui::End();
+        }
+
+        ImGui::Checkbox("show a list view", &state.showListView);
+        // the items are generated by the application, a chunk every frame
+        if (state.showListView && state.listView != NULL)
+        {
+            ImGui::SetNextWindowSize(ImVec2(500.0f, 400.0f), ImGuiCond_FirstUseEver);
+            ImGui::Begin("List view", &state.showListView);
+            if (state.retainWindows) { retainCurrentWindow(); }
+            state.listView->draw("assets", ImVec2(0.0f, -ImGui::GetFrameHeightWithSpacing()));
+            if (state.listView->selected() >= 0)
+            {
+                ImGui::Text("Selected: %s", (*state.listViewItems)[state.listView->selected()].c_str());
+            }
+            else
+            {
+                ImGui::TextDisabled("filtering took %.2f ms", state.listView->filterMilliseconds());
+            }
+            ImGui::End();
+        }
+
+        ImGui::End();
+    }
+    return changes;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include <dearimgui/imgui.h>
+
+#include "functions.h"
+#include "statistics.h"
+#include "time-series.h"
+#include "allocation-tracker.h"
+#include "list-view.h"
+// only for the statistics structs, nothing here makes GL calls
+#include "batch-renderer.h"
+#include "imgui-renderer.h"
+#include "retained-layers.h"
+#include "dynamic-resolution.h"
+#include "mesh-loader.h"
+#include "particle-system.h"
+
+// what the render thread measured, the UI thread gets a copy of it
+struct SceneStatistics
+{
+    BatchStatistics batch;
+    bool multiDrawIndirect = false;
+    double trianglesPerSecond = 0.0;
+    uint64_t streamWrites = 0;
+    uint64_t streamFenceWaits = 0;
+    double streamFenceWaitMilliseconds = 0.0;
+    ImGuiRendererStatistics imgui;
+    RetainedLayersStatistics retainedLayers;
+    DynamicResolutionStatistics resolution;
+    MeshLoaderStatistics mesh;
+    ParticleStatistics particles;
+};
+
+// what the "Controls" window shows, gathered by the application before composing it
+struct ControlsStatistics
+{
+    // of the framebuffer
+    int windowWidth = 0;
+    int windowHeight = 0;
+    const char *glfwVersion = "";
+
+    uint64_t renderedFrames = 0;
+    uint64_t skippedFrames = 0;
+    int swapInterval = 1;
+    double targetFPS = 0.0;
+    // the frame pacer is on, and how long it expects a frame to take
+    bool framePacing = false;
+    double frameWorkMilliseconds = 0.0;
+    TimingStatistics inputLatency;
+    bool pipelined = false;
+    int pipelineDepth = 0;
+    double pipelineBlockedMilliseconds = 0.0;
+    int profilerFrames = 0;
+    // with the persistently mapped Dear ImGui renderer
+    bool imguiRenderer = false;
+    bool persistentlyMapped = false;
+    bool retainedLayers = false;
+
+    bool allocationTracking = false;
+    FrameAllocationStatistics allocations;
+    uint64_t liveHeapBytes = 0;
+    uint64_t peakLiveBytes = 0;
+    uint64_t framesWithoutAllocations = 0;
+    size_t arenaHighWater = 0;
+    size_t arenaCapacity = 0;
+    int shaderCacheHits = 0;
+    int shaderCacheMisses = 0;
+    int shaderCacheRejected = 0;
+
+    int instancesMax = 0;
+    SceneStatistics scene;
+    bool particles = false;
+    int particlesCountMax = 0;
+    bool dynamicResolution = false;
+    bool mesh = false;
+};
+
+// what the windows edit, owned by the UI thread
+struct ControlsState
+{
+    bool showDemoWindow = false;
+    bool showCustomWindow = false;
+    bool showListView = false;
+    bool showMilliseconds = true;
+    int counter = 0;
+    // retained layers are used for the windows
+    bool retainWindows = false;
+
+    // mirror the state of the application, which applies what has changed
+    bool powerSaving = false;
+    bool lateInput = false;
+    bool profiler = false;
+
+    int instances = 0;
+    bool animate = false;
+    bool particles = false;
+    int particlesCount = 100000;
+    int particlesBackend = static_cast<int>(ParticleBackend::GPU);
+    bool dynamicResolution = false;
+    float sceneBudget = 8.0f;
+
+    // opt-in, as a plot that changes every frame keeps power saving from ever sleeping
+    bool frameTimeGraph = false;
+    bool signalGenerator = false;
+    TimeSeries frameTimeSeries;
+    TimeSeriesPlot frameTimePlot;
+    // filled by producer threads, if there are any
+    TimeSeries signalSeries;
+    TimeSeriesPlot signalPlot;
+
+    // the list view and its items, NULL until there are some
+    ListView *listView = NULL;
+    std::vector<std::string> const *listViewItems = NULL;
+
+    TimestampFormatter timestampFormatter;
+};
+
+// parts of the windows that need GL or threads of the application, empty ones are skipped
+struct ControlsHooks
+{
+    std::function<void()> drawProfilerGraph;
+    // thumbnails in the custom window
+    std::function<void()> drawImages;
+};
+
+// edits that the application has to pass on
+struct ControlsChanges
+{
+    bool powerSaving = false;
+    bool lateInput = false;
+    bool profiler = false;
+    bool retainWindows = false;
+    // once the slider is released, regenerating on every step would be too slow
+    bool instances = false;
+    bool animate = false;
+    bool particles = false;
+    bool particlesCount = false;
+    bool particlesBackend = false;
+    bool validateParticles = false;
+    bool dynamicResolution = false;
+    bool sceneBudget = false;
+    bool signalGenerator = false;
+    // something shown changes every frame, so every frame has to be rendered
+    bool forceRender = false;
+};
+
+// The demo window, "Controls", the custom window and the list view, between
+// NewFrame() and Render(). It only builds the UI, so the benchmarks compose
+// exactly what the application does, without a window or GL
+ControlsChanges composeControls(
+    ControlsState &state,
+    ControlsStatistics const &statistics,
+    ControlsHooks const &hooks,
+    FrameArena &arena
+);
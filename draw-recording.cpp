@@ -0,0 +1,469 @@
+#include <cstring>
+#include <cstddef>
+#include <climits>
+
+#include "draw-recording.h"
+#include "logger.h"
+
+namespace
+{
+    const char recordingMagic[4] = { 'I', 'M', 'D', 'R' };
+    const uint32_t recordingVersion = 1;
+    const uint32_t frameMagic = 0x454d5246; // "FRME"
+    const size_t dataAlignment = 8;
+
+    struct RecordingHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t indexSize;
+    };
+
+    struct FrameRecord
+    {
+        uint32_t magic;
+        uint32_t listsCount;
+        // of the whole record, including lists, commands and data
+        uint64_t size;
+        uint64_t fontTexture;
+        float displayPos[2];
+        float displaySize[2];
+        float framebufferScale[2];
+        int32_t totalVtxCount;
+        int32_t totalIdxCount;
+    };
+
+    struct ListRecord
+    {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t commandCount;
+        uint32_t flags;
+        // from the beginning of the file, can point to an earlier frame
+        uint64_t verticesOffset;
+        uint64_t indicesOffset;
+    };
+
+    struct CommandRecord
+    {
+        float clipRect[4];
+        uint64_t texture;
+        uint32_t vertexOffset;
+        uint32_t indexOffset;
+        uint32_t elementCount;
+        uint32_t flags;
+    };
+
+    // the only callback that can be replayed
+    const uint32_t commandResetRenderState = 1;
+
+    size_t alignedSize(size_t size)
+    {
+        return (size + dataAlignment - 1) / dataAlignment * dataAlignment;
+    }
+
+    // ImTextureID is a pointer or an integer, depending on the version
+    uint64_t textureValue(ImTextureID texture)
+    {
+        return (uint64_t)(intptr_t)texture;
+    }
+
+    ImTextureID textureID(uint64_t value)
+    {
+        return (ImTextureID)(intptr_t)value;
+    }
+
+    ImTextureID commandTexture(ImDrawCmd const &command)
+    {
+#if IMGUI_VERSION_NUM >= 19200
+        return command.GetTexID();
+#else
+        return command.TextureId;
+#endif
+    }
+
+    template<typename T>
+    void append(std::vector<unsigned char> &buffer, T const &value)
+    {
+        size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // appends aligned data and returns its offset in the buffer
+    size_t appendData(std::vector<unsigned char> &buffer, const void *data, size_t size)
+    {
+        size_t offset = buffer.size();
+        buffer.resize(offset + alignedSize(size), 0);
+        if (size > 0) { std::memcpy(buffer.data() + offset, data, size); }
+        return offset;
+    }
+
+    // ImVector pointing into the mapping, it must not free it
+    template<typename T>
+    void pointVector(ImVector<T> &vector, const unsigned char *data, uint32_t count)
+    {
+        vector.Data = reinterpret_cast<T *>(const_cast<unsigned char *>(data));
+        vector.Size = vector.Capacity = static_cast<int>(count);
+    }
+
+    // every command must draw only indices and vertices of its own list,
+    // otherwise a broken file makes the renderers read past the buffers
+    bool commandsInsideList(const unsigned char *commands, ListRecord const &listRecord, const unsigned char *data)
+    {
+        const unsigned char *indices = data + listRecord.indicesOffset;
+        for (uint32_t c = 0; c < listRecord.commandCount; c++)
+        {
+            CommandRecord commandRecord;
+            std::memcpy(&commandRecord, commands + c * sizeof(CommandRecord), sizeof(commandRecord));
+            if ((commandRecord.flags & commandResetRenderState) != 0 || commandRecord.elementCount == 0) { continue; }
+            if (
+                static_cast<uint64_t>(commandRecord.indexOffset) + commandRecord.elementCount > listRecord.indexCount
+                || commandRecord.vertexOffset >= listRecord.vertexCount
+            )
+            {
+                return false;
+            }
+            uint32_t verticesLeft = listRecord.vertexCount - commandRecord.vertexOffset;
+            for (uint32_t i = 0; i < commandRecord.elementCount; i++)
+            {
+                ImDrawIdx index;
+                std::memcpy(&index, indices + (static_cast<size_t>(commandRecord.indexOffset) + i) * sizeof(ImDrawIdx), sizeof(index));
+                if (index >= verticesLeft) { return false; }
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    void releaseVector(ImVector<T> &vector)
+    {
+        vector.Data = NULL;
+        vector.Size = vector.Capacity = 0;
+    }
+}
+
+DrawDataRecorder::~DrawDataRecorder()
+{
+    close();
+}
+
+bool DrawDataRecorder::open(std::filesystem::path const &path)
+{
+    close();
+    file = std::fopen(path.string().c_str(), "wb");
+    if (file == NULL)
+    {
+        logError("Couldn't open %s for recording draw data", path.string().c_str());
+        return false;
+    }
+    filePath = path;
+
+    RecordingHeader header;
+    std::memcpy(header.magic, recordingMagic, sizeof(recordingMagic));
+    header.version = recordingVersion;
+    header.vertexSize = sizeof(ImDrawVert);
+    header.indexSize = sizeof(ImDrawIdx);
+    std::fwrite(&header, sizeof(header), 1, file);
+    position = sizeof(header);
+    framesCount = 0;
+    previousLists.clear();
+    return true;
+}
+
+void DrawDataRecorder::close()
+{
+    if (file == NULL) { return; }
+
+    std::fclose(file);
+    file = NULL;
+    logInfo(
+        "Recorded %llu frames of draw data (%.1f MB) to %s",
+        static_cast<unsigned long long>(framesCount),
+        position / 1024.0 / 1024.0,
+        filePath.string().c_str()
+    );
+}
+
+void DrawDataRecorder::recordFrame(ImDrawData const *drawData, ImTextureID fontTexture)
+{
+    if (file == NULL) { return; }
+
+    int listsCount = drawData->CmdListsCount;
+    frameBuffer.clear();
+
+    FrameRecord frame;
+    frame.magic = frameMagic;
+    frame.listsCount = static_cast<uint32_t>(listsCount);
+    frame.size = 0;
+    frame.fontTexture = textureValue(fontTexture);
+    frame.displayPos[0] = drawData->DisplayPos.x;
+    frame.displayPos[1] = drawData->DisplayPos.y;
+    frame.displaySize[0] = drawData->DisplaySize.x;
+    frame.displaySize[1] = drawData->DisplaySize.y;
+    frame.framebufferScale[0] = drawData->FramebufferScale.x;
+    frame.framebufferScale[1] = drawData->FramebufferScale.y;
+    frame.totalVtxCount = drawData->TotalVtxCount;
+    frame.totalIdxCount = drawData->TotalIdxCount;
+    append(frameBuffer, frame);
+
+    // list records are filled in once their data is written
+    size_t listRecordsOffset = frameBuffer.size();
+    frameBuffer.resize(listRecordsOffset + listsCount * sizeof(ListRecord));
+
+    if (previousLists.size() < static_cast<size_t>(listsCount)) { previousLists.resize(listsCount); }
+    for (int n = 0; n < listsCount; n++)
+    {
+        ImDrawList const *list = drawData->CmdLists[n];
+        ListRecord record;
+        record.vertexCount = static_cast<uint32_t>(list->VtxBuffer.Size);
+        record.indexCount = static_cast<uint32_t>(list->IdxBuffer.Size);
+        record.commandCount = 0;
+        record.flags = 0;
+
+        for (int c = 0; c < list->CmdBuffer.Size; c++)
+        {
+            ImDrawCmd const &command = list->CmdBuffer[c];
+            // other callbacks only make sense in the application
+            if (command.UserCallback != NULL && command.UserCallback != ImDrawCallback_ResetRenderState) { continue; }
+
+            CommandRecord commandRecord;
+            commandRecord.clipRect[0] = command.ClipRect.x;
+            commandRecord.clipRect[1] = command.ClipRect.y;
+            commandRecord.clipRect[2] = command.ClipRect.z;
+            commandRecord.clipRect[3] = command.ClipRect.w;
+            commandRecord.texture = command.UserCallback == NULL ? textureValue(commandTexture(command)) : 0;
+            commandRecord.vertexOffset = command.VtxOffset;
+            commandRecord.indexOffset = command.IdxOffset;
+            commandRecord.elementCount = command.ElemCount;
+            commandRecord.flags = command.UserCallback != NULL ? commandResetRenderState : 0;
+            append(frameBuffer, commandRecord);
+            record.commandCount++;
+        }
+
+        // unchanged buffers refer to where they were written before
+        PreviousList &previous = previousLists[n];
+        size_t verticesSize = static_cast<size_t>(list->VtxBuffer.size_in_bytes()),
+               indicesSize = static_cast<size_t>(list->IdxBuffer.size_in_bytes());
+        const unsigned char *vertices = reinterpret_cast<const unsigned char *>(list->VtxBuffer.Data),
+                            *indices = reinterpret_cast<const unsigned char *>(list->IdxBuffer.Data);
+        if (
+            framesCount > 0
+            && previous.vertices.size() == verticesSize
+            && (verticesSize == 0 || std::memcmp(previous.vertices.data(), vertices, verticesSize) == 0)
+        )
+        {
+            record.verticesOffset = previous.verticesOffset;
+        }
+        else
+        {
+            record.verticesOffset = position + appendData(frameBuffer, vertices, verticesSize);
+            previous.vertices.assign(vertices, vertices + verticesSize);
+            previous.verticesOffset = record.verticesOffset;
+        }
+        if (
+            framesCount > 0
+            && previous.indices.size() == indicesSize
+            && (indicesSize == 0 || std::memcmp(previous.indices.data(), indices, indicesSize) == 0)
+        )
+        {
+            record.indicesOffset = previous.indicesOffset;
+        }
+        else
+        {
+            record.indicesOffset = position + appendData(frameBuffer, indices, indicesSize);
+            previous.indices.assign(indices, indices + indicesSize);
+            previous.indicesOffset = record.indicesOffset;
+        }
+
+        std::memcpy(frameBuffer.data() + listRecordsOffset + n * sizeof(ListRecord), &record, sizeof(record));
+    }
+    // lists beyond this frame's ones are not "previous" for the next frame anymore
+    for (size_t n = listsCount; n < previousLists.size(); n++)
+    {
+        previousLists[n].vertices.clear();
+        previousLists[n].indices.clear();
+    }
+
+    uint64_t size = frameBuffer.size();
+    std::memcpy(frameBuffer.data() + offsetof(FrameRecord, size), &size, sizeof(size));
+    if (std::fwrite(frameBuffer.data(), 1, frameBuffer.size(), file) != frameBuffer.size())
+    {
+        logError("Couldn't write draw data to %s, recording stopped", filePath.string().c_str());
+        close();
+        return;
+    }
+    position += size;
+    framesCount++;
+}
+
+DrawDataReplay::~DrawDataReplay()
+{
+    close();
+}
+
+bool DrawDataReplay::open(std::filesystem::path const &path, ImTextureID fontTexture)
+{
+    close();
+    if (!mapping.open(path))
+    {
+        logError("Couldn't open draw data recording %s", path.string().c_str());
+        return false;
+    }
+
+    const unsigned char *data = mapping.data();
+    size_t size = mapping.size();
+    RecordingHeader header;
+    if (
+        size < sizeof(header)
+        || (std::memcpy(&header, data, sizeof(header)), std::memcmp(header.magic, recordingMagic, sizeof(recordingMagic)) != 0)
+        || header.version != recordingVersion
+        || header.vertexSize != sizeof(ImDrawVert)
+        || header.indexSize != sizeof(ImDrawIdx)
+    )
+    {
+        logError("%s is not a draw data recording (or it was made by a different build)", path.string().c_str());
+        close();
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    while (offset + sizeof(FrameRecord) <= size)
+    {
+        FrameRecord frameRecord;
+        std::memcpy(&frameRecord, data + offset, sizeof(frameRecord));
+        if (
+            frameRecord.magic != frameMagic
+            || frameRecord.size > size - offset
+            || sizeof(FrameRecord) + frameRecord.listsCount * sizeof(ListRecord) > frameRecord.size
+        )
+        {
+            // most likely the application was closed while writing the last frame
+            logWarning("Draw data recording is truncated after %d frames", framesCount());
+            break;
+        }
+
+        auto frame = std::make_unique<Frame>();
+        ImDrawData &drawData = frame->drawData;
+        drawData.Valid = true;
+        drawData.CmdListsCount = static_cast<int>(frameRecord.listsCount);
+        // the renderers size their buffers by the totals, so they come from the lists themselves
+        uint64_t totalVertices = 0,
+                 totalIndices = 0;
+        drawData.DisplayPos = ImVec2(frameRecord.displayPos[0], frameRecord.displayPos[1]);
+        drawData.DisplaySize = ImVec2(frameRecord.displaySize[0], frameRecord.displaySize[1]);
+        drawData.FramebufferScale = ImVec2(frameRecord.framebufferScale[0], frameRecord.framebufferScale[1]);
+
+        const unsigned char *listRecords = data + offset + sizeof(FrameRecord);
+        const unsigned char *commands = listRecords + frameRecord.listsCount * sizeof(ListRecord);
+        bool valid = true;
+        for (uint32_t n = 0; n < frameRecord.listsCount && valid; n++)
+        {
+            ListRecord listRecord;
+            std::memcpy(&listRecord, listRecords + n * sizeof(ListRecord), sizeof(listRecord));
+            // written without overflows, as the counts can be anything in a broken file
+            size_t commandsLeft = static_cast<size_t>(data + offset + frameRecord.size - commands);
+            valid = listRecord.commandCount <= commandsLeft / sizeof(CommandRecord)
+                && listRecord.verticesOffset <= size
+                && listRecord.vertexCount <= (size - listRecord.verticesOffset) / sizeof(ImDrawVert)
+                && listRecord.indicesOffset <= size
+                && listRecord.indexCount <= (size - listRecord.indicesOffset) / sizeof(ImDrawIdx);
+            if (!valid) { break; }
+            valid = commandsInsideList(commands, listRecord, data);
+            if (!valid) { break; }
+            totalVertices += listRecord.vertexCount;
+            totalIndices += listRecord.indexCount;
+
+            ImDrawList *list = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+            drawLists.push_back(list);
+            pointVector(list->VtxBuffer, data + listRecord.verticesOffset, listRecord.vertexCount);
+            pointVector(list->IdxBuffer, data + listRecord.indicesOffset, listRecord.indexCount);
+            list->CmdBuffer.resize(static_cast<int>(listRecord.commandCount));
+            for (uint32_t c = 0; c < listRecord.commandCount; c++)
+            {
+                CommandRecord commandRecord;
+                std::memcpy(&commandRecord, commands + c * sizeof(CommandRecord), sizeof(commandRecord));
+                ImDrawCmd &command = list->CmdBuffer[static_cast<int>(c)];
+                command = ImDrawCmd();
+                command.ClipRect = ImVec4(
+                    commandRecord.clipRect[0],
+                    commandRecord.clipRect[1],
+                    commandRecord.clipRect[2],
+                    commandRecord.clipRect[3]
+                );
+                ImTextureID texture = commandRecord.texture == frameRecord.fontTexture
+                    ? fontTexture
+                    : textureID(commandRecord.texture);
+#if IMGUI_VERSION_NUM >= 19200
+                command.TexRef = ImTextureRef(texture);
+#else
+                command.TextureId = texture;
+#endif
+                command.VtxOffset = commandRecord.vertexOffset;
+                command.IdxOffset = commandRecord.indexOffset;
+                command.ElemCount = commandRecord.elementCount;
+                command.UserCallback = (commandRecord.flags & commandResetRenderState) != 0
+                    ? ImDrawCallback_ResetRenderState
+                    : NULL;
+            }
+            commands += listRecord.commandCount * sizeof(CommandRecord);
+#if IMGUI_VERSION_NUM >= 18980
+            drawData.CmdLists.push_back(list);
+#else
+            frame->drawListsPointers.push_back(list);
+#endif
+        }
+        valid = valid && totalVertices <= INT_MAX && totalIndices <= INT_MAX;
+        if (!valid)
+        {
+            logWarning("Draw data recording has a broken frame after %d frames", framesCount());
+            break;
+        }
+        drawData.TotalVtxCount = static_cast<int>(totalVertices);
+        drawData.TotalIdxCount = static_cast<int>(totalIndices);
+#if IMGUI_VERSION_NUM < 18980
+        drawData.CmdLists = frame->drawListsPointers.data();
+#endif
+        frames.push_back(std::move(frame));
+        offset += frameRecord.size;
+    }
+
+    if (frames.empty())
+    {
+        logError("There are no frames in %s", path.string().c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void DrawDataReplay::close()
+{
+    for (ImDrawList *list : drawLists)
+    {
+        releaseVector(list->VtxBuffer);
+        releaseVector(list->IdxBuffer);
+        IM_DELETE(list);
+    }
+    drawLists.clear();
+    frames.clear();
+    mapping.close();
+}
+
+double DrawDataReplay::drawDataBytesPerFrame() const
+{
+    if (frames.empty()) { return 0.0; }
+
+    double bytes = 0.0;
+    for (auto const &frame : frames)
+    {
+        ImDrawData const &drawData = frame->drawData;
+        bytes += drawData.TotalVtxCount * sizeof(ImDrawVert) + drawData.TotalIdxCount * sizeof(ImDrawIdx);
+        for (int n = 0; n < drawData.CmdListsCount; n++)
+        {
+            bytes += drawData.CmdLists[n]->CmdBuffer.Size * sizeof(ImDrawCmd);
+        }
+    }
+    return bytes / frames.size();
+}
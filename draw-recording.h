@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+
+#include <dearimgui/imgui.h>
+
+#include "mapped-file.h"
+
+// Writes Dear ImGui draw data of every frame into a binary file: commands
+// (clip rects, texture IDs, offsets), vertices and indices of every draw list.
+// A draw list whose vertices or indices are the same as in the previous frame
+// only refers to the data written before, so a mostly static UI takes a few
+// hundred bytes per frame. Data is aligned, so replay can use it from a mapping
+class DrawDataRecorder
+{
+public:
+    DrawDataRecorder() = default;
+    ~DrawDataRecorder();
+    DrawDataRecorder(DrawDataRecorder const &) = delete;
+    DrawDataRecorder &operator=(DrawDataRecorder const &) = delete;
+
+    bool open(std::filesystem::path const &path);
+    void close();
+    bool isOpen() const { return file != NULL; }
+
+    // font texture is stored with the frame, so replay can replace it with its own
+    void recordFrame(ImDrawData const *drawData, ImTextureID fontTexture);
+
+    uint64_t frames() const { return framesCount; }
+    uint64_t bytes() const { return position; }
+
+private:
+    struct PreviousList
+    {
+        std::vector<unsigned char> vertices;
+        std::vector<unsigned char> indices;
+        uint64_t verticesOffset = 0;
+        uint64_t indicesOffset = 0;
+    };
+
+    FILE *file = NULL;
+    std::filesystem::path filePath;
+    uint64_t position = 0;
+    uint64_t framesCount = 0;
+    std::vector<PreviousList> previousLists;
+    // the frame is put together here and written at once
+    std::vector<unsigned char> frameBuffer;
+};
+
+// Memory-mapped recording made by DrawDataRecorder. Vertices and indices
+// are used right from the mapping, only commands are decoded on opening
+class DrawDataReplay
+{
+public:
+    DrawDataReplay() = default;
+    ~DrawDataReplay();
+    DrawDataReplay(DrawDataReplay const &) = delete;
+    DrawDataReplay &operator=(DrawDataReplay const &) = delete;
+
+    // recorded font texture is replaced with the given one, other texture IDs are kept
+    bool open(std::filesystem::path const &path, ImTextureID fontTexture);
+    void close();
+
+    int framesCount() const { return static_cast<int>(frames.size()); }
+    ImDrawData *frame(int index) { return &frames[index]->drawData; }
+    size_t fileSize() const { return mapping.size(); }
+    // what renderers go through every frame: vertices, indices and commands
+    double drawDataBytesPerFrame() const;
+
+private:
+    struct Frame
+    {
+        ImDrawData drawData;
+        // before 1.89.8 draw data only points to an array of lists
+        std::vector<ImDrawList *> drawListsPointers;
+    };
+
+    MappedFile mapping;
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::vector<ImDrawList *> drawLists;
+};
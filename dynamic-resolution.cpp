@@ -0,0 +1,179 @@
+#include <cmath>
+#include <algorithm>
+
+#include "dynamic-resolution.h"
+#include "logger.h"
+
+namespace
+{
+    // consecutive measured frames over the budget before the scale drops
+    const int framesToDecrease = 3;
+    // and well within the budget before it grows
+    const int framesToIncrease = 30;
+    // "well within" is below that part of the budget
+    const double headroom = 0.75;
+    const float increaseStep = 0.05f;
+}
+
+bool DynamicResolution::initialize(DynamicResolutionSettings const &resolutionSettings)
+{
+    settings = resolutionSettings;
+    scale = settings.maximumScale;
+    glGenFramebuffers(1, &framebuffer);
+    glGenTextures(1, &colorTexture);
+    glGenRenderbuffers(1, &depthStencil);
+    glGenQueries(queriesInFlight * 2, &queries[0][0]);
+    return framebuffer != 0;
+}
+
+void DynamicResolution::shutdown()
+{
+    if (framebuffer == 0) { return; }
+    glDeleteQueries(queriesInFlight * 2, &queries[0][0]);
+    glDeleteRenderbuffers(1, &depthStencil);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteFramebuffers(1, &framebuffer);
+    framebuffer = colorTexture = depthStencil = 0;
+    targetWidth = targetHeight = 0;
+}
+
+void DynamicResolution::allocate(int width, int height)
+{
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        logError("Scene render target %dx%d is incomplete", width, height);
+    }
+    targetWidth = width;
+    targetHeight = height;
+}
+
+void DynamicResolution::readQueries()
+{
+    // oldest first, so the scale follows the frames in order
+    for (int i = 0; i < queriesInFlight; i++)
+    {
+        int slot = (queryIndex + i) % queriesInFlight;
+        if (!queryPending[slot]) { continue; }
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available != GL_TRUE) { continue; }
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+        queryPending[slot] = false;
+        // frames drawn before the last change say nothing about the current scale
+        bool currentScale = queryScale[slot] == scale;
+        adjustScale((end - start) / 1000000.0, currentScale);
+    }
+}
+
+void DynamicResolution::adjustScale(double sceneMilliseconds, bool currentScale)
+{
+    double budget = settings.budgetMilliseconds;
+    stats.sceneMilliseconds = sceneMilliseconds;
+    if (sceneMilliseconds > budget) { stats.overBudget++; }
+    else { stats.withinBudget++; }
+    if (!currentScale) { return; }
+
+    if (sceneMilliseconds > budget)
+    {
+        framesOver++;
+        framesUnder = 0;
+    }
+    else
+    {
+        framesOver = 0;
+        framesUnder = sceneMilliseconds < budget * headroom ? framesUnder + 1 : 0;
+    }
+
+    float newScale = scale;
+    if (framesOver >= framesToDecrease)
+    {
+        // the cost is proportional to the amount of pixels, and the new scale
+        // aims a bit below the budget, so the next frames don't miss it again
+        double factor = std::sqrt(budget * 0.9 / sceneMilliseconds);
+        newScale = scale * static_cast<float>(std::clamp(factor, 0.7, 0.95));
+    }
+    else if (framesUnder >= framesToIncrease)
+    {
+        newScale = scale + increaseStep;
+    }
+    newScale = std::round(std::clamp(newScale, settings.minimumScale, settings.maximumScale) * 100.0f) / 100.0f;
+    if (newScale != scale)
+    {
+        scale = newScale;
+        stats.scaleChanges++;
+        framesOver = framesUnder = 0;
+    }
+}
+
+void DynamicResolution::beginScene()
+{
+    active = enabled && initialized();
+    if (!active)
+    {
+        stats.scale = 1.0f;
+        return;
+    }
+
+    readQueries();
+    scale = std::clamp(scale, settings.minimumScale, settings.maximumScale);
+
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &outputFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, outputViewport);
+    int requiredWidth = static_cast<int>(std::ceil(outputViewport[2] * settings.maximumScale)),
+        requiredHeight = static_cast<int>(std::ceil(outputViewport[3] * settings.maximumScale));
+    if (requiredWidth != targetWidth || requiredHeight != targetHeight)
+    {
+        allocate(std::max(1, requiredWidth), std::max(1, requiredHeight));
+    }
+    stats.scale = scale;
+    stats.width = std::clamp(static_cast<int>(std::lround(outputViewport[2] * scale)), 1, targetWidth);
+    stats.height = std::clamp(static_cast<int>(std::lround(outputViewport[3] * scale)), 1, targetHeight);
+
+    // GPU is too far behind if the slot is still pending, that frame is just not measured
+    queryPending[queryIndex] = false;
+    queryScale[queryIndex] = scale;
+    glQueryCounter(queries[queryIndex][0], GL_TIMESTAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, stats.width, stats.height);
+}
+
+void DynamicResolution::endScene()
+{
+    if (!active) { return; }
+    active = false;
+
+    glQueryCounter(queries[queryIndex][1], GL_TIMESTAMP);
+    queryPending[queryIndex] = true;
+    queryIndex = (queryIndex + 1) % queriesInFlight;
+
+    // scissor applies to blitting as well
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+    bool sameSize = stats.width == outputViewport[2] && stats.height == outputViewport[3];
+    glBlitFramebuffer(
+        0, 0, stats.width, stats.height,
+        outputViewport[0], outputViewport[1],
+        outputViewport[0] + outputViewport[2], outputViewport[1] + outputViewport[3],
+        GL_COLOR_BUFFER_BIT,
+        sameSize ? GL_NEAREST : GL_LINEAR
+    );
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+    glViewport(outputViewport[0], outputViewport[1], outputViewport[2], outputViewport[3]);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+struct DynamicResolutionSettings
+{
+    // GPU time of the scene to stay within
+    double budgetMilliseconds = 8.0;
+    // of the window size, in each dimension
+    float minimumScale = 0.5f;
+    float maximumScale = 1.0f;
+};
+
+struct DynamicResolutionStatistics
+{
+    float scale = 1.0f;
+    int width = 0;
+    int height = 0;
+    // GPU time of the last measured frame
+    double sceneMilliseconds = 0.0;
+    // measured frames within the budget and over it
+    uint64_t withinBudget = 0;
+    uint64_t overBudget = 0;
+    uint64_t scaleChanges = 0;
+};
+
+// Renders the scene into an offscreen target with a fraction of the window
+// resolution, which is upscaled into the window afterwards, so Dear ImGui
+// still draws at the native resolution. The fraction follows GPU time of the
+// scene (timestamp queries, read a few frames later without waiting): it
+// drops quickly when the scene is over the budget for a few frames, and grows
+// back in small steps only after a longer while well within the budget, so
+// it doesn't jump back and forth around the budget.
+// The target is allocated for the maximum scale, and lower scales only use
+// a part of it, so changing the scale doesn't reallocate anything
+class DynamicResolution
+{
+public:
+    bool initialize(DynamicResolutionSettings const &resolutionSettings);
+    void shutdown();
+    bool initialized() const { return framebuffer != 0; }
+
+    // instead of the current framebuffer, the scene goes into the target
+    // (of the current viewport size times the scale) until endScene()
+    void beginScene();
+    // upscales the scene into the framebuffer that was bound before
+    void endScene();
+
+    DynamicResolutionSettings settings;
+    bool enabled = false;
+
+    DynamicResolutionStatistics const &statistics() const { return stats; }
+
+private:
+    static const int queriesInFlight = 4;
+
+    GLuint framebuffer = 0,
+           colorTexture = 0,
+           depthStencil = 0;
+    int targetWidth = 0,
+        targetHeight = 0;
+    // the framebuffer and the viewport that the scene would have been drawn into
+    GLint outputFramebuffer = 0;
+    GLint outputViewport[4] = {};
+
+    GLuint queries[queriesInFlight][2] = {};
+    bool queryPending[queriesInFlight] = {};
+    // the scale that the frame of the query was drawn with
+    float queryScale[queriesInFlight] = {};
+    int queryIndex = 0;
+    float scale = 1.0f;
+    // between beginScene() and endScene()
+    bool active = false;
+    int framesOver = 0,
+        framesUnder = 0;
+    DynamicResolutionStatistics stats;
+
+    void allocate(int width, int height);
+    void readQueries();
+    void adjustScale(double sceneMilliseconds, bool currentScale);
+};
@@ -0,0 +1,333 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "font-cache.h"
+#include "functions.h"
+#include "logger.h"
+
+// loadAtlas() sets up the font the way ImFontAtlas::Build() would, which depends
+// on Dear ImGui internals checked for 1.87 to 1.91, since 1.92 the cache is unused
+#if IMGUI_VERSION_NUM < 18700
+#error "The font atlas cache is only verified with Dear ImGui 1.87 to 1.91, check loadAtlas() before extending the range"
+#endif
+
+namespace
+{
+    const char atlasMagic[4] = { 'I', 'M', 'F', 'A' };
+    const uint32_t atlasVersion = 2;
+
+    struct AtlasHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t fileSize;
+        int32_t texWidth;
+        int32_t texHeight;
+        float texUvScale[2];
+        float texUvWhitePixel[2];
+        uint32_t texUvLinesCount;
+        uint32_t glyphsCount;
+        float fontSize;
+        float ascent;
+        float descent;
+        // offsets from the beginning of the file
+        uint64_t texUvLinesOffset;
+        uint64_t glyphsOffset;
+        uint64_t rgbaOffset;
+        uint64_t alphaOffset;
+    };
+
+    size_t alignedSize(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // everything that affects the baked atlas, including the layout of Dear ImGui structures,
+    // the font file is identified by its path, size and modification time instead of its contents
+    bool atlasKey(
+        std::filesystem::path const &fontPath,
+        ImFontAtlas const *atlas,
+        float sizePixels,
+        float scale,
+        const ImWchar *glyphRanges,
+        uint64_t &key
+    )
+    {
+        std::error_code error;
+        std::filesystem::path absolutePath = std::filesystem::absolute(fontPath, error);
+        if (error) { return false; }
+        const uint64_t fileSize = std::filesystem::file_size(absolutePath, error);
+        if (error) { return false; }
+        const auto modified = std::filesystem::last_write_time(absolutePath, error);
+        if (error) { return false; }
+        const int64_t modifiedTicks = static_cast<int64_t>(modified.time_since_epoch().count());
+
+        std::string const pathString = absolutePath.string();
+        key = hashBytes(pathString.data(), pathString.size());
+        key = hashBytes(&fileSize, sizeof(fileSize), key);
+        key = hashBytes(&modifiedTicks, sizeof(modifiedTicks), key);
+
+        const int layout[] =
+        {
+            IMGUI_VERSION_NUM,
+            static_cast<int>(sizeof(ImFontGlyph)),
+            static_cast<int>(sizeof(ImWchar)),
+            atlas->Flags,
+            atlas->TexDesiredWidth,
+            atlas->TexGlyphPadding
+        };
+        key = hashBytes(layout, sizeof(layout), key);
+        key = hashBytes(&sizePixels, sizeof(sizePixels), key);
+        key = hashBytes(&scale, sizeof(scale), key);
+
+        // ranges are pairs terminated by zero
+        size_t rangesLength = 0;
+        while (glyphRanges[rangesLength] != 0) { rangesLength++; }
+        return hashBytes(glyphRanges, rangesLength * sizeof(ImWchar), key);
+    }
+}
+
+void FontAtlasCache::setDirectory(std::filesystem::path const &cacheDirectory)
+{
+    directory = cacheDirectory;
+    if (directory.empty()) { return; }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        logWarning(
+            "Couldn't create font cache directory %s: %s",
+            directory.string().c_str(),
+            error.message().c_str()
+        );
+        directory.clear();
+    }
+}
+
+ImFont *FontAtlasCache::addFont(
+    ImFontAtlas *atlas,
+    std::filesystem::path const &fontPath,
+    float sizePixels,
+    float scale,
+    const ImWchar *glyphRanges
+)
+{
+    auto started = std::chrono::steady_clock::now();
+    cacheHit = false;
+    if (glyphRanges == NULL) { glyphRanges = atlas->GetGlyphRangesDefault(); }
+
+    // since 1.92 glyphs are rasterized on demand, so there is no atlas to bake in advance
+#if IMGUI_VERSION_NUM < 19200
+    uint64_t key = 0;
+    bool cacheEnabled = !directory.empty() && atlasKey(fontPath, atlas, sizePixels, scale, glyphRanges, key);
+    std::filesystem::path path;
+    if (cacheEnabled)
+    {
+        std::ostringstream fileName;
+        fileName << fontPath.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0') << key << ".atlas";
+        path = directory / fileName.str();
+
+        ImFont *font = loadAtlas(atlas, path, key);
+        if (font != NULL)
+        {
+            cacheHit = true;
+            buildMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started
+            ).count();
+            logInfo("Font atlas loaded from the cache in %.2f ms", buildMilliseconds);
+            return font;
+        }
+    }
+#endif
+
+    ImFont *font = atlas->AddFontFromFileTTF(
+        fontPath.string().c_str(),
+        sizePixels * scale,
+        NULL,
+        glyphRanges
+    );
+    if (font == NULL) { return NULL; }
+
+#if IMGUI_VERSION_NUM < 19200
+    // building right away to measure it, otherwise the backend would do that anyway
+    unsigned char *pixels = NULL;
+    int width = 0,
+        height = 0;
+    atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    buildMilliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started
+    ).count();
+    logInfo("Font atlas rasterized in %.2f ms", buildMilliseconds);
+
+    if (cacheEnabled && pixels != NULL) { storeAtlas(atlas, font, path, key); }
+#endif
+    return font;
+}
+
+ImFont *FontAtlasCache::loadAtlas(ImFontAtlas *atlas, std::filesystem::path const &path, uint64_t key)
+{
+#if IMGUI_VERSION_NUM < 19200
+    if (!mapping.open(path)) { return NULL; }
+
+    AtlasHeader header;
+    const unsigned char *data = mapping.data();
+    bool valid = mapping.size() >= sizeof(header);
+    if (valid)
+    {
+        std::memcpy(&header, data, sizeof(header));
+        size_t rgbaSize = static_cast<size_t>(header.texWidth) * header.texHeight * 4;
+        valid = std::memcmp(header.magic, atlasMagic, sizeof(atlasMagic)) == 0
+            && header.version == atlasVersion
+            && header.key == key
+            && header.fileSize == mapping.size()
+            && header.texUvLinesCount == static_cast<uint32_t>(IM_ARRAYSIZE(atlas->TexUvLines))
+            && header.texUvLinesOffset + sizeof(atlas->TexUvLines) <= header.fileSize
+            && header.glyphsOffset + header.glyphsCount * sizeof(ImFontGlyph) <= header.fileSize
+            && header.rgbaOffset + rgbaSize <= header.fileSize
+            && header.alphaOffset + rgbaSize / 4 <= header.fileSize;
+    }
+    if (!valid)
+    {
+        logWarning("Font atlas cache entry %s is invalid, rasterizing the font", path.string().c_str());
+        mapping.close();
+        return NULL;
+    }
+
+    // the font has no source data, it only refers to the atlas
+    ImFontConfig config;
+    config.FontData = NULL;
+    config.FontDataOwnedByAtlas = false;
+    config.SizePixels = header.fontSize;
+    std::snprintf(config.Name, sizeof(config.Name), "%s", path.stem().string().c_str());
+    atlas->ConfigData.push_back(config);
+
+    // the texture comes first, AddGlyph() measures the glyphs against it
+    std::memcpy(atlas->TexUvLines, data + header.texUvLinesOffset, sizeof(atlas->TexUvLines));
+    atlas->TexWidth = header.texWidth;
+    atlas->TexHeight = header.texHeight;
+    atlas->TexUvScale = ImVec2(header.texUvScale[0], header.texUvScale[1]);
+    atlas->TexUvWhitePixel = ImVec2(header.texUvWhitePixel[0], header.texUvWhitePixel[1]);
+    // pixels stay in the mapping, Dear ImGui only reads them
+    atlas->TexPixelsRGBA32 = reinterpret_cast<unsigned int *>(const_cast<unsigned char *>(data + header.rgbaOffset));
+    atlas->TexPixelsAlpha8 = const_cast<unsigned char *>(data + header.alphaOffset);
+
+    // what ImFontAtlasBuildSetupFont() sets, the rest is left to the defaults
+    ImFont *font = IM_NEW(ImFont)();
+    atlas->Fonts.push_back(font);
+    font->ContainerAtlas = atlas;
+    font->ConfigData = &atlas->ConfigData.back();
+    font->ConfigDataCount = 1;
+    atlas->ConfigData.back().DstFont = font;
+    font->FontSize = header.fontSize;
+    font->Ascent = header.ascent;
+    font->Descent = header.descent;
+    font->EllipsisChar = config.EllipsisChar;
+
+    // the glyphs were adjusted when they were baked, so they are added without a config
+    std::vector<ImFontGlyph> glyphs(header.glyphsCount);
+    std::memcpy(glyphs.data(), data + header.glyphsOffset, glyphs.size() * sizeof(ImFontGlyph));
+    font->Glyphs.reserve(static_cast<int>(glyphs.size()));
+    for (ImFontGlyph const &glyph : glyphs)
+    {
+        font->AddGlyph(
+            NULL,
+            static_cast<ImWchar>(glyph.Codepoint),
+            glyph.X0, glyph.Y0, glyph.X1, glyph.Y1,
+            glyph.U0, glyph.V0, glyph.U1, glyph.V1,
+            glyph.AdvanceX
+        );
+    }
+
+    // fallback, ellipsis and dot metrics are computed from the glyphs, like after a build
+    font->BuildLookupTable();
+#if IMGUI_VERSION_NUM < 18900
+    // before 1.89 the ellipsis was picked by ImFontAtlasBuildFinish()
+    if (font->EllipsisChar == static_cast<ImWchar>(-1))
+    {
+        const ImWchar ellipsisChars[] = { static_cast<ImWchar>(0x2026), static_cast<ImWchar>(0x0085) };
+        for (ImWchar ellipsisChar : ellipsisChars)
+        {
+            if (font->FindGlyphNoFallback(ellipsisChar) != NULL)
+            {
+                font->EllipsisChar = ellipsisChar;
+                break;
+            }
+        }
+    }
+#endif
+    atlas->TexReady = true;
+    return font;
+#else
+    (void)atlas;
+    (void)path;
+    (void)key;
+    return NULL;
+#endif
+}
+
+void FontAtlasCache::storeAtlas(ImFontAtlas *atlas, ImFont *font, std::filesystem::path const &path, uint64_t key)
+{
+    if (atlas->TexPixelsRGBA32 == NULL || atlas->TexPixelsAlpha8 == NULL) { return; }
+
+    size_t rgbaSize = static_cast<size_t>(atlas->TexWidth) * atlas->TexHeight * 4;
+    size_t glyphsSize = static_cast<size_t>(font->Glyphs.Size) * sizeof(ImFontGlyph);
+
+    AtlasHeader header;
+    std::memcpy(header.magic, atlasMagic, sizeof(atlasMagic));
+    header.version = atlasVersion;
+    header.key = key;
+    header.texWidth = atlas->TexWidth;
+    header.texHeight = atlas->TexHeight;
+    header.texUvScale[0] = atlas->TexUvScale.x;
+    header.texUvScale[1] = atlas->TexUvScale.y;
+    header.texUvWhitePixel[0] = atlas->TexUvWhitePixel.x;
+    header.texUvWhitePixel[1] = atlas->TexUvWhitePixel.y;
+    header.texUvLinesCount = static_cast<uint32_t>(IM_ARRAYSIZE(atlas->TexUvLines));
+    header.glyphsCount = static_cast<uint32_t>(font->Glyphs.Size);
+    header.fontSize = font->FontSize;
+    header.ascent = font->Ascent;
+    header.descent = font->Descent;
+    // pixels are aligned, so they can be used right from the mapping
+    header.texUvLinesOffset = alignedSize(sizeof(header), 16);
+    header.glyphsOffset = alignedSize(header.texUvLinesOffset + sizeof(atlas->TexUvLines), 16);
+    header.rgbaOffset = alignedSize(header.glyphsOffset + glyphsSize, 16);
+    header.alphaOffset = header.rgbaOffset + rgbaSize;
+    header.fileSize = header.alphaOffset + rgbaSize / 4;
+
+    std::string contents(static_cast<size_t>(header.fileSize), '\0');
+    std::memcpy(&contents[0], &header, sizeof(header));
+    std::memcpy(&contents[header.texUvLinesOffset], atlas->TexUvLines, sizeof(atlas->TexUvLines));
+    std::memcpy(&contents[header.glyphsOffset], font->Glyphs.Data, glyphsSize);
+    std::memcpy(&contents[header.rgbaOffset], atlas->TexPixelsRGBA32, rgbaSize);
+    std::memcpy(&contents[header.alphaOffset], atlas->TexPixelsAlpha8, rgbaSize / 4);
+
+    // temporary file first, so another instance never maps a half-written entry
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    std::error_code error;
+    if (writeFile(temporaryPath, contents.data(), contents.size()))
+    {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    else
+    {
+        logWarning("Couldn't write font atlas cache entry %s", path.string().c_str());
+    }
+}
+
+void FontAtlasCache::release(ImFontAtlas *atlas)
+{
+    if (!mapping.isOpen()) { return; }
+
+    // otherwise the atlas would try to free them
+    atlas->TexPixelsRGBA32 = NULL;
+    atlas->TexPixelsAlpha8 = NULL;
+    mapping.close();
+}
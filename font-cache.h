@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+
+#include <dearimgui/imgui.h>
+
+#include "mapped-file.h"
+
+// Saves the baked font atlas (pixels and glyph metrics) into a binary file
+// keyed by the font's path, size and modification time, the font size, scale
+// and glyph ranges. Next time
+// the file is memory-mapped and handed to Dear ImGui as is, so the font
+// is neither read nor rasterized. The atlas points into the mapping,
+// so release() has to be called before the atlas is destroyed
+class FontAtlasCache
+{
+public:
+    // empty directory disables the cache
+    void setDirectory(std::filesystem::path const &cacheDirectory);
+
+    // adds the font to the atlas and builds it, the atlas has to be empty
+    ImFont *addFont(
+        ImFontAtlas *atlas,
+        std::filesystem::path const &fontPath,
+        float sizePixels,
+        float scale,
+        const ImWchar *glyphRanges = NULL
+    );
+    // detaches the atlas from the mapped pixels
+    void release(ImFontAtlas *atlas);
+
+    bool loadedFromCache() const { return cacheHit; }
+    // time spent in addFont()
+    double milliseconds() const { return buildMilliseconds; }
+
+private:
+    std::filesystem::path directory;
+    MappedFile mapping;
+    bool cacheHit = false;
+    double buildMilliseconds = 0.0;
+
+    ImFont *loadAtlas(ImFontAtlas *atlas, std::filesystem::path const &path, uint64_t key);
+    void storeAtlas(ImFontAtlas *atlas, ImFont *font, std::filesystem::path const &path, uint64_t key);
+};
@@ -0,0 +1,124 @@
+#include <thread>
+#include <algorithm>
+
+#include "frame-pacing.h"
+
+void FramePacer::configure(double targetFPS, double refreshRate, bool vsync, bool lateInput)
+{
+    limited = targetFPS > 0.0;
+    if (limited) { framePeriod = std::chrono::duration<double>(1.0 / targetFPS); }
+    else if (vsync && refreshRate > 0.0) { framePeriod = std::chrono::duration<double>(1.0 / refreshRate); }
+    else { framePeriod = std::chrono::duration<double>(0.0); }
+
+    // without a deadline there is nothing to wait for
+    this->lateInput = lateInput && framePeriod.count() > 0.0;
+    frameStarted = Clock::now();
+    lastSwap = frameStarted;
+}
+
+double FramePacer::workEstimate() const
+{
+    return *std::max_element(recentWork.begin(), recentWork.end()) * 1000.0;
+}
+
+void FramePacer::sleepUntil(Clock::time_point deadline)
+{
+    // sleeping overshoots, so it stops short of the deadline
+    auto spinTime = std::chrono::duration<double>(sleepOvershoot * 1.5);
+    auto now = Clock::now();
+    if (deadline - now > spinTime)
+    {
+        auto sleepDuration = std::chrono::duration_cast<Clock::duration>(deadline - now - spinTime);
+        std::this_thread::sleep_for(sleepDuration);
+        double overshoot = std::chrono::duration<double>(Clock::now() - now - sleepDuration).count();
+        // grows right away, but shrinks slowly
+        sleepOvershoot = std::clamp(std::max(overshoot, sleepOvershoot * 0.99), 0.0002, 0.004);
+    }
+    while (Clock::now() < deadline) { std::this_thread::yield(); }
+}
+
+void FramePacer::waitForFrameStart()
+{
+    if (lateInput)
+    {
+        // whatever is left until the deadline minus the time a frame takes
+        // (with a bit of margin, missing the deadline costs a whole frame)
+        auto work = std::chrono::duration<double>(
+            *std::max_element(recentWork.begin(), recentWork.end()) * 1.2 + 0.0005
+        );
+        auto deadline = lastSwap + std::chrono::duration_cast<Clock::duration>(framePeriod);
+        sleepUntil(deadline - std::chrono::duration_cast<Clock::duration>(work));
+    }
+    else if (limited)
+    {
+        sleepUntil(frameStarted + std::chrono::duration_cast<Clock::duration>(framePeriod));
+    }
+    frameStarted = Clock::now();
+}
+
+void FramePacer::eventsReceived()
+{
+    // otherwise the time spent sleeping would count as frame work
+    frameStarted = Clock::now();
+}
+
+void FramePacer::swapStarted()
+{
+    recentWork[recentWorkIndex] = std::chrono::duration<double>(Clock::now() - frameStarted).count();
+    recentWorkIndex = (recentWorkIndex + 1) % recentWork.size();
+}
+
+void FramePacer::frameSwapped()
+{
+    auto now = Clock::now();
+    // a missed deadline shouldn't make the next frame start late as well
+    auto period = std::chrono::duration_cast<Clock::duration>(framePeriod);
+    if (lateInput && limited && now - lastSwap < period * 2) { lastSwap += period; }
+    else { lastSwap = now; }
+}
+
+void LatencyMeter::inputReceived()
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    pendingInputs.push_back(Clock::now());
+}
+
+void LatencyMeter::frameSubmitted()
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    submittedInputs.emplace_back();
+    submittedInputs.back().swap(pendingInputs);
+}
+
+void LatencyMeter::frameSwapped()
+{
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    if (submittedInputs.empty()) { return; }
+
+    for (auto const &received : submittedInputs.front())
+    {
+        double latency = std::chrono::duration<double, std::milli>(now - received).count();
+        if (samples.size() < samplesCount) { samples.push_back(latency); }
+        else { samples[nextSample] = latency; }
+        nextSample = (nextSample + 1) % samplesCount;
+        measuredInputs++;
+    }
+    submittedInputs.pop_front();
+}
+
+TimingStatistics LatencyMeter::statistics()
+{
+    std::vector<double> recentSamples;
+    {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        recentSamples = samples;
+    }
+    return calculateTimingStatistics(recentSamples);
+}
+
+uint64_t LatencyMeter::measured()
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    return measuredInputs;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+
+#include "statistics.h"
+
+// Frame limiter and late input sampling. The limiter sleeps most of the time
+// until the next frame and spins for the last bit, as sleeping alone often
+// overshoots by a millisecond or more. With late input sampling the loop
+// doesn't poll events right after the swap, but waits until just enough
+// time is left to build and submit the frame before its deadline, so the frame
+// shows input that is as fresh as possible
+class FramePacer
+{
+public:
+    // targetFPS = 0 means no limiter, refreshRate is used for the deadline with VSync
+    void configure(double targetFPS, double refreshRate, bool vsync, bool lateInput);
+
+    // sleeps (and spins) until it's time to sample input for the next frame
+    void waitForFrameStart();
+    // after sleeping until there are events, the frame starts only now
+    void eventsReceived();
+    // right before the swap, to know how long a frame takes to build
+    void swapStarted();
+    // right after the swap returns
+    void frameSwapped();
+
+    bool lateInput = false;
+    // time from sampling input to swapping, in milliseconds (recent maximum)
+    double workEstimate() const;
+    double period() const { return framePeriod.count() * 1000.0; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    std::chrono::duration<double> framePeriod{0.0};
+    bool limited = false;
+    Clock::time_point frameStarted,
+                      lastSwap;
+    // frame work durations of recent frames, in seconds
+    std::vector<double> recentWork = std::vector<double>(32, 0.0);
+    size_t recentWorkIndex = 0;
+    // how much sleeping overshoots, the limiter spins for that long
+    double sleepOvershoot = 0.001;
+
+    void sleepUntil(Clock::time_point deadline);
+};
+
+// Input-to-swap latency: every GLFW input callback is timestamped,
+// and once the frame with that input is swapped, the difference is recorded
+class LatencyMeter
+{
+public:
+    static const size_t samplesCount = 4096;
+
+    // from input callbacks
+    void inputReceived();
+    // inputs received so far go into this frame
+    void frameSubmitted();
+    // can be called from another thread (pipelined mode)
+    void frameSwapped();
+
+    // in milliseconds, over the recent samples
+    TimingStatistics statistics();
+    uint64_t measured();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    std::mutex samplesMutex;
+    std::vector<Clock::time_point> pendingInputs;
+    std::deque<std::vector<Clock::time_point>> submittedInputs;
+    std::vector<double> samples;
+    size_t nextSample = 0;
+    uint64_t measuredInputs = 0;
+};
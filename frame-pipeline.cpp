@@ -0,0 +1,173 @@
+#include <cstring>
+#include <chrono>
+
+#include "frame-pipeline.h"
+
+namespace
+{
+    // resize() keeps the capacity, unlike the assignment operator
+    template<typename T>
+    void copyVector(ImVector<T> &destination, ImVector<T> const &source)
+    {
+        destination.resize(source.Size);
+        if (source.Size > 0)
+        {
+            std::memcpy(destination.Data, source.Data, static_cast<size_t>(source.Size) * sizeof(T));
+        }
+    }
+}
+
+DrawDataSnapshot::~DrawDataSnapshot()
+{
+    for (ImDrawList *drawList : drawLists) { IM_DELETE(drawList); }
+}
+
+void DrawDataSnapshot::copy(ImDrawData const *source)
+{
+    while (drawLists.size() < static_cast<size_t>(source->CmdListsCount))
+    {
+        drawLists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    }
+
+    // only what renderers use: commands, indices and vertices
+    for (int n = 0; n < source->CmdListsCount; n++)
+    {
+        ImDrawList const *sourceList = source->CmdLists[n];
+        ImDrawList *drawList = drawLists[n];
+        copyVector(drawList->CmdBuffer, sourceList->CmdBuffer);
+        copyVector(drawList->IdxBuffer, sourceList->IdxBuffer);
+        copyVector(drawList->VtxBuffer, sourceList->VtxBuffer);
+        drawList->Flags = sourceList->Flags;
+    }
+
+    snapshot.Valid = source->Valid;
+    snapshot.CmdListsCount = source->CmdListsCount;
+    snapshot.TotalIdxCount = source->TotalIdxCount;
+    snapshot.TotalVtxCount = source->TotalVtxCount;
+    snapshot.DisplayPos = source->DisplayPos;
+    snapshot.DisplaySize = source->DisplaySize;
+    snapshot.FramebufferScale = source->FramebufferScale;
+#if IMGUI_VERSION_NUM >= 18980
+    snapshot.CmdLists.resize(source->CmdListsCount);
+    for (int n = 0; n < source->CmdListsCount; n++) { snapshot.CmdLists[n] = drawLists[n]; }
+#else
+    drawListsPointers.assign(drawLists.begin(), drawLists.begin() + source->CmdListsCount);
+    snapshot.CmdLists = drawListsPointers.data();
+#endif
+}
+
+bool FramePipeline::start(
+    int depth,
+    std::function<void()> const &attachContext,
+    std::function<void()> const &detachContext,
+    std::function<void(ImDrawData *)> const &renderFrame
+)
+{
+    if (running() || depth < 1) { return false; }
+
+    attach = attachContext;
+    detach = detachContext;
+    render = renderFrame;
+    stopping = false;
+    frames.clear();
+    freeFrames.clear();
+    queuedFrames.clear();
+    for (int f = 0; f < depth; f++)
+    {
+        frames.push_back(std::make_unique<QueuedFrame>());
+        freeFrames.push_back(frames.back().get());
+    }
+
+    renderThread = std::thread(&FramePipeline::renderLoop, this);
+    return true;
+}
+
+void FramePipeline::stop()
+{
+    if (!running()) { return; }
+
+    {
+        std::lock_guard<std::mutex> lock(framesMutex);
+        stopping = true;
+    }
+    frameQueued.notify_one();
+    renderThread.join();
+}
+
+void FramePipeline::enqueueCommand(std::function<void()> command)
+{
+    pendingCommands.push_back(std::move(command));
+}
+
+void FramePipeline::submit(ImDrawData const *drawData)
+{
+    QueuedFrame *frame = NULL;
+    {
+        std::unique_lock<std::mutex> lock(framesMutex);
+        if (freeFrames.empty())
+        {
+            auto blocked = std::chrono::steady_clock::now();
+            frameFreed.wait(lock, [this]() { return !freeFrames.empty(); });
+            blockedTime += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - blocked
+            ).count();
+        }
+        frame = freeFrames.front();
+        freeFrames.pop_front();
+    }
+
+    // copying happens outside of the lock, the render thread doesn't touch free frames
+    frame->drawData.copy(drawData);
+    frame->commands.swap(pendingCommands);
+    pendingCommands.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(framesMutex);
+        queuedFrames.push_back(frame);
+        submitted++;
+    }
+    frameQueued.notify_one();
+}
+
+void FramePipeline::drain()
+{
+    std::unique_lock<std::mutex> lock(framesMutex);
+    frameFreed.wait(lock, [this]() { return queuedFrames.empty() && freeFrames.size() == frames.size(); });
+}
+
+uint64_t FramePipeline::renderedFrames()
+{
+    std::lock_guard<std::mutex> lock(framesMutex);
+    return rendered;
+}
+
+void FramePipeline::renderLoop()
+{
+    attach();
+
+    while (true)
+    {
+        QueuedFrame *frame = NULL;
+        {
+            std::unique_lock<std::mutex> lock(framesMutex);
+            frameQueued.wait(lock, [this]() { return stopping || !queuedFrames.empty(); });
+            // frames that are already queued still get rendered
+            if (queuedFrames.empty()) { break; }
+            frame = queuedFrames.front();
+            queuedFrames.pop_front();
+        }
+
+        for (auto &command : frame->commands) { command(); }
+        frame->commands.clear();
+        render(frame->drawData.drawData());
+
+        {
+            std::lock_guard<std::mutex> lock(framesMutex);
+            freeFrames.push_back(frame);
+            rendered++;
+        }
+        frameFreed.notify_all();
+    }
+
+    detach();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+#include <dearimgui/imgui.h>
+
+// Deep copy of Dear ImGui draw data. Draw lists are kept between frames,
+// so once their buffers have grown enough, copying doesn't allocate
+class DrawDataSnapshot
+{
+public:
+    DrawDataSnapshot() = default;
+    ~DrawDataSnapshot();
+    DrawDataSnapshot(DrawDataSnapshot const &) = delete;
+    DrawDataSnapshot &operator=(DrawDataSnapshot const &) = delete;
+
+    void copy(ImDrawData const *source);
+    ImDrawData *drawData() { return &snapshot; }
+
+private:
+    ImDrawData snapshot;
+    std::vector<ImDrawList *> drawLists;
+    // before 1.89.8 draw data only points to an array of lists
+    std::vector<ImDrawList *> drawListsPointers;
+};
+
+// Pipelined rendering: the main thread polls events and builds the UI,
+// and a render thread (which owns the GL context) submits and swaps the frames.
+// The queue between them is bounded, so the UI is never more than depth frames
+// ahead of what is on the screen
+class FramePipeline
+{
+public:
+    // render thread attaches and detaches the context itself,
+    // renderFrame() is called on it for every submitted frame (and has to swap)
+    bool start(
+        int depth,
+        std::function<void()> const &attachContext,
+        std::function<void()> const &detachContext,
+        std::function<void(ImDrawData *)> const &renderFrame
+    );
+    // renders whatever is still queued and joins the render thread
+    void stop();
+    bool running() const { return renderThread.joinable(); }
+
+    // to be run on the render thread right before the next submitted frame,
+    // that is how the UI changes GL state
+    void enqueueCommand(std::function<void()> command);
+    bool hasPendingCommands() const { return !pendingCommands.empty(); }
+
+    // copies the draw data, blocks if there are already depth frames in the queue
+    void submit(ImDrawData const *drawData);
+    // blocks until everything submitted is rendered
+    void drain();
+
+    uint64_t submittedFrames() const { return submitted; }
+    uint64_t renderedFrames();
+    // how long the UI thread was blocked by the full queue
+    double blockedMilliseconds() const { return blockedTime; }
+
+private:
+    struct QueuedFrame
+    {
+        DrawDataSnapshot drawData;
+        std::vector<std::function<void()>> commands;
+    };
+
+    std::vector<std::unique_ptr<QueuedFrame>> frames;
+    std::deque<QueuedFrame *> freeFrames,
+                              queuedFrames;
+    std::vector<std::function<void()>> pendingCommands;
+    std::mutex framesMutex;
+    std::condition_variable frameFreed,
+                            frameQueued;
+    std::thread renderThread;
+    std::function<void()> attach,
+                          detach;
+    std::function<void(ImDrawData *)> render;
+    bool stopping = false;
+    uint64_t submitted = 0,
+             rendered = 0;
+    double blockedTime = 0.0;
+
+    void renderLoop();
+};
@@ -1,8 +1,15 @@
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <cstring>
+#include <fstream>
+
 #include "functions.h"
 
-std::string currentTime(std::chrono::time_point<std::chrono::system_clock> now)
+size_t TimestampFormatter::format(
+    std::chrono::time_point<std::chrono::system_clock> now,
+    bool withMilliseconds,
+    char *buffer
+)
 {
     // you need to get milliseconds explicitly
     auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -11,12 +18,46 @@ std::string currentTime(std::chrono::time_point<std::chrono::system_clock> now)
     // and that's a "normal" point of time with seconds
     auto timeNow = std::chrono::system_clock::to_time_t(now);
 
-    std::ostringstream currentTimeStream;
-    currentTimeStream << std::put_time(localtime(&timeNow), "%d.%m.%Y %H:%M:%S")
-                      << "." << std::setfill('0') << std::setw(3) << milliseconds.count()
-                      << " " << std::put_time(localtime(&timeNow), "%z");
+    // date, time and timezone only change once a second
+    if (timeNow != cachedSecond)
+    {
+        std::tm localTime;
+#ifdef _WIN32
+        localtime_s(&localTime, &timeNow);
+#else
+        localtime_r(&timeNow, &localTime);
+#endif
+        prefixLength = std::strftime(prefix, sizeof(prefix), "%d.%m.%Y %H:%M:%S", &localTime);
+        zoneLength = std::strftime(zone, sizeof(zone), " %z", &localTime);
+        cachedSecond = timeNow;
+    }
 
-    return currentTimeStream.str();
+    size_t length = prefixLength;
+    std::memcpy(buffer, prefix, prefixLength);
+    if (withMilliseconds)
+    {
+        int ms = static_cast<int>(milliseconds.count());
+        buffer[length++] = '.';
+        buffer[length++] = static_cast<char>('0' + ms / 100);
+        buffer[length++] = static_cast<char>('0' + ms / 10 % 10);
+        buffer[length++] = static_cast<char>('0' + ms % 10);
+    }
+    std::memcpy(buffer + length, zone, zoneLength);
+    length += zoneLength;
+    buffer[length] = '\0';
+
+    return length;
+}
+
+std::string currentTime(
+    std::chrono::time_point<std::chrono::system_clock> now,
+    bool withMilliseconds
+)
+{
+    thread_local TimestampFormatter formatter;
+    char buffer[timestampMaxLength];
+    size_t length = formatter.format(now, withMilliseconds, buffer);
+    return std::string(buffer, length);
 }
 
 bool endsWith(std::string const &originalString, std::string const &ending)
@@ -36,3 +77,69 @@ bool endsWith(std::string const &originalString, std::string const &ending)
         return false;
     }
 }
+
+bool readFile(std::filesystem::path const &path, std::string &contents)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) { return false; }
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    contents.resize(static_cast<size_t>(size));
+    return size == 0 || static_cast<bool>(file.read(&contents[0], size));
+}
+
+bool writeFile(std::filesystem::path const &path, const void *data, size_t size)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) { return false; }
+
+    file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    return static_cast<bool>(file);
+}
+
+namespace
+{
+    inline uint64_t rotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // finalizer from MurmurHash3, so every input bit affects every output bit
+    inline uint64_t avalanche(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL,
+                   prime2 = 0xC2B2AE3D27D4EB4FULL;
+
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed ^ (static_cast<uint64_t>(size) * prime1);
+
+    while (size >= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash ^= rotateLeft(word * prime2, 31) * prime1;
+        hash = rotateLeft(hash, 27) * prime1 + prime2;
+        bytes += 8;
+        size -= 8;
+    }
+    if (size > 0)
+    {
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes, size);
+        hash ^= rotateLeft(tail * prime2, 31) * prime1;
+    }
+
+    return avalanche(hash);
+}
@@ -1,14 +1,53 @@
+#pragma once
+
 #include <iostream>
 #include <sstream>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+// including the terminating zero
+const size_t timestampMaxLength = 48;
+
+// Formats timestamps as "dd.mm.yyyy HH:MM:SS.mmm +zzzz" without allocations.
+// Date, time and timezone are cached and only rendered again when
+// the second changes, so most of the calls just add milliseconds
+class TimestampFormatter
+{
+public:
+    // buffer has to be at least timestampMaxLength, returns the length
+    size_t format(
+        std::chrono::time_point<std::chrono::system_clock> now,
+        bool withMilliseconds,
+        char *buffer
+    );
 
-std::string currentTime(std::chrono::time_point<std::chrono::system_clock> now);
+private:
+    std::time_t cachedSecond = -1;
+    char prefix[32] = {};
+    size_t prefixLength = 0;
+    char zone[12] = {};
+    size_t zoneLength = 0;
+};
+
+std::string currentTime(
+    std::chrono::time_point<std::chrono::system_clock> now,
+    bool withMilliseconds = true
+);
 
 bool endsWith(std::string const &originalString, std::string const &ending);
 
+// reads the whole file, returns false if it can't be opened
+bool readFile(std::filesystem::path const &path, std::string &contents);
+bool writeFile(std::filesystem::path const &path, const void *data, size_t size);
+
+// fast non-cryptographic hash, goes through the data 8 bytes at a time
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
+
 static auto vector_getter = [](void *vec, int idx, const char **out_text)
 {
     auto &vector = *static_cast<std::vector<std::string> *>(vec);
@@ -0,0 +1,187 @@
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "headless.h"
+#include "logger.h"
+
+namespace
+{
+#ifdef HEADLESS_EGL
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLContext eglContext = EGL_NO_CONTEXT;
+#endif
+    GLuint framebuffer = 0,
+           colorRenderbuffer = 0,
+           depthStencilRenderbuffer = 0;
+    int framebufferWidth = 0,
+        framebufferHeight = 0;
+}
+
+bool initializeHeadlessContext()
+{
+#ifdef HEADLESS_EGL
+    // surfaceless platform doesn't need X11/Wayland or even a GPU,
+    // but if it's not there, then let EGL pick whatever it has
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT")
+    );
+    if (getPlatformDisplay != NULL)
+    {
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (eglDisplay == EGL_NO_DISPLAY)
+    {
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor))
+    {
+        logError("Couldn't initialize EGL display");
+        return false;
+    }
+    const char *vendor = eglQueryString(eglDisplay, EGL_VENDOR);
+    logInfo("EGL %d.%d, vendor: %s", eglMajor, eglMinor, vendor != NULL ? vendor : "unknown");
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        logError("EGL doesn't support desktop OpenGL");
+        return false;
+    }
+
+    const EGLint configAttributes[] =
+    {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint configsCount = 0;
+    eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configsCount);
+    if (configsCount == 0) { config = EGL_NO_CONFIG_KHR; }
+
+    // same version as the one requested from GLFW on Linux
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        logError("Couldn't create EGL context, error: %d", eglGetError());
+        return false;
+    }
+
+    // no surface, everything goes into our own framebuffer
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        logError("Couldn't make EGL context current (no surfaceless support?)");
+        return false;
+    }
+
+    logInfo("Headless EGL context created");
+    return true;
+#else
+    logError("Headless mode is not available in this build");
+    return false;
+#endif
+}
+
+bool makeHeadlessContextCurrent(bool current)
+{
+#ifdef HEADLESS_EGL
+    return eglMakeCurrent(
+        eglDisplay,
+        EGL_NO_SURFACE,
+        EGL_NO_SURFACE,
+        current ? eglContext : EGL_NO_CONTEXT
+    ) == EGL_TRUE;
+#else
+    (void)current;
+    return false;
+#endif
+}
+
+GLADloadproc headlessProcAddressLoader()
+{
+#ifdef HEADLESS_EGL
+    return reinterpret_cast<GLADloadproc>(eglGetProcAddress);
+#else
+    return NULL;
+#endif
+}
+
+bool initializeHeadlessFramebuffer(int width, int height)
+{
+    framebufferWidth = width;
+    framebufferHeight = height;
+
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    // same depth/stencil bits as the window hints
+    glGenRenderbuffers(1, &depthStencilRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthStencilRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilRenderbuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        logError("Headless framebuffer is not complete");
+        return false;
+    }
+
+    bindHeadlessFramebuffer();
+    logInfo("Headless framebuffer: %dx%d", width, height);
+    return true;
+}
+
+void bindHeadlessFramebuffer()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+}
+
+void resizeHeadlessFramebuffer(int width, int height)
+{
+    if (width == framebufferWidth && height == framebufferHeight) { return; }
+
+    framebufferWidth = width;
+    framebufferHeight = height;
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthStencilRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    bindHeadlessFramebuffer();
+}
+
+void teardownHeadless()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthStencilRenderbuffer);
+        framebuffer = 0;
+    }
+#ifdef HEADLESS_EGL
+    if (eglDisplay != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (eglContext != EGL_NO_CONTEXT) { eglDestroyContext(eglDisplay, eglContext); }
+        eglTerminate(eglDisplay);
+        eglContext = EGL_NO_CONTEXT;
+        eglDisplay = EGL_NO_DISPLAY;
+    }
+#endif
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Headless mode renders into a framebuffer object with an EGL context
+// that has no surface at all, so it works on machines without a display
+// (with Mesa llvmpipe, for instance). It is only available on Linux,
+// on other platforms initializeHeadlessContext() just fails
+
+bool initializeHeadlessContext();
+// binds the context to the calling thread or releases it
+bool makeHeadlessContextCurrent(bool current);
+// to be passed to glad
+GLADloadproc headlessProcAddressLoader();
+// needs glad to be already initialized
+bool initializeHeadlessFramebuffer(int width, int height);
+void bindHeadlessFramebuffer();
+// reallocates the framebuffer storage, like resizing a window would
+void resizeHeadlessFramebuffer(int width, int height);
+void teardownHeadless();
@@ -0,0 +1,281 @@
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cctype>
+
+#include "image-decoder.h"
+#include "mapped-file.h"
+#include "functions.h"
+#include "logger.h"
+
+namespace
+{
+    // the biggest texture any driver would take anyway
+    const int maximumDimension = 16384;
+
+    bool validDimensions(int width, int height)
+    {
+        return width > 0 && height > 0 && width <= maximumDimension && height <= maximumDimension;
+    }
+
+    uint16_t readU16(const unsigned char *data)
+    {
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t readU32(const unsigned char *data)
+    {
+        return static_cast<uint32_t>(data[0] | (data[1] << 8) | (data[2] << 16)) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    // roughly as expensive per pixel as decoding a compressed file
+    bool generateImage(std::string const &description, DecodedImage &image)
+    {
+        int width = 0, height = 0;
+        unsigned int seed = 0;
+        if (std::sscanf(description.c_str(), "%dx%d:%u", &width, &height, &seed) < 2) { return false; }
+        if (!validDimensions(width, height)) { return false; }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        float hue = (seed % 12) / 12.0f * 6.2831853f;
+        float red = 0.5f + 0.5f * std::cos(hue),
+              green = 0.5f + 0.5f * std::cos(hue + 2.0943951f),
+              blue = 0.5f + 0.5f * std::cos(hue + 4.1887902f);
+        for (int y = 0; y < height; y++)
+        {
+            unsigned char *row = image.pixels.data() + static_cast<size_t>(y) * width * 4;
+            for (int x = 0; x < width; x++)
+            {
+                float u = static_cast<float>(x) / width,
+                      v = static_cast<float>(y) / height;
+                float rings = 0.5f + 0.5f * std::sin((u * u + v * v) * 40.0f + seed);
+                bool checker = ((x / 64) + (y / 64)) % 2 == 0;
+                float shade = checker ? rings : rings * 0.6f;
+                row[x * 4 + 0] = static_cast<unsigned char>(255.0f * red * shade);
+                row[x * 4 + 1] = static_cast<unsigned char>(255.0f * green * shade);
+                row[x * 4 + 2] = static_cast<unsigned char>(255.0f * blue * shade);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        return true;
+    }
+
+    // whitespace and comments between header fields
+    bool readPnmNumber(const unsigned char *data, size_t size, size_t &offset, int &value)
+    {
+        while (offset < size && (std::isspace(data[offset]) || data[offset] == '#'))
+        {
+            if (data[offset] == '#') { while (offset < size && data[offset] != '\n') { offset++; } }
+            else { offset++; }
+        }
+        if (offset >= size || !std::isdigit(data[offset])) { return false; }
+        value = 0;
+        while (offset < size && std::isdigit(data[offset]) && value <= maximumDimension * 4)
+        {
+            value = value * 10 + (data[offset++] - '0');
+        }
+        return true;
+    }
+
+    bool decodePnm(const unsigned char *data, size_t size, DecodedImage &image)
+    {
+        if (size < 2 || data[0] != 'P' || (data[1] != '6' && data[1] != '5')) { return false; }
+        int channels = data[1] == '6' ? 3 : 1;
+        size_t offset = 2;
+        int width = 0, height = 0, maximum = 0;
+        if (
+            !readPnmNumber(data, size, offset, width)
+            || !readPnmNumber(data, size, offset, height)
+            || !readPnmNumber(data, size, offset, maximum)
+            || !validDimensions(width, height)
+            || maximum != 255
+        )
+        {
+            return false;
+        }
+        // exactly one whitespace character before the pixels
+        offset++;
+        size_t pixelsCount = static_cast<size_t>(width) * height;
+        if (offset + pixelsCount * channels > size) { return false; }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(pixelsCount * 4);
+        const unsigned char *source = data + offset;
+        unsigned char *destination = image.pixels.data();
+        for (size_t i = 0; i < pixelsCount; i++, source += channels, destination += 4)
+        {
+            destination[0] = source[0];
+            destination[1] = source[channels == 3 ? 1 : 0];
+            destination[2] = source[channels == 3 ? 2 : 0];
+            destination[3] = 255;
+        }
+        return true;
+    }
+
+    bool decodeBmp(const unsigned char *data, size_t size, DecodedImage &image)
+    {
+        if (size < 54 || data[0] != 'B' || data[1] != 'M') { return false; }
+        uint32_t pixelsOffset = readU32(data + 10);
+        int32_t width = static_cast<int32_t>(readU32(data + 18)),
+                height = static_cast<int32_t>(readU32(data + 22));
+        uint16_t bitsPerPixel = readU16(data + 28);
+        uint32_t compression = readU32(data + 30);
+        // BI_RGB, or BI_BITFIELDS with the usual BGRA masks
+        bool topDown = height < 0;
+        if (topDown) { height = -height; }
+        if (
+            !validDimensions(width, height)
+            || (bitsPerPixel != 24 && bitsPerPixel != 32)
+            || (compression != 0 && !(compression == 3 && bitsPerPixel == 32))
+        )
+        {
+            return false;
+        }
+
+        int bytesPerPixel = bitsPerPixel / 8;
+        size_t stride = (static_cast<size_t>(width) * bytesPerPixel + 3) / 4 * 4;
+        if (pixelsOffset + stride * height > size) { return false; }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned char *source = data + pixelsOffset + stride * (topDown ? y : height - 1 - y);
+            unsigned char *destination = image.pixels.data() + static_cast<size_t>(y) * width * 4;
+            for (int x = 0; x < width; x++, source += bytesPerPixel, destination += 4)
+            {
+                destination[0] = source[2];
+                destination[1] = source[1];
+                destination[2] = source[0];
+                destination[3] = bytesPerPixel == 4 ? source[3] : 255;
+            }
+        }
+        // 32-bit files often have zero alpha everywhere, which means no alpha
+        if (bytesPerPixel == 4)
+        {
+            bool transparent = true;
+            for (size_t i = 3; i < image.pixels.size() && transparent; i += 4) { transparent = image.pixels[i] == 0; }
+            if (transparent) { for (size_t i = 3; i < image.pixels.size(); i += 4) { image.pixels[i] = 255; } }
+        }
+        return true;
+    }
+
+    bool decodeTga(const unsigned char *data, size_t size, DecodedImage &image)
+    {
+        if (size < 18) { return false; }
+        uint8_t idLength = data[0],
+                colorMapType = data[1],
+                imageType = data[2];
+        int width = readU16(data + 12),
+            height = readU16(data + 14);
+        uint8_t bitsPerPixel = data[16],
+                descriptor = data[17];
+        bool rle = imageType == 10 || imageType == 11;
+        bool grayscale = imageType == 3 || imageType == 11;
+        int bytesPerPixel = bitsPerPixel / 8;
+        if (
+            colorMapType != 0
+            || (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11)
+            || !validDimensions(width, height)
+            || (grayscale ? bitsPerPixel != 8 : (bitsPerPixel != 24 && bitsPerPixel != 32))
+        )
+        {
+            return false;
+        }
+
+        size_t pixelsCount = static_cast<size_t>(width) * height;
+        image.width = width;
+        image.height = height;
+        image.pixels.resize(pixelsCount * 4);
+        auto convert = [bytesPerPixel](const unsigned char *source, unsigned char *destination)
+        {
+            if (bytesPerPixel == 1)
+            {
+                destination[0] = destination[1] = destination[2] = source[0];
+                destination[3] = 255;
+                return;
+            }
+            destination[0] = source[2];
+            destination[1] = source[1];
+            destination[2] = source[0];
+            destination[3] = bytesPerPixel == 4 ? source[3] : 255;
+        };
+
+        // pixels are decoded in the file order, rows are flipped afterwards
+        size_t offset = 18 + idLength;
+        size_t pixel = 0;
+        while (pixel < pixelsCount)
+        {
+            size_t count = 1;
+            bool repeated = false;
+            if (rle)
+            {
+                if (offset >= size) { return false; }
+                uint8_t packet = data[offset++];
+                count = (packet & 0x7f) + 1;
+                repeated = (packet & 0x80) != 0;
+            }
+            if (pixel + count > pixelsCount) { return false; }
+            size_t needed = repeated ? bytesPerPixel : count * bytesPerPixel;
+            if (offset + needed > size) { return false; }
+            for (size_t i = 0; i < count; i++, pixel++)
+            {
+                convert(data + offset + (repeated ? 0 : i * bytesPerPixel), image.pixels.data() + pixel * 4);
+            }
+            offset += needed;
+        }
+
+        // bottom-up unless bit 5 of the descriptor says otherwise
+        if ((descriptor & 0x20) == 0)
+        {
+            size_t stride = static_cast<size_t>(width) * 4;
+            std::vector<unsigned char> row(stride);
+            for (int y = 0; y < height / 2; y++)
+            {
+                unsigned char *top = image.pixels.data() + stride * y,
+                              *bottom = image.pixels.data() + stride * (height - 1 - y);
+                std::memcpy(row.data(), top, stride);
+                std::memcpy(top, bottom, stride);
+                std::memcpy(bottom, row.data(), stride);
+            }
+        }
+        return true;
+    }
+}
+
+bool decodeImage(std::string const &path, DecodedImage &image)
+{
+    const std::string generatedPrefix = "generated:";
+    if (path.compare(0, generatedPrefix.size(), generatedPrefix) == 0)
+    {
+        return generateImage(path.substr(generatedPrefix.size()), image);
+    }
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        logWarning("Couldn't open image %s", path.c_str());
+        return false;
+    }
+
+    bool decoded = false;
+    if (endsWith(path, ".ppm") || endsWith(path, ".pgm") || endsWith(path, ".pnm"))
+    {
+        decoded = decodePnm(file.data(), file.size(), image);
+    }
+    else if (endsWith(path, ".bmp"))
+    {
+        decoded = decodeBmp(file.data(), file.size(), image);
+    }
+    else if (endsWith(path, ".tga"))
+    {
+        decoded = decodeTga(file.data(), file.size(), image);
+    }
+    if (!decoded) { logWarning("Couldn't decode image %s (unsupported or broken)", path.c_str()); }
+    return decoded;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// RGBA8, rows top to bottom
+struct DecodedImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// Decodes binary PPM/PGM (P6/P5), BMP (uncompressed 24/32-bit) and TGA
+// (uncompressed or RLE, 24/32-bit color and 8-bit grayscale) without any
+// dependencies. "generated:WIDTHxHEIGHT[:SEED]" is a procedural image,
+// to try the texture streaming without any files
+bool decodeImage(std::string const &path, DecodedImage &image);
@@ -0,0 +1,288 @@
+#include <cstring>
+#include <cstdint>
+
+#include "imgui-renderer.h"
+
+namespace
+{
+    const size_t initialPartitionSize = 1024 * 1024;
+    // indices follow vertices in the same partition
+    const size_t indicesAlignment = 16;
+
+    const GLuint positionLocation = 0,
+                 uvLocation = 1,
+                 colorLocation = 2;
+
+    const char *vertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in vec2 Position;\n"
+        "layout (location = 1) in vec2 UV;\n"
+        "layout (location = 2) in vec4 Color;\n"
+        "uniform mat4 ProjMtx;\n"
+        "out vec2 Frag_UV;\n"
+        "out vec4 Frag_Color;\n"
+        "void main()\n"
+        "{\n"
+        "   Frag_UV = UV;\n"
+        "   Frag_Color = Color;\n"
+        "   gl_Position = ProjMtx * vec4(Position.xy, 0.0, 1.0);\n"
+        "}\n";
+    const char *fragmentShaderSource = "#version 330 core\n"
+        "in vec2 Frag_UV;\n"
+        "in vec4 Frag_Color;\n"
+        "uniform sampler2D Texture;\n"
+        "out vec4 Out_Color;\n"
+        "void main()\n"
+        "{\n"
+        "   Out_Color = Frag_Color * texture(Texture, Frag_UV.st);\n"
+        "}\n";
+
+    GLuint commandTexture(ImDrawCmd const &command)
+    {
+        // ImTextureID is a pointer or an integer depending on the version,
+        // either way the stock backend stores the GL texture name in it
+#if IMGUI_VERSION_NUM >= 19200
+        return (GLuint)(intptr_t)command.GetTexID();
+#else
+        return (GLuint)(intptr_t)command.TextureId;
+#endif
+    }
+}
+
+bool ImGuiRenderer::initialize(ShaderProgramCache *cache)
+{
+    std::vector<ShaderStage> stages =
+    {
+        { GL_VERTEX_SHADER, vertexShaderSource },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource }
+    };
+    program = cache != NULL ? cache->loadProgram(stages, "imgui") : compileShaderProgram(stages, "imgui");
+    if (program == 0) { return false; }
+    projectionLocation = glGetUniformLocation(program, "ProjMtx");
+    textureLocation = glGetUniformLocation(program, "Texture");
+
+    if (!stream.initialize(GL_ARRAY_BUFFER, initialPartitionSize, true))
+    {
+        shutdown();
+        return false;
+    }
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glEnableVertexAttribArray(positionLocation);
+    glEnableVertexAttribArray(uvLocation);
+    glEnableVertexAttribArray(colorLocation);
+    glBindVertexArray(0);
+    return true;
+}
+
+void ImGuiRenderer::shutdown()
+{
+    stream.shutdown();
+    if (vertexArray != 0) { glDeleteVertexArrays(1, &vertexArray); }
+    if (program != 0) { glDeleteProgram(program); }
+    vertexArray = program = 0;
+}
+
+void ImGuiRenderer::setupState(ImDrawData *drawData, int framebufferWidth, int framebufferHeight)
+{
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_SCISSOR_TEST);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+
+    float left = drawData->DisplayPos.x,
+          right = drawData->DisplayPos.x + drawData->DisplaySize.x,
+          top = drawData->DisplayPos.y,
+          bottom = drawData->DisplayPos.y + drawData->DisplaySize.y;
+    const float projection[4][4] =
+    {
+        { 2.0f / (right - left), 0.0f, 0.0f, 0.0f },
+        { 0.0f, 2.0f / (top - bottom), 0.0f, 0.0f },
+        { 0.0f, 0.0f, -1.0f, 0.0f },
+        { (right + left) / (left - right), (top + bottom) / (bottom - top), 0.0f, 1.0f }
+    };
+    glUseProgram(program);
+    glUniform1i(textureLocation, 0);
+    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, &projection[0][0]);
+
+    // vertices of this frame start at the current partition
+    size_t partition = stream.offset();
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.buffer());
+    glVertexAttribPointer(
+        positionLocation, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+        reinterpret_cast<const void *>(partition + offsetof(ImDrawVert, pos))
+    );
+    glVertexAttribPointer(
+        uvLocation, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+        reinterpret_cast<const void *>(partition + offsetof(ImDrawVert, uv))
+    );
+    glVertexAttribPointer(
+        colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert),
+        reinterpret_cast<const void *>(partition + offsetof(ImDrawVert, col))
+    );
+    glActiveTexture(GL_TEXTURE0);
+
+    // nothing is known to be bound after the state is (re)set
+    boundTexture = 0;
+    glBindTexture(GL_TEXTURE_2D, 0);
+    currentScissor[2] = currentScissor[3] = -1;
+}
+
+void ImGuiRenderer::flush()
+{
+    if (counts.empty()) { return; }
+
+    if (batchTexture != boundTexture)
+    {
+        glBindTexture(GL_TEXTURE_2D, batchTexture);
+        boundTexture = batchTexture;
+        lastStatistics.textureBinds++;
+    }
+    if (std::memcmp(batchScissor, currentScissor, sizeof(batchScissor)) != 0)
+    {
+        glScissor(batchScissor[0], batchScissor[1], batchScissor[2], batchScissor[3]);
+        std::memcpy(currentScissor, batchScissor, sizeof(batchScissor));
+        lastStatistics.scissorChanges++;
+    }
+
+    glMultiDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        counts.data(),
+        sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+        indexOffsets.data(),
+        static_cast<GLsizei>(counts.size()),
+        baseVertices.data()
+    );
+    lastStatistics.ranges += static_cast<int>(counts.size());
+    lastStatistics.drawCalls++;
+
+    counts.clear();
+    indexOffsets.clear();
+    baseVertices.clear();
+}
+
+void ImGuiRenderer::render(ImDrawData *drawData)
+{
+    lastStatistics = ImGuiRendererStatistics();
+    int framebufferWidth = static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x),
+        framebufferHeight = static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+    if (framebufferWidth <= 0 || framebufferHeight <= 0) { return; }
+
+    // all the lists go into one partition: vertices first, then indices
+    size_t verticesSize = static_cast<size_t>(drawData->TotalVtxCount) * sizeof(ImDrawVert),
+           indicesStart = (verticesSize + indicesAlignment - 1) / indicesAlignment * indicesAlignment,
+           totalSize = indicesStart + static_cast<size_t>(drawData->TotalIdxCount) * sizeof(ImDrawIdx);
+    // a frame can be nothing but callbacks (retained layers drawn from their textures),
+    // then there is nothing to upload, but the callbacks still have to run
+    bool uploading = totalSize > 0;
+    unsigned char *data = NULL;
+    if (uploading)
+    {
+        data = static_cast<unsigned char *>(stream.beginWrite(totalSize));
+        if (data == NULL) { return; }
+    }
+
+    listVertexOffsets.resize(drawData->CmdListsCount);
+    listIndexOffsets.resize(drawData->CmdListsCount);
+    size_t vertices = 0,
+           indices = 0;
+    for (int n = 0; n < drawData->CmdListsCount; n++)
+    {
+        ImDrawList const *list = drawData->CmdLists[n];
+        // lists with nothing but callbacks have no buffers at all
+        if (uploading && list->VtxBuffer.Size > 0)
+        {
+            std::memcpy(data + vertices * sizeof(ImDrawVert), list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+            std::memcpy(data + indicesStart + indices * sizeof(ImDrawIdx), list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+        }
+        listVertexOffsets[n] = vertices;
+        listIndexOffsets[n] = indices;
+        vertices += list->VtxBuffer.Size;
+        indices += list->IdxBuffer.Size;
+    }
+    if (uploading) { stream.endWrite(totalSize); }
+
+    setupState(drawData, framebufferWidth, framebufferHeight);
+    size_t indexBytes = stream.offset() + indicesStart;
+    ImVec2 clipOffset = drawData->DisplayPos,
+           clipScale = drawData->FramebufferScale;
+    for (int n = 0; n < drawData->CmdListsCount; n++)
+    {
+        ImDrawList const *list = drawData->CmdLists[n];
+        for (int c = 0; c < list->CmdBuffer.Size; c++)
+        {
+            ImDrawCmd const &command = list->CmdBuffer[c];
+            if (command.UserCallback != NULL)
+            {
+                // whatever is collected is drawn before the callback changes anything
+                flush();
+                if (command.UserCallback == ImDrawCallback_ResetRenderState)
+                {
+                    setupState(drawData, framebufferWidth, framebufferHeight);
+                }
+                else
+                {
+                    command.UserCallback(list, &command);
+                    // the callback could have changed anything
+                    setupState(drawData, framebufferWidth, framebufferHeight);
+                }
+                continue;
+            }
+            if (command.ElemCount == 0) { continue; }
+
+            float clipMinX = (command.ClipRect.x - clipOffset.x) * clipScale.x,
+                  clipMinY = (command.ClipRect.y - clipOffset.y) * clipScale.y,
+                  clipMaxX = (command.ClipRect.z - clipOffset.x) * clipScale.x,
+                  clipMaxY = (command.ClipRect.w - clipOffset.y) * clipScale.y;
+            if (clipMaxX <= clipMinX || clipMaxY <= clipMinY) { continue; }
+            // GL scissor origin is the bottom-left corner
+            GLint scissor[4] =
+            {
+                static_cast<GLint>(clipMinX),
+                static_cast<GLint>(framebufferHeight - clipMaxY),
+                static_cast<GLint>(clipMaxX - clipMinX),
+                static_cast<GLint>(clipMaxY - clipMinY)
+            };
+            GLuint texture = commandTexture(command);
+            lastStatistics.commands++;
+
+            if (
+                !counts.empty()
+                && (texture != batchTexture || std::memcmp(scissor, batchScissor, sizeof(scissor)) != 0)
+            )
+            {
+                flush();
+            }
+            batchTexture = texture;
+            std::memcpy(batchScissor, scissor, sizeof(scissor));
+
+            GLint baseVertex = static_cast<GLint>(listVertexOffsets[n] + command.VtxOffset);
+            size_t firstIndex = listIndexOffsets[n] + command.IdxOffset;
+            // commands that continue the previous one become one range
+            if (!counts.empty() && baseVertices.back() == baseVertex && lastRangeEnd == firstIndex)
+            {
+                counts.back() += static_cast<GLsizei>(command.ElemCount);
+            }
+            else
+            {
+                counts.push_back(static_cast<GLsizei>(command.ElemCount));
+                indexOffsets.push_back(reinterpret_cast<const void *>(indexBytes + firstIndex * sizeof(ImDrawIdx)));
+                baseVertices.push_back(baseVertex);
+            }
+            lastRangeEnd = firstIndex + command.ElemCount;
+        }
+    }
+    flush();
+    if (uploading) { stream.fence(); }
+
+    // the state the rest of the frame expects
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
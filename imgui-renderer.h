@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <dearimgui/imgui.h>
+
+#include "stream-buffer.h"
+#include "shader-cache.h"
+
+struct ImGuiRendererStatistics
+{
+    // ImDrawCmd with elements to draw
+    int commands = 0;
+    // index ranges left after merging contiguous commands
+    int ranges = 0;
+    // glMultiDrawElementsBaseVertex() calls
+    int drawCalls = 0;
+    int textureBinds = 0;
+    int scissorChanges = 0;
+};
+
+// Alternative to ImGui_ImplOpenGL3_RenderDrawData(). Vertices and indices
+// of all the lists are written into one (persistently mapped, if possible)
+// stream buffer, consecutive commands with the same texture and scissor are
+// submitted with one glMultiDrawElementsBaseVertex(), and texture/scissor
+// are only changed when they actually change. Instead of backing up and
+// restoring all the GL state, it leaves scissor test and blending disabled
+// and no program or vertex array bound.
+// The font texture and the backend flags still come from the stock backend,
+// which has to be initialized as well
+class ImGuiRenderer
+{
+public:
+    bool initialize(ShaderProgramCache *cache);
+    void shutdown();
+    bool initialized() const { return program != 0; }
+
+    void render(ImDrawData *drawData);
+
+    ImGuiRendererStatistics const &statistics() const { return lastStatistics; }
+    bool persistentlyMapped() const { return stream.persistentlyMapped(); }
+
+private:
+    GLuint program = 0,
+           vertexArray = 0;
+    GLint projectionLocation = -1,
+          textureLocation = -1;
+    StreamBuffer stream;
+
+    // the batch being collected: ranges that share the texture and the scissor
+    GLuint batchTexture = 0;
+    GLint batchScissor[4] = {};
+    std::vector<GLsizei> counts;
+    std::vector<const void *> indexOffsets;
+    std::vector<GLint> baseVertices;
+    size_t lastRangeEnd = 0;
+
+    // what is actually bound, to skip redundant changes
+    GLuint boundTexture = 0;
+    GLint currentScissor[4] = {};
+
+    std::vector<size_t> listVertexOffsets;
+    std::vector<size_t> listIndexOffsets;
+    ImGuiRendererStatistics lastStatistics;
+
+    void setupState(ImDrawData *drawData, int framebufferWidth, int framebufferHeight);
+    void flush();
+};
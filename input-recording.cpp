@@ -0,0 +1,415 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <GLFW/glfw3.h>
+
+#include "input-recording.h"
+#include "logger.h"
+
+namespace
+{
+    const char *recordingHeader = "# glfw-imgui input recording, version 2";
+    // without the DPI scale of resizes, which is 1 then
+    const char *recordingHeaderVersion1 = "# glfw-imgui input recording, version 1";
+
+    // names in the file, in the order of InputEventType
+    const char *eventTypeNames[] = { "cursor", "button", "key", "char", "scroll", "resize" };
+    const int eventTypesCount = sizeof(eventTypeNames) / sizeof(eventTypeNames[0]);
+    // the last line of a complete recording, with the total amount of frames
+    const char *endName = "end";
+
+    // how many integer values every type has
+    int valuesCount(InputEventType type)
+    {
+        switch (type)
+        {
+            case InputEventType::MouseButton: return 3;
+            case InputEventType::Key: return 4;
+            case InputEventType::Character: return 1;
+            case InputEventType::Resize: return 4;
+            default: return 0;
+        }
+    }
+
+    bool hasPosition(InputEventType type)
+    {
+        return type == InputEventType::CursorPosition || type == InputEventType::Scroll;
+    }
+
+#if IMGUI_VERSION_NUM >= 18700
+    ImGuiKey glfwKeyToImGuiKey(int key)
+    {
+        if (key >= GLFW_KEY_A && key <= GLFW_KEY_Z) { return static_cast<ImGuiKey>(ImGuiKey_A + (key - GLFW_KEY_A)); }
+        if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9) { return static_cast<ImGuiKey>(ImGuiKey_0 + (key - GLFW_KEY_0)); }
+        if (key >= GLFW_KEY_F1 && key <= GLFW_KEY_F12) { return static_cast<ImGuiKey>(ImGuiKey_F1 + (key - GLFW_KEY_F1)); }
+        switch (key)
+        {
+            case GLFW_KEY_TAB: return ImGuiKey_Tab;
+            case GLFW_KEY_LEFT: return ImGuiKey_LeftArrow;
+            case GLFW_KEY_RIGHT: return ImGuiKey_RightArrow;
+            case GLFW_KEY_UP: return ImGuiKey_UpArrow;
+            case GLFW_KEY_DOWN: return ImGuiKey_DownArrow;
+            case GLFW_KEY_PAGE_UP: return ImGuiKey_PageUp;
+            case GLFW_KEY_PAGE_DOWN: return ImGuiKey_PageDown;
+            case GLFW_KEY_HOME: return ImGuiKey_Home;
+            case GLFW_KEY_END: return ImGuiKey_End;
+            case GLFW_KEY_INSERT: return ImGuiKey_Insert;
+            case GLFW_KEY_DELETE: return ImGuiKey_Delete;
+            case GLFW_KEY_BACKSPACE: return ImGuiKey_Backspace;
+            case GLFW_KEY_SPACE: return ImGuiKey_Space;
+            case GLFW_KEY_ENTER: return ImGuiKey_Enter;
+            case GLFW_KEY_ESCAPE: return ImGuiKey_Escape;
+            case GLFW_KEY_KP_ENTER: return ImGuiKey_KeypadEnter;
+            case GLFW_KEY_LEFT_SHIFT: return ImGuiKey_LeftShift;
+            case GLFW_KEY_LEFT_CONTROL: return ImGuiKey_LeftCtrl;
+            case GLFW_KEY_LEFT_ALT: return ImGuiKey_LeftAlt;
+            case GLFW_KEY_LEFT_SUPER: return ImGuiKey_LeftSuper;
+            case GLFW_KEY_RIGHT_SHIFT: return ImGuiKey_RightShift;
+            case GLFW_KEY_RIGHT_CONTROL: return ImGuiKey_RightCtrl;
+            case GLFW_KEY_RIGHT_ALT: return ImGuiKey_RightAlt;
+            case GLFW_KEY_RIGHT_SUPER: return ImGuiKey_RightSuper;
+            default: return ImGuiKey_None;
+        }
+    }
+#else
+    // what the GLFW backend of that time did on initialization
+    void configureKeyMap(ImGuiIO &io)
+    {
+        io.KeyMap[ImGuiKey_Tab] = GLFW_KEY_TAB;
+        io.KeyMap[ImGuiKey_LeftArrow] = GLFW_KEY_LEFT;
+        io.KeyMap[ImGuiKey_RightArrow] = GLFW_KEY_RIGHT;
+        io.KeyMap[ImGuiKey_UpArrow] = GLFW_KEY_UP;
+        io.KeyMap[ImGuiKey_DownArrow] = GLFW_KEY_DOWN;
+        io.KeyMap[ImGuiKey_PageUp] = GLFW_KEY_PAGE_UP;
+        io.KeyMap[ImGuiKey_PageDown] = GLFW_KEY_PAGE_DOWN;
+        io.KeyMap[ImGuiKey_Home] = GLFW_KEY_HOME;
+        io.KeyMap[ImGuiKey_End] = GLFW_KEY_END;
+        io.KeyMap[ImGuiKey_Insert] = GLFW_KEY_INSERT;
+        io.KeyMap[ImGuiKey_Delete] = GLFW_KEY_DELETE;
+        io.KeyMap[ImGuiKey_Backspace] = GLFW_KEY_BACKSPACE;
+        io.KeyMap[ImGuiKey_Space] = GLFW_KEY_SPACE;
+        io.KeyMap[ImGuiKey_Enter] = GLFW_KEY_ENTER;
+        io.KeyMap[ImGuiKey_Escape] = GLFW_KEY_ESCAPE;
+        io.KeyMap[ImGuiKey_KeyPadEnter] = GLFW_KEY_KP_ENTER;
+        io.KeyMap[ImGuiKey_A] = GLFW_KEY_A;
+        io.KeyMap[ImGuiKey_C] = GLFW_KEY_C;
+        io.KeyMap[ImGuiKey_V] = GLFW_KEY_V;
+        io.KeyMap[ImGuiKey_X] = GLFW_KEY_X;
+        io.KeyMap[ImGuiKey_Y] = GLFW_KEY_Y;
+        io.KeyMap[ImGuiKey_Z] = GLFW_KEY_Z;
+    }
+#endif
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+bool InputRecorder::open(std::filesystem::path const &path)
+{
+    close();
+    file = std::fopen(path.string().c_str(), "w");
+    if (file == NULL)
+    {
+        logError("Couldn't open %s for recording input", path.string().c_str());
+        return false;
+    }
+    filePath = path;
+    std::fprintf(file, "%s\n", recordingHeader);
+    frame = 0;
+    eventsCount = 0;
+    frameStarted = std::chrono::steady_clock::now();
+    return true;
+}
+
+void InputRecorder::close()
+{
+    if (file == NULL) { return; }
+
+    std::fprintf(file, "%d 0 %s\n", frame, endName);
+    std::fclose(file);
+    file = NULL;
+    logInfo("Recorded %d input events over %d frames to %s", eventsCount, frame, filePath.string().c_str());
+}
+
+void InputRecorder::write(InputEvent &event)
+{
+    event.frame = frame;
+    event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStarted).count();
+
+    std::fprintf(file, "%d %.6f %s", event.frame, event.time, eventTypeNames[static_cast<int>(event.type)]);
+    if (hasPosition(event.type)) { std::fprintf(file, " %.9g %.9g", event.x, event.y); }
+    for (int v = 0; v < valuesCount(event.type); v++) { std::fprintf(file, " %d", event.values[v]); }
+    if (event.type == InputEventType::Resize) { std::fprintf(file, " %.9g", event.scale); }
+    std::fprintf(file, "\n");
+    eventsCount++;
+}
+
+void InputRecorder::cursorPosition(double x, double y)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::CursorPosition;
+    event.x = x;
+    event.y = y;
+    write(event);
+}
+
+void InputRecorder::mouseButton(int button, int action, int mods)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::MouseButton;
+    event.values[0] = button;
+    event.values[1] = action;
+    event.values[2] = mods;
+    write(event);
+}
+
+void InputRecorder::key(int key, int scancode, int action, int mods)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::Key;
+    event.values[0] = key;
+    event.values[1] = scancode;
+    event.values[2] = action;
+    event.values[3] = mods;
+    write(event);
+}
+
+void InputRecorder::character(unsigned int codepoint)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::Character;
+    event.values[0] = static_cast<int>(codepoint);
+    write(event);
+}
+
+void InputRecorder::scroll(double xOffset, double yOffset)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::Scroll;
+    event.x = xOffset;
+    event.y = yOffset;
+    write(event);
+}
+
+void InputRecorder::resize(int windowWidth, int windowHeight, int framebufferWidth, int framebufferHeight, float scale)
+{
+    if (file == NULL) { return; }
+
+    InputEvent event;
+    event.type = InputEventType::Resize;
+    event.values[0] = windowWidth;
+    event.values[1] = windowHeight;
+    event.values[2] = framebufferWidth;
+    event.values[3] = framebufferHeight;
+    event.scale = scale;
+    write(event);
+}
+
+void InputRecorder::frameComposed()
+{
+    if (file == NULL) { return; }
+
+    frame++;
+    frameStarted = std::chrono::steady_clock::now();
+}
+
+bool InputReplay::open(std::filesystem::path const &path)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        logError("Couldn't open input recording %s", path.string().c_str());
+        return false;
+    }
+
+    std::string line;
+    bool hasScale = true;
+    if (std::getline(input, line) && line == recordingHeaderVersion1) { hasScale = false; }
+    else if (line != recordingHeader)
+    {
+        logError("%s is not an input recording", path.string().c_str());
+        return false;
+    }
+
+    events.clear();
+    nextEvent = 0;
+    frames = 0;
+    recordedScale = 1.0f;
+    bool complete = false;
+    int lineNumber = 1;
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') { continue; }
+
+        std::istringstream fields(line);
+        InputEvent event;
+        std::string typeName;
+        if (!(fields >> event.frame >> event.time >> typeName))
+        {
+            logError("Broken line %d in input recording %s", lineNumber, path.string().c_str());
+            return false;
+        }
+        if (typeName == endName)
+        {
+            frames = event.frame;
+            complete = true;
+            break;
+        }
+
+        int type = 0;
+        while (type < eventTypesCount && typeName != eventTypeNames[type]) { type++; }
+        event.type = static_cast<InputEventType>(type);
+        bool valid = type < eventTypesCount && (events.empty() || event.frame >= events.back().frame);
+        if (valid && hasPosition(event.type)) { valid = static_cast<bool>(fields >> event.x >> event.y); }
+        for (int v = 0; valid && v < valuesCount(event.type); v++)
+        {
+            valid = static_cast<bool>(fields >> event.values[v]);
+        }
+        if (valid && hasScale && event.type == InputEventType::Resize) { valid = static_cast<bool>(fields >> event.scale); }
+        if (!valid)
+        {
+            logError("Broken line %d in input recording %s", lineNumber, path.string().c_str());
+            return false;
+        }
+        events.push_back(event);
+    }
+
+    for (InputEvent const &event : events)
+    {
+        if (event.type != InputEventType::Resize) { continue; }
+        recordedScale = static_cast<float>(event.scale);
+        break;
+    }
+
+    if (!complete)
+    {
+        // the application didn't exit normally, but the events are still good
+        frames = events.empty() ? 0 : events.back().frame + 1;
+        logWarning("Input recording %s is not complete, replaying %d frames", path.string().c_str(), frames);
+    }
+    return frames > 0;
+}
+
+int InputReplay::apply(int frame, ImGuiIO &io)
+{
+#if IMGUI_VERSION_NUM < 18700
+    if (!keyMapConfigured)
+    {
+        configureKeyMap(io);
+        keyMapConfigured = true;
+    }
+#endif
+
+    int applied = 0;
+    while (nextEvent < events.size() && events[nextEvent].frame <= frame)
+    {
+        InputEvent const &event = events[nextEvent++];
+        applied++;
+        switch (event.type)
+        {
+            case InputEventType::CursorPosition:
+            {
+                // in window coordinates, like io.DisplaySize
+                float x = static_cast<float>(event.x),
+                      y = static_cast<float>(event.y);
+#if IMGUI_VERSION_NUM >= 18700
+                io.AddMousePosEvent(x, y);
+#else
+                io.MousePos = ImVec2(x, y);
+#endif
+                break;
+            }
+            case InputEventType::MouseButton:
+            {
+                int button = event.values[0];
+                bool pressed = event.values[1] == GLFW_PRESS;
+                if (button < 0 || button >= 5) { break; }
+#if IMGUI_VERSION_NUM >= 18700
+                io.AddMouseButtonEvent(button, pressed);
+#else
+                mouseDown[button] = pressed;
+                if (pressed) { mouseJustPressed[button] = true; }
+#endif
+                break;
+            }
+            case InputEventType::Key:
+            {
+                int key = event.values[0],
+                    mods = event.values[3];
+                bool down = event.values[2] != GLFW_RELEASE;
+#if IMGUI_VERSION_NUM >= 18700
+    #if IMGUI_VERSION_NUM >= 18900
+                io.AddKeyEvent(ImGuiMod_Ctrl, (mods & GLFW_MOD_CONTROL) != 0);
+                io.AddKeyEvent(ImGuiMod_Shift, (mods & GLFW_MOD_SHIFT) != 0);
+                io.AddKeyEvent(ImGuiMod_Alt, (mods & GLFW_MOD_ALT) != 0);
+                io.AddKeyEvent(ImGuiMod_Super, (mods & GLFW_MOD_SUPER) != 0);
+    #else
+                io.AddKeyEvent(ImGuiKey_ModCtrl, (mods & GLFW_MOD_CONTROL) != 0);
+                io.AddKeyEvent(ImGuiKey_ModShift, (mods & GLFW_MOD_SHIFT) != 0);
+                io.AddKeyEvent(ImGuiKey_ModAlt, (mods & GLFW_MOD_ALT) != 0);
+                io.AddKeyEvent(ImGuiKey_ModSuper, (mods & GLFW_MOD_SUPER) != 0);
+    #endif
+                ImGuiKey imguiKey = glfwKeyToImGuiKey(key);
+                if (imguiKey != ImGuiKey_None) { io.AddKeyEvent(imguiKey, down); }
+#else
+                if (key >= 0 && key < static_cast<int>(sizeof(io.KeysDown) / sizeof(io.KeysDown[0])))
+                {
+                    io.KeysDown[key] = down;
+                }
+                io.KeyCtrl = (mods & GLFW_MOD_CONTROL) != 0;
+                io.KeyShift = (mods & GLFW_MOD_SHIFT) != 0;
+                io.KeyAlt = (mods & GLFW_MOD_ALT) != 0;
+                io.KeySuper = (mods & GLFW_MOD_SUPER) != 0;
+#endif
+                break;
+            }
+            case InputEventType::Character:
+                io.AddInputCharacter(static_cast<unsigned int>(event.values[0]));
+                break;
+            case InputEventType::Scroll:
+#if IMGUI_VERSION_NUM >= 18700
+                io.AddMouseWheelEvent(static_cast<float>(event.x), static_cast<float>(event.y));
+#else
+                io.MouseWheelH += static_cast<float>(event.x);
+                io.MouseWheel += static_cast<float>(event.y);
+#endif
+                break;
+            case InputEventType::Resize:
+                // the same as the GLFW backend does: window size, and pixels per window unit
+                framebufferWidth = event.values[2];
+                framebufferHeight = event.values[3];
+                io.DisplaySize = ImVec2(static_cast<float>(event.values[0]), static_cast<float>(event.values[1]));
+                if (event.values[0] > 0 && event.values[1] > 0)
+                {
+                    io.DisplayFramebufferScale = ImVec2(
+                        static_cast<float>(framebufferWidth) / event.values[0],
+                        static_cast<float>(framebufferHeight) / event.values[1]
+                    );
+                }
+                break;
+        }
+    }
+
+#if IMGUI_VERSION_NUM < 18700
+    for (int button = 0; button < 5; button++)
+    {
+        io.MouseDown[button] = mouseJustPressed[button] || mouseDown[button];
+        mouseJustPressed[button] = false;
+    }
+#endif
+    return applied;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+#include <dearimgui/imgui.h>
+
+enum class InputEventType
+{
+    CursorPosition = 0,
+    MouseButton,
+    Key,
+    Character,
+    Scroll,
+    Resize
+};
+
+struct InputEvent
+{
+    InputEventType type = InputEventType::CursorPosition;
+    // the frame that got the event (its NewFrame() saw it first)
+    int frame = 0;
+    // seconds since the previous frame was composed
+    double time = 0.0;
+    // cursor position or scroll offsets
+    double x = 0.0,
+           y = 0.0;
+    // button, action, mods; key, scancode, action, mods; codepoint;
+    // window width, height, framebuffer width, height
+    int values[4] = {};
+    // of a resize, DPI scale the fonts and the style were built with
+    double scale = 1.0;
+};
+
+// Writes GLFW input events into a text file, one event per line:
+// frame, time within the frame, type and its arguments. Text is a bit
+// bigger than binary, but sessions are short and it's easy to look into
+class InputRecorder
+{
+public:
+    InputRecorder() = default;
+    ~InputRecorder();
+    InputRecorder(InputRecorder const &) = delete;
+    InputRecorder &operator=(InputRecorder const &) = delete;
+
+    bool open(std::filesystem::path const &path);
+    void close();
+    bool isOpen() const { return file != NULL; }
+
+    // from GLFW callbacks, on the main thread
+    void cursorPosition(double x, double y);
+    void mouseButton(int button, int action, int mods);
+    void key(int key, int scancode, int action, int mods);
+    void character(unsigned int codepoint);
+    void scroll(double xOffset, double yOffset);
+    void resize(int windowWidth, int windowHeight, int framebufferWidth, int framebufferHeight, float scale);
+
+    // right after NewFrame(), events from now on go to the next frame
+    void frameComposed();
+
+private:
+    FILE *file = NULL;
+    std::filesystem::path filePath;
+    int frame = 0;
+    int eventsCount = 0;
+    std::chrono::steady_clock::time_point frameStarted;
+
+    void write(InputEvent &event);
+};
+
+// Recorded session fed into Dear ImGui IO frame by frame, so together
+// with a fixed timestep every replay builds exactly the same frames.
+// GLFW backend is not involved, so it works in headless mode
+class InputReplay
+{
+public:
+    bool open(std::filesystem::path const &path);
+    int framesCount() const { return frames; }
+
+    // queues events of the frame into IO and returns their amount, resizing changes
+    // io.DisplaySize and io.DisplayFramebufferScale (and displayWidth/displayHeight)
+    int apply(int frame, ImGuiIO &io);
+    // of the framebuffer, in pixels
+    int displayWidth() const { return framebufferWidth; }
+    int displayHeight() const { return framebufferHeight; }
+    // of the first resize, the UI has to be built with it before replaying
+    float dpiScale() const { return recordedScale; }
+
+private:
+    std::vector<InputEvent> events;
+    size_t nextEvent = 0;
+    int frames = 0;
+    int framebufferWidth = 0,
+        framebufferHeight = 0;
+    float recordedScale = 1.0f;
+#if IMGUI_VERSION_NUM < 18700
+    // before the input queue a click within one frame had to be kept for a frame
+    bool mouseDown[5] = {};
+    bool mouseJustPressed[5] = {};
+    bool keyMapConfigured = false;
+#endif
+};
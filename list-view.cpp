@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <chrono>
+
+#include <dearimgui/imgui_stdlib.h>
+
+#include "list-view.h"
+
+namespace
+{
+    // items are indexed in chunks, so new requests are picked up in between
+    const int indexingChunk = 16384;
+    // how often filtering checks if there is a newer request
+    const int interruptionCheck = 4096;
+
+    inline unsigned char lowercase(unsigned char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    }
+
+    inline uint32_t trigramKey(unsigned char a, unsigned char b, unsigned char c)
+    {
+        return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16;
+    }
+
+    std::string lowercaseString(std::string const &text)
+    {
+        std::string result = text;
+        for (char &c : result) { c = static_cast<char>(lowercase(static_cast<unsigned char>(c))); }
+        return result;
+    }
+}
+
+void TrigramIndex::addItem(int index, const char *text)
+{
+    uint32_t block = static_cast<uint32_t>(index) / 64;
+    uint64_t bit = uint64_t(1) << (static_cast<uint32_t>(index) % 64);
+
+    const unsigned char *c = reinterpret_cast<const unsigned char *>(text);
+    if (c[0] != '\0' && c[1] != '\0')
+    {
+        unsigned char a = lowercase(c[0]),
+                      b = lowercase(c[1]);
+        for (c += 2; *c != '\0'; c++)
+        {
+            unsigned char next = lowercase(*c);
+            std::vector<Posting> &list = postings[trigramKey(a, b, next)];
+            // items come in order, so the item's block can only be the last one
+            if (!list.empty() && list.back().block == block) { list.back().mask |= bit; }
+            else { list.push_back({ block, bit }); }
+            a = b;
+            b = next;
+        }
+    }
+    itemsCount = index + 1;
+}
+
+std::vector<int> TrigramIndex::candidates(std::string const &lowercaseQuery) const
+{
+    std::vector<int> result;
+    std::vector<std::vector<Posting> const *> lists;
+    for (size_t i = 0; i + 2 < lowercaseQuery.size(); i++)
+    {
+        auto found = postings.find(trigramKey(
+            static_cast<unsigned char>(lowercaseQuery[i]),
+            static_cast<unsigned char>(lowercaseQuery[i + 1]),
+            static_cast<unsigned char>(lowercaseQuery[i + 2])
+        ));
+        // no item has this trigram, so none can contain the query
+        if (found == postings.end()) { return result; }
+        if (std::find(lists.begin(), lists.end(), &found->second) == lists.end())
+        {
+            lists.push_back(&found->second);
+        }
+    }
+    if (lists.empty()) { return result; }
+
+    // starting with the shortest list keeps intersections cheap
+    std::sort(
+        lists.begin(),
+        lists.end(),
+        [](auto a, auto b) { return a->size() < b->size(); }
+    );
+    std::vector<Posting> blocks = *lists.front();
+    for (size_t l = 1; l < lists.size() && !blocks.empty(); l++)
+    {
+        std::vector<Posting> const &other = *lists[l];
+        size_t kept = 0,
+               j = 0;
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            // lists are sorted by block
+            auto position = std::lower_bound(
+                other.begin() + j,
+                other.end(),
+                blocks[i].block,
+                [](Posting const &posting, uint32_t block) { return posting.block < block; }
+            );
+            j = position - other.begin();
+            if (j == other.size()) { break; }
+            if (position->block != blocks[i].block) { continue; }
+            uint64_t mask = blocks[i].mask & position->mask;
+            if (mask != 0) { blocks[kept++] = { blocks[i].block, mask }; }
+        }
+        blocks.resize(kept);
+    }
+
+    for (Posting const &posting : blocks)
+    {
+        for (uint64_t mask = posting.mask; mask != 0; mask &= mask - 1)
+        {
+            int bit = 0;
+            while ((mask >> bit & 1) == 0) { bit++; }
+            result.push_back(static_cast<int>(posting.block * 64 + bit));
+        }
+    }
+    return result;
+}
+
+ListView::ListView(ListItemGetter getter, void *data)
+    : getItem(getter), itemsData(data)
+{
+    filterThread = std::thread(&ListView::filterLoop, this);
+}
+
+ListView::~ListView()
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        stopping = true;
+        latestGeneration++;
+    }
+    requestChanged.notify_one();
+    if (filterThread.joinable()) { filterThread.join(); }
+}
+
+void ListView::setItemsCount(int count)
+{
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        if (count == requestedItems) { return; }
+        requestedItems = count;
+    }
+    requestChanged.notify_one();
+}
+
+void ListView::setResultsCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+    resultsCallback = callback;
+}
+
+bool ListView::draw(const char *label, ImVec2 const &size)
+{
+    bool changed = false;
+    ImGui::PushID(label);
+
+    if (ImGui::InputText("filter", &filter))
+    {
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            requestedQuery = lowercaseString(filter);
+            requestGeneration++;
+            latestGeneration = requestGeneration;
+        }
+        requestChanged.notify_one();
+    }
+
+    int itemsCount = 0;
+    bool filtering = false;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        itemsCount = requestedItems;
+        shownResult = std::atomic_load(&publishedResult);
+        filtering = shownResult == NULL
+            || shownResult->query != requestedQuery
+            || (!requestedQuery.empty() && shownResult->coveredItems < requestedItems);
+    }
+    // without a filter (or until the first result) all the items are shown
+    bool allItems = shownResult == NULL || shownResult->query.empty();
+    int rows = allItems ? itemsCount : static_cast<int>(shownResult->items.size());
+
+    ImGui::Text(
+        "%d of %d items%s",
+        rows,
+        itemsCount,
+        filtering ? " (filtering...)" : ""
+    );
+    int indexed = indexedCount.load();
+    if (indexed < itemsCount)
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled("indexed: %d", indexed);
+    }
+
+    ImGui::BeginChild("items", size, true);
+    // only the visible rows are submitted, the rest is just scrolling height
+    ImGuiListClipper clipper;
+    clipper.Begin(rows);
+    while (clipper.Step())
+    {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+        {
+            int item = allItems ? row : shownResult->items[row];
+            const char *text = NULL;
+            if (!getItem(itemsData, item, &text)) { continue; }
+            ImGui::PushID(item);
+            if (ImGui::Selectable(text, item == selectedItem))
+            {
+                selectedItem = item;
+                changed = true;
+            }
+            ImGui::PopID();
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+
+    ImGui::PopID();
+    return changed;
+}
+
+bool ListView::itemMatches(int item, std::string const &lowercaseQuery) const
+{
+    const char *text = NULL;
+    if (!getItem(itemsData, item, &text)) { return false; }
+
+    const unsigned char *query = reinterpret_cast<const unsigned char *>(lowercaseQuery.c_str());
+    for (const unsigned char *start = reinterpret_cast<const unsigned char *>(text); *start != '\0'; start++)
+    {
+        if (lowercase(*start) != query[0]) { continue; }
+        size_t i = 1;
+        while (query[i] != '\0' && start[i] != '\0' && lowercase(start[i]) == query[i]) { i++; }
+        if (query[i] == '\0') { return true; }
+        // the rest of the item is shorter than the query
+        if (start[i] == '\0') { return false; }
+    }
+    return false;
+}
+
+bool ListView::filterItems(
+    std::string const &lowercaseQuery,
+    FilterResult const *previous,
+    int itemsCount,
+    uint64_t generation,
+    FilterResult &result
+)
+{
+    result.query = lowercaseQuery;
+    result.coveredItems = itemsCount;
+    result.items.clear();
+    if (lowercaseQuery.empty()) { return true; }
+
+    int from = 0;
+    if (previous != NULL)
+    {
+        // results of the same or a shorter query only need to be narrowed down
+        for (size_t i = 0; i < previous->items.size(); i++)
+        {
+            if (i % interruptionCheck == 0 && latestGeneration.load() != generation) { return false; }
+            int item = previous->items[i];
+            if (previous->query == lowercaseQuery || itemMatches(item, lowercaseQuery))
+            {
+                result.items.push_back(item);
+            }
+        }
+        from = previous->coveredItems;
+    }
+
+    // indexed items go through the index, the rest is checked one by one
+    int indexedTo = std::min(index.indexedItems(), itemsCount);
+    if (lowercaseQuery.size() >= 3 && from < indexedTo)
+    {
+        std::vector<int> candidates = index.candidates(lowercaseQuery);
+        auto first = std::lower_bound(candidates.begin(), candidates.end(), from);
+        for (auto candidate = first; candidate != candidates.end() && *candidate < indexedTo; candidate++)
+        {
+            if ((candidate - first) % interruptionCheck == 0 && latestGeneration.load() != generation) { return false; }
+            if (itemMatches(*candidate, lowercaseQuery)) { result.items.push_back(*candidate); }
+        }
+        from = indexedTo;
+    }
+    for (int item = from; item < itemsCount; item++)
+    {
+        if (item % interruptionCheck == 0 && latestGeneration.load() != generation) { return false; }
+        if (itemMatches(item, lowercaseQuery)) { result.items.push_back(item); }
+    }
+    return true;
+}
+
+void ListView::publish(std::shared_ptr<const FilterResult> result)
+{
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        std::atomic_store(&publishedResult, result);
+        callback = resultsCallback;
+    }
+    if (callback) { callback(); }
+}
+
+void ListView::filterLoop()
+{
+    std::shared_ptr<const FilterResult> current;
+    for (;;)
+    {
+        std::string query;
+        int itemsCount = 0;
+        uint64_t generation = 0;
+        {
+            std::unique_lock<std::mutex> lock(requestMutex);
+            requestChanged.wait(lock, [&]
+            {
+                return stopping
+                    || current == NULL
+                    || current->query != requestedQuery
+                    || (!requestedQuery.empty() && current->coveredItems < requestedItems)
+                    || index.indexedItems() < requestedItems;
+            });
+            if (stopping) { break; }
+            query = requestedQuery;
+            itemsCount = requestedItems;
+            generation = requestGeneration;
+        }
+
+        bool queryChanged = current == NULL || current->query != query;
+        if (queryChanged || (!query.empty() && current->coveredItems < itemsCount))
+        {
+            // a longer query can only match a subset of what the shorter one did
+            FilterResult const *previous = NULL;
+            if (
+                current != NULL
+                && !current->query.empty()
+                && query.find(current->query) != std::string::npos
+            )
+            {
+                previous = current.get();
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            auto result = std::make_shared<FilterResult>();
+            if (!filterItems(query, previous, itemsCount, generation, *result)) { continue; }
+            if (queryChanged)
+            {
+                lastFilterMilliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - started
+                ).count();
+            }
+            current = result;
+            publish(current);
+            continue;
+        }
+
+        // nothing to filter, so indexing the next chunk of new items
+        int indexTo = std::min(index.indexedItems() + indexingChunk, itemsCount);
+        for (int item = index.indexedItems(); item < indexTo; item++)
+        {
+            const char *text = NULL;
+            index.addItem(item, getItem(itemsData, item, &text) ? text : "");
+        }
+        indexedCount = index.indexedItems();
+        // the UI shows indexing progress
+        if (indexedCount.load() == itemsCount) { publish(current); }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#include <dearimgui/imgui.h>
+
+// same signature as vector_getter from functions.h
+typedef bool (*ListItemGetter)(void *data, int index, const char **text);
+
+// Case-insensitive substring search over items with a trigram index:
+// a query only checks items that have all of its trigrams
+class TrigramIndex
+{
+public:
+    // items have to be added in order
+    void addItem(int index, const char *text);
+    int indexedItems() const { return itemsCount; }
+    // items that might contain the query (query has to be at least 3 characters long), sorted
+    std::vector<int> candidates(std::string const &lowercaseQuery) const;
+
+private:
+    // postings are kept per block of 64 items with a bitmask of items in it,
+    // which keeps the index small for common trigrams and makes intersection
+    // a matter of AND-ing masks
+    struct Posting
+    {
+        uint32_t block;
+        uint64_t mask;
+    };
+    std::unordered_map<uint32_t, std::vector<Posting>> postings;
+    int itemsCount = 0;
+};
+
+// List view for hundreds of thousands (or millions) of items. Only visible rows
+// are touched (with ImGuiListClipper), and filtering happens on a background
+// thread, which publishes results atomically, so typing never blocks the UI.
+// Items are read by that thread as well, so the getter has to keep working
+// for the items that are already counted while new ones are being added:
+// for instance, the vector is resized up front and then filled in chunks
+class ListView
+{
+public:
+    ListView(ListItemGetter getter, void *data);
+    ~ListView();
+    ListView(ListView const &) = delete;
+    ListView &operator=(ListView const &) = delete;
+
+    // new items are indexed in the background
+    void setItemsCount(int count);
+    // called from the background thread when new results are published
+    // (to wake up the rendering loop, for instance)
+    void setResultsCallback(std::function<void()> callback);
+
+    // filter input and the list, returns true if selection has changed
+    bool draw(const char *label, ImVec2 const &size);
+
+    // index of the selected item (not row), or -1
+    int selected() const { return selectedItem; }
+    int indexedItems() const { return indexedCount.load(); }
+    // time the last filtering took
+    double filterMilliseconds() const { return lastFilterMilliseconds.load(); }
+
+private:
+    struct FilterResult
+    {
+        std::string query;
+        // how many items have been checked against the query
+        int coveredItems = 0;
+        // matching items, empty query matches everything and has no list
+        std::vector<int> items;
+    };
+
+    ListItemGetter getItem;
+    void *itemsData;
+    std::string filter;
+    int selectedItem = -1;
+    std::shared_ptr<const FilterResult> shownResult;
+
+    // shared with the background thread
+    std::mutex requestMutex;
+    std::condition_variable requestChanged;
+    std::string requestedQuery;
+    int requestedItems = 0;
+    uint64_t requestGeneration = 0;
+    bool stopping = false;
+    std::function<void()> resultsCallback;
+    std::shared_ptr<const FilterResult> publishedResult;
+    std::atomic<int> indexedCount{0};
+    std::atomic<double> lastFilterMilliseconds{0.0};
+    std::atomic<uint64_t> latestGeneration{0};
+
+    // only used by the background thread
+    TrigramIndex index;
+    std::thread filterThread;
+
+    void filterLoop();
+    bool itemMatches(int item, std::string const &lowercaseQuery) const;
+    // returns false if it was interrupted by a newer request
+    bool filterItems(
+        std::string const &lowercaseQuery,
+        FilterResult const *previous,
+        int itemsCount,
+        uint64_t generation,
+        FilterResult &result
+    );
+    void publish(std::shared_ptr<const FilterResult> result);
+};
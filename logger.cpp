@@ -0,0 +1,224 @@
+#include <cstdarg>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "logger.h"
+#include "functions.h"
+
+namespace
+{
+    const size_t messageMaxLength = 236;
+    // has to be a power of 2
+    const size_t ringCapacity = 1024;
+    // how often the writer thread checks for new records when the ring is empty
+    const auto writerIdleInterval = std::chrono::milliseconds(5);
+
+    struct LogRecord
+    {
+        // Vyukov's bounded queue: the sequence tells whether the slot
+        // is free for the producer or ready for the consumer
+        std::atomic<size_t> sequence;
+        int64_t timestamp; // system_clock nanoseconds
+        LogLevel level;
+        uint16_t length;
+        char text[messageMaxLength];
+    };
+
+    const char *levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+    LogRecord ring[ringCapacity];
+    // producers claim slots with a CAS, so it is safe to log from any thread,
+    // although normally it is only the UI thread
+    alignas(64) std::atomic<size_t> enqueuePosition(0);
+    alignas(64) size_t dequeuePosition = 0;
+    std::atomic<uint64_t> dropped(0);
+
+    std::atomic<bool> running(false);
+    std::thread writerThread;
+    FILE *logSink = stdout;
+    // of the synchronous writes, the sink of startLogger() can be closed after stopLogger()
+    FILE *directSink = stdout;
+
+    // the slot is either claimed (returned) or the ring is full (NULL)
+    LogRecord *claimRecord(size_t &position)
+    {
+        position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true)
+        {
+            LogRecord &record = ring[position & (ringCapacity - 1)];
+            size_t sequence = record.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    return &record;
+                }
+            }
+            else if (difference < 0)
+            {
+                return NULL;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // formats a batch of records into one buffer and writes it with a single call
+    size_t drainRing(TimestampFormatter &formatter, std::vector<char> &batch)
+    {
+        size_t drained = 0;
+        batch.clear();
+        while (true)
+        {
+            LogRecord &record = ring[dequeuePosition & (ringCapacity - 1)];
+            size_t sequence = record.sequence.load(std::memory_order_acquire);
+            if (sequence != dequeuePosition + 1) { break; }
+
+            char timestamp[timestampMaxLength];
+            size_t timestampLength = formatter.format(
+                std::chrono::time_point<std::chrono::system_clock>(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::nanoseconds(record.timestamp)
+                    )
+                ),
+                true,
+                timestamp
+            );
+            const char *level = levelNames[static_cast<int>(record.level)];
+
+            if (record.level == LogLevel::Error)
+            {
+                std::fprintf(stderr, "[%s] [%s] %.*s\n", timestamp, level, record.length, record.text);
+            }
+            else
+            {
+                batch.push_back('[');
+                batch.insert(batch.end(), timestamp, timestamp + timestampLength);
+                batch.push_back(']');
+                batch.push_back(' ');
+                batch.push_back('[');
+                batch.insert(batch.end(), level, level + std::strlen(level));
+                batch.push_back(']');
+                batch.push_back(' ');
+                batch.insert(batch.end(), record.text, record.text + record.length);
+                batch.push_back('\n');
+            }
+
+            // the slot is free again, one lap later
+            record.sequence.store(dequeuePosition + ringCapacity, std::memory_order_release);
+            dequeuePosition++;
+            drained++;
+        }
+
+        if (!batch.empty())
+        {
+            std::fwrite(batch.data(), 1, batch.size(), logSink);
+            std::fflush(logSink);
+        }
+        return drained;
+    }
+
+    void writerLoop()
+    {
+        TimestampFormatter formatter;
+        std::vector<char> batch;
+        batch.reserve(ringCapacity * 64);
+
+        while (running.load(std::memory_order_acquire))
+        {
+            if (drainRing(formatter, batch) == 0)
+            {
+                std::this_thread::sleep_for(writerIdleInterval);
+            }
+        }
+        drainRing(formatter, batch);
+    }
+}
+
+void startLogger(FILE *sink)
+{
+    if (running.load()) { return; }
+
+    logSink = sink;
+    for (size_t i = 0; i < ringCapacity; i++)
+    {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePosition.store(0);
+    dequeuePosition = 0;
+    dropped.store(0);
+
+    running.store(true, std::memory_order_release);
+    writerThread = std::thread(writerLoop);
+}
+
+void setLogSink(FILE *sink)
+{
+    directSink = sink;
+}
+
+void stopLogger()
+{
+    if (!running.load()) { return; }
+
+    running.store(false, std::memory_order_release);
+    writerThread.join();
+
+    uint64_t droppedCount = dropped.load();
+    if (droppedCount > 0)
+    {
+        std::fprintf(stderr, "[WARNING] Log messages dropped: %llu\n", static_cast<unsigned long long>(droppedCount));
+    }
+}
+
+void logMessage(LogLevel level, const char *format, ...)
+{
+    // logger isn't running (yet), so it's just a synchronous write
+    if (!running.load(std::memory_order_relaxed))
+    {
+        va_list arguments;
+        va_start(arguments, format);
+        FILE *output = level == LogLevel::Error ? stderr : directSink;
+        std::fprintf(output, "[%s] ", levelNames[static_cast<int>(level)]);
+        std::vfprintf(output, format, arguments);
+        std::fputc('\n', output);
+        va_end(arguments);
+        return;
+    }
+
+    size_t position = 0;
+    LogRecord *record = claimRecord(position);
+    if (record == NULL)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    record->level = level;
+
+    va_list arguments;
+    va_start(arguments, format);
+    int length = std::vsnprintf(record->text, messageMaxLength, format, arguments);
+    va_end(arguments);
+    if (length < 0) { length = 0; }
+    record->length = static_cast<uint16_t>(
+        static_cast<size_t>(length) < messageMaxLength ? length : messageMaxLength - 1
+    );
+
+    // publish the record to the writer thread
+    record->sequence.store(position + 1, std::memory_order_release);
+}
+
+uint64_t droppedLogMessages()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
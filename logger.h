@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+
+enum class LogLevel
+{
+    Debug = 0,
+    Info,
+    Warning,
+    Error
+};
+
+// Asynchronous logging: the calling thread only formats the message
+// into a fixed-size record of a lock-free ring (no allocations, no I/O, no locks),
+// and a background thread writes the records out in batches.
+// If the ring is full, messages are dropped (and counted) instead of blocking
+
+// errors also go to stderr, everything else to the sink
+void startLogger(FILE *sink = stdout);
+// where messages other than errors go while the logger isn't running, stdout by default
+// (benchmarks that print their report to stdout keep it clean with stderr)
+void setLogSink(FILE *sink);
+// writes out everything that is still in the ring
+void stopLogger();
+
+// printf-style, longer messages are truncated
+void logMessage(LogLevel level, const char *format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+uint64_t droppedLogMessages();
+
+#define logDebug(...) logMessage(LogLevel::Debug, __VA_ARGS__)
+#define logInfo(...) logMessage(LogLevel::Info, __VA_ARGS__)
+#define logWarning(...) logMessage(LogLevel::Warning, __VA_ARGS__)
+#define logError(...) logMessage(LogLevel::Error, __VA_ARGS__)
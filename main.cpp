@@ -2,6 +2,16 @@
 #include <string>
 #include <iostream>
 #include <filesystem>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
 
 // GLFW
 #include <glad/glad.h>
@@ -15,6 +25,31 @@
 
 #include "functions.h"
 #include "imgui-style.h"
+#include "options.h"
+#include "headless.h"
+#include "benchmark.h"
+#include "power-saving.h"
+#include "profiler.h"
+#include "logger.h"
+#include "batch-renderer.h"
+#include "shader-cache.h"
+#include "font-cache.h"
+#include "startup.h"
+#include "frame-pipeline.h"
+#include "frame-pacing.h"
+#include "list-view.h"
+#include "time-series.h"
+#include "imgui-renderer.h"
+#include "draw-recording.h"
+#include "input-recording.h"
+#include "allocation-tracker.h"
+#include "texture-streamer.h"
+#include "retained-layers.h"
+#include "dynamic-resolution.h"
+#include "mesh-loader.h"
+#include "particle-system.h"
+#include "telemetry.h"
+#include "controls.h"
 
 std::string programName = "GLFW and Dear ImGui";
 int windowWidth = 1200,
@@ -26,63 +61,295 @@ float backgroundR = 0.1f,
 std::filesystem::path currentPath = ".";
 std::filesystem::path basePath = ".";
 std::string fontName = "JetBrainsMono-ExtraLight.ttf";
+ApplicationOptions options;
+FontAtlasCache fontCache;
+// baked on a worker thread during startup, before there is a Dear ImGui context
+ImFontAtlas *fontAtlas = NULL;
+StartupPipeline startup;
 
 GLFWwindow *glfWindow = NULL;
-bool show_demo_window = false;
-bool show_another_window = false;
-int counter = 0;
-
-unsigned int shaderProgram, VBO, VAO;
+// state of the windows, composed by composeControls()
+ControlsState controls;
+// list view demo: a million of asset paths, generated in chunks while the window is open
+const int listViewItemsMax = 1000000;
+const int listViewItemsPerFrame = 25000;
+std::vector<std::string> listViewItems;
+int listViewItemsGenerated = 0;
+std::unique_ptr<ListView> listView;
+// telemetry: a synthetic high-rate signal from producer threads
+std::atomic<bool> signalGeneratorRunning{false};
+std::vector<std::thread> signalProducers;
+const int signalProducersCount = 2;
+// per producer, every millisecond
+const int signalSamplesPerBatch = 500;
+PowerSavingState powerSaving;
+// frame counters are shown with a delay, otherwise every rendered frame
+// would change the next one and power saving would never kick in
+uint64_t shownRenderedFrames = 0,
+         shownSkippedFrames = 0;
+std::chrono::time_point<std::chrono::steady_clock> shownFramesUpdated;
+FrameProfiler profiler;
+
+unsigned int shaderProgram;
+ShaderProgramCache shaderCache;
+ShaderWatcher shaderWatcher;
+std::vector<ShaderWatcher::WatchedStage> sceneShaderFiles;
+std::vector<ShaderStage> sceneShaderStages;
+// every mesh instance has its own offset, scale, rotation and color
 const char *vertexShaderSource = "#version 330 core\n"
     "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec4 aTransform;\n" // offset.xy, scale, rotation
+    "layout (location = 2) in vec4 aColor;\n"
+    "out vec4 color;\n"
     "void main()\n"
     "{\n"
-    "   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
+    "   float s = sin(aTransform.w), c = cos(aTransform.w);\n"
+    "   vec2 position = mat2(c, s, -s, c) * (aPos.xy * aTransform.z) + aTransform.xy;\n"
+    "   gl_Position = vec4(position, aPos.z, 1.0);\n"
+    "   color = aColor;\n"
     "}\0";
 const char *fragmentShaderSource = "#version 330 core\n"
+    "in vec4 color;\n"
     "out vec4 FragColor;\n"
     "void main()\n"
     "{\n"
-    "   FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
+    "   FragColor = color;\n"
     "}\n\0";
 
+BatchRenderer batchRenderer;
+int triangleMesh = -1,
+    quadMesh = -1,
+    hexagonMesh = -1;
+// amount of instances in stress test (controls.instances), 0 means just our triangle
+const int stressInstancesMax = 2000000;
+// the scene is drawn at a lower resolution when it takes too long on GPU,
+// the UI thread has its own copy of the settings
+DynamicResolution sceneResolution;
+// --mesh, loaded in the background and uploaded a part per frame,
+// it joins the scene once it's all on GPU
+MeshLoader meshLoader;
+int loadedMesh = -1;
+size_t meshUploadBudget = 16 * 1024 * 1024;
+// --particles, drawn instead of the meshes; the UI thread has its own copy of the settings
+ParticleSystem particles;
+const int particlesCountMax = 4000000;
+std::chrono::time_point<std::chrono::steady_clock> sceneAnimated;
+// triangles per second are counted over the last second
+uint64_t trianglesCounted = 0;
+double trianglesPerSecond = 0.0;
+std::chrono::time_point<std::chrono::steady_clock> trianglesCountStarted;
+// in pipelined mode the scene is drawn on the render thread,
+// so the UI shows a copy of its statistics made after every frame
+SceneStatistics sceneStatistics;
+std::mutex sceneStatisticsMutex;
+// UI thread builds frames, render thread submits and swaps them
+FramePipeline framePipeline;
+FramePacer framePacer;
+LatencyMeter inputLatency;
+// instead of the stock backend's RenderDrawData(), if enabled with --imgui-renderer
+ImGuiRenderer imguiRenderer;
+bool useImGuiRenderer = false;
+// static windows are drawn from textures, --retained-layers;
+// the UI thread marks the windows, the render thread owns the layers
+RetainedLayers retainedLayers;
+DrawDataRecorder drawDataRecorder;
+InputRecorder inputRecorder;
+// opened before the UI is built, as it has the DPI scale to build it with
+InputReplay inputReplay;
+AllocationTracker allocationTracker;
+// transient data of the frame being composed
+FrameArena frameArena;
+TimingStatistics shownInputLatency;
+// images of the custom window, decoded and uploaded in the background
+TextureStreamer textureStreamer;
+// sets of procedural images, so there is something to stream without any files
+const int generatedImageSets = 16,
+          generatedImagesPerSet = 4;
+std::vector<std::string> generatedImages;
+int imageSet = 0;
+// --telemetry, a record per frame in shared memory for external monitors
+TelemetryWriter telemetry;
+uint64_t telemetryFrames = 0;
+std::chrono::time_point<std::chrono::steady_clock> telemetryFrameEnded;
+
+// GL calls from the UI go through this, as in pipelined mode
+// only the render thread has the context
+void runOnRenderThread(std::function<void()> command)
+{
+    if (framePipeline.running()) { framePipeline.enqueueCommand(std::move(command)); }
+    else { command(); }
+}
+
 static void glfw_error_callback(int error, const char *description)
 {
-    std::cerr << "[ERROR] GLFW error: " << error << ", " << description << std::endl;
+    logError("GLFW error: %d, %s", error, description);
 }
 
 static void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    runOnRenderThread([width, height]() { glViewport(0, 0, width, height); });
+    powerSaving.forceRender = true;
+    if (inputRecorder.isOpen())
+    {
+        // cursor positions are in window coordinates, which are not pixels on high DPI displays
+        int currentWindowWidth = 0, currentWindowHeight = 0;
+        glfwGetWindowSize(window, &currentWindowWidth, &currentWindowHeight);
+        inputRecorder.resize(currentWindowWidth, currentWindowHeight, width, height, highDPIscaleFactor);
+    }
+}
+
+// input callbacks are only there to timestamp and record events,
+// Dear ImGui chains its own callbacks to these
+static void char_callback(GLFWwindow *window, unsigned int codepoint)
+{
+    inputLatency.inputReceived();
+    inputRecorder.character(codepoint);
+}
+
+static void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+    inputLatency.inputReceived();
+    inputRecorder.mouseButton(button, action, mods);
+}
+
+static void cursor_position_callback(GLFWwindow *window, double x, double y)
+{
+    inputLatency.inputReceived();
+    inputRecorder.cursorPosition(x, y);
+}
+
+static void scroll_callback(GLFWwindow *window, double xOffset, double yOffset)
+{
+    inputLatency.inputReceived();
+    inputRecorder.scroll(xOffset, yOffset);
+}
+
+// installed before Dear ImGui, which then chains its own callback to this one
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    inputLatency.inputReceived();
+    inputRecorder.key(key, scancode, action, mods);
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS && profiler.enabled)
+    {
+        auto timeNow = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::ostringstream tracePath;
+        tracePath << "frame-trace-" << timeNow << ".json";
+        profiler.dumpChromeTrace(tracePath.str());
+    }
+}
+
+// producers share the sample counter, so together they make one noisy sine wave
+void startSignalGenerator()
+{
+    signalGeneratorRunning = true;
+    auto sampleIndex = std::make_shared<std::atomic<uint64_t>>(0);
+    for (int p = 0; p < signalProducersCount; p++)
+    {
+        signalProducers.emplace_back([sampleIndex, p]()
+        {
+            std::mt19937 generator(p);
+            std::normal_distribution<float> noise(0.0f, 0.05f);
+            while (signalGeneratorRunning)
+            {
+                for (int i = 0; i < signalSamplesPerBatch; i++)
+                {
+                    uint64_t index = sampleIndex->fetch_add(1, std::memory_order_relaxed);
+                    controls.signalSeries.push(std::sin(index * 0.0001f) + noise(generator));
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+}
+
+void stopSignalGenerator()
+{
+    signalGeneratorRunning = false;
+    for (auto &producer : signalProducers) { producer.join(); }
+    signalProducers.clear();
 }
 
 void teardown()
 {
+    controls.listView = NULL;
+    listView.reset();
+    stopSignalGenerator();
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (!options.headless) { ImGui_ImplGlfw_Shutdown(); }
     ImGui::DestroyContext();
+    // the atlas is shared, so the context doesn't delete it
+    if (fontAtlas != NULL)
+    {
+        fontCache.release(fontAtlas);
+        fontAtlas->Locked = false;
+        IM_DELETE(fontAtlas);
+        fontAtlas = NULL;
+    }
 
+    shaderWatcher.stop();
+    imguiRenderer.shutdown();
+    RetainedLayersStatistics const &layers = retainedLayers.statistics();
+    if (layers.hits + layers.misses + layers.bypassed > 0)
+    {
+        logInfo(
+            "Retained layers: %.1f%% hit rate (%llu hits, %llu misses, %llu bypassed), about %.1f ms of GPU time saved",
+            layers.hitRate() * 100.0,
+            static_cast<unsigned long long>(layers.hits),
+            static_cast<unsigned long long>(layers.misses),
+            static_cast<unsigned long long>(layers.bypassed),
+            layers.gpuMillisecondsSaved
+        );
+    }
+    retainedLayers.shutdown();
+    sceneResolution.shutdown();
+    textureStreamer.shutdown();
+    meshLoader.shutdown();
+    particles.shutdown();
+    telemetry.close();
+    drawDataRecorder.close();
+    inputRecorder.close();
+    profiler.shutdown();
     // optional: de-allocate all resources once they've outlived their purpose
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    batchRenderer.shutdown();
     glDeleteProgram(shaderProgram);
 
+    if (options.headless)
+    {
+        teardownHeadless();
+        return;
+    }
+
     if (glfWindow != NULL) { glfwDestroyWindow(glfWindow); }
     glfwTerminate();
 }
 
+// in headless mode there is no window, so the offscreen framebuffer
+// has the size that the window would have had
+void getFramebufferSize(int *width, int *height)
+{
+    if (options.headless)
+    {
+        *width = windowWidth;
+        *height = windowHeight;
+    }
+    else
+    {
+        glfwGetFramebufferSize(glfWindow, width, height);
+    }
+}
+
 bool initializeGLFW()
 {
     glfwSetErrorCallback(glfw_error_callback);
 
     if (!glfwInit())
     {
-        std::cerr << "[ERROR] Couldn't initialize GLFW" << std::endl;
+        logError("Couldn't initialize GLFW");
         return false;
     }
     else
     {
-        std::cout << "[INFO] GLFW initialized" << std::endl;
+        logInfo("GLFW initialized");
     }
 
     glfwWindowHint(GLFW_DOUBLEBUFFER , 1);
@@ -117,7 +384,7 @@ bool initializeGLFW()
     GLFWmonitor *monitor = glfwGetPrimaryMonitor();
     float xscale, yscale;
     glfwGetMonitorContentScale(monitor, &xscale, &yscale);
-    std::cout << "[INFO] Monitor scale: " << xscale << "x" << yscale << std::endl;
+    logInfo("Monitor scale: %gx%g", xscale, yscale);
     if (xscale > 1 || yscale > 1)
     {
         highDPIscaleFactor = xscale;
@@ -129,6 +396,12 @@ bool initializeGLFW()
     glfwWindowHint(GLFW_COCOA_RETINA_FRAMEBUFFER, GLFW_FALSE);
 #endif
 
+    return true;
+}
+
+// takes the longest, so workers do CPU-only startup work meanwhile
+bool createWindow()
+{
     //const GLFWvidmode *mode = glfwGetVideoMode(monitor);
     //glfwWindowHint(GLFW_MAXIMIZED, GLFW_TRUE);
     glfWindow = glfwCreateWindow(
@@ -140,7 +413,7 @@ bool initializeGLFW()
     );
     if (!glfWindow)
     {
-        std::cerr << "[ERROR] Couldn't create a GLFW window" << std::endl;
+        logError("Couldn't create a GLFW window");
         return false;
     }
 
@@ -155,256 +428,1129 @@ bool initializeGLFW()
 
     // watch window resizing
     glfwSetFramebufferSizeCallback(glfWindow, framebuffer_size_callback);
+    // hotkeys
+    glfwSetKeyCallback(glfWindow, key_callback);
+    // input latency measurement
+    glfwSetCharCallback(glfWindow, char_callback);
+    glfwSetMouseButtonCallback(glfWindow, mouse_button_callback);
+    glfwSetCursorPosCallback(glfWindow, cursor_position_callback);
+    glfwSetScrollCallback(glfWindow, scroll_callback);
 
     glfwMakeContextCurrent(glfWindow);
-    // VSync
-    glfwSwapInterval(1);
+    // VSync (1 by default), 0 is uncapped
+    glfwSwapInterval(options.swapInterval);
+
+    const GLFWvidmode *videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    framePacer.configure(
+        options.targetFPS,
+        // swapping every N-th refresh
+        videoMode != NULL ? videoMode->refreshRate / static_cast<double>(std::max(options.swapInterval, 1)) : 0.0,
+        options.swapInterval > 0,
+        options.lateInput && !options.pipelined
+    );
 
-    std::cout << "[INFO] OpenGL from GLFW "
-              << glfwGetWindowAttrib(glfWindow, GLFW_CONTEXT_VERSION_MAJOR)
-              << "."
-              << glfwGetWindowAttrib(glfWindow, GLFW_CONTEXT_VERSION_MINOR)
-              << std::endl;
+    logInfo(
+        "OpenGL from GLFW %d.%d",
+        glfwGetWindowAttrib(glfWindow, GLFW_CONTEXT_VERSION_MAJOR),
+        glfwGetWindowAttrib(glfWindow, GLFW_CONTEXT_VERSION_MINOR)
+    );
 
     return true;
 }
 
-bool initializeGLAD()
+bool initializeGLAD(GLADloadproc loader)
 {
     // load all OpenGL function pointers with glad
     // without it not all the OpenGL functions will be available,
     // such as glGetString(GL_RENDERER), and application might just segfault
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (!gladLoadGLLoader(loader))
     {
-        std::cerr << "[ERROR] Couldn't initialize GLAD" << std::endl;
+        logError("Couldn't initialize GLAD");
         return false;
     }
     else
     {
-        std::cout << "[INFO] GLAD initialized" << std::endl;
+        logInfo("GLAD initialized");
     }
 
-    std::cout << "[INFO] OpenGL renderer: " << glGetString(GL_RENDERER) << std::endl;
-    std::cout << "[INFO] OpenGL from glad "
-              << GLVersion.major << "." << GLVersion.minor
-              << std::endl;
+    const char *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    logInfo("OpenGL renderer: %s", renderer != NULL ? renderer : "unknown");
+    logInfo("OpenGL from glad %d.%d", GLVersion.major, GLVersion.minor);
 
     return true;
 }
 
+// CPU only, runs on a worker thread
+bool bakeFontAtlas()
+{
+    fontAtlas = IM_NEW(ImFontAtlas)();
+    // baked atlas is loaded from the cache, if there is one
+    fontCache.setDirectory(options.fontCache);
+    return fontCache.addFont(fontAtlas, fontName, 24.0f, highDPIscaleFactor) != NULL;
+}
+
 bool initializeDearImGui()
 {
     IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    // font atlas is already baked by then
+    ImGui::CreateContext(fontAtlas);
 
     ImGuiIO& io = ImGui::GetIO(); (void)io;
 
-    io.Fonts->AddFontFromFileTTF(
-        fontName.c_str(),
-        24.0f * highDPIscaleFactor,
-        NULL,
-        NULL
-    );
     setImGuiStyle(highDPIscaleFactor);
 
     // setup platform/renderer bindings
-    if (!ImGui_ImplGlfw_InitForOpenGL(glfWindow, true)) { return false; }
+    if (options.headless)
+    {
+        // no window to get input and display size from, and benchmark runs
+        // should not depend on (or modify) imgui.ini left from interactive sessions
+        io.IniFilename = NULL;
+        io.DisplaySize = ImVec2(static_cast<float>(windowWidth), static_cast<float>(windowHeight));
+    }
+    else
+    {
+        if (!ImGui_ImplGlfw_InitForOpenGL(glfWindow, true)) { return false; }
+    }
     if (!ImGui_ImplOpenGL3_Init()) { return false; }
 
     return true;
 }
 
+bool initializeTextureStreaming()
+{
+    for (int i = 0; i < generatedImageSets * generatedImagesPerSet; i++)
+    {
+        generatedImages.push_back("generated:2048x2048:" + std::to_string(i));
+    }
+    TextureStreamerSettings settings;
+    settings.memoryBudget = static_cast<size_t>(options.textureBudget) * 1024 * 1024;
+    settings.uploadBudget = static_cast<size_t>(options.textureUploadBudget) * 1024 * 1024;
+    return textureStreamer.initialize(settings);
+}
+
+bool initializeDynamicResolution()
+{
+    DynamicResolutionSettings settings;
+    if (options.sceneBudget > 0.0) { settings.budgetMilliseconds = options.sceneBudget; }
+    settings.minimumScale = static_cast<float>(options.minimumSceneScale);
+    settings.maximumScale = static_cast<float>(std::max(options.minimumSceneScale, options.maximumSceneScale));
+    if (!sceneResolution.initialize(settings)) { return false; }
+    controls.dynamicResolution = sceneResolution.enabled = options.sceneBudget > 0.0;
+    controls.sceneBudget = static_cast<float>(settings.budgetMilliseconds);
+    return true;
+}
+
+bool initializeParticles()
+{
+    if (!particles.initialize(&shaderCache, options.particleThreads)) { return false; }
+    controls.particles = particles.enabled = options.particles > 0;
+    if (options.particles > 0) { controls.particlesCount = std::min(options.particles, particlesCountMax); }
+    particles.setBackend(options.particlesBackend == "cpu" ? ParticleBackend::CPU : ParticleBackend::GPU);
+    controls.particlesBackend = static_cast<int>(particles.statistics().backend);
+    // the particles are only generated once they are shown
+    if (controls.particles) { particles.setCount(controls.particlesCount); }
+    return true;
+}
+
+// CPU only, runs on a worker thread
+bool loadSceneShaderSources()
+{
+    sceneShaderStages =
+    {
+        { GL_VERTEX_SHADER, vertexShaderSource },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource }
+    };
+    // shaders from files can be edited while the application is running
+    if (!options.shaderDirectory.empty())
+    {
+        std::filesystem::path shaderDirectory = options.shaderDirectory;
+        sceneShaderFiles =
+        {
+            { GL_VERTEX_SHADER, shaderDirectory / "scene.vert" },
+            { GL_FRAGMENT_SHADER, shaderDirectory / "scene.frag" }
+        };
+        std::vector<ShaderStage> fileStages;
+        if (loadShaderFiles(sceneShaderFiles, sceneShaderStages, fileStages)) { sceneShaderStages = fileStages; }
+    }
+    return true;
+}
+
 // build and compile our shader program
 void buildShaderProgram()
 {
-    // vertex shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    // check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // link shaders
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    // check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
+    shaderCache.setDirectory(options.shaderCache);
+    shaderProgram = shaderCache.loadProgram(sceneShaderStages, "scene");
+    // if shaders from files are broken, there are still the built-in ones
+    if (shaderProgram == 0 && !options.shaderDirectory.empty())
+    {
+        logWarning("Falling back to the built-in scene shaders");
+        shaderProgram = shaderCache.loadProgram(
+            {
+                { GL_VERTEX_SHADER, vertexShaderSource },
+                { GL_FRAGMENT_SHADER, fragmentShaderSource }
+            },
+            "scene"
+        );
+    }
+
+    // set up vertex data (and buffer(s)) and configure vertex attributes,
+    // all the meshes share the same buffers of the batch renderer
     float vertices[] =
     {
         -0.5f, -0.5f, 0.0f, // left
          0.5f, -0.5f, 0.0f, // right
          0.0f,  0.5f, 0.0f  // top
     };
+    uint32_t triangleIndices[] = { 0, 1, 2 };
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s),
-    // and then configure vertex attributes(s)
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    float quadVertices[] =
+    {
+        -0.5f, -0.5f, 0.0f,
+         0.5f, -0.5f, 0.0f,
+         0.5f,  0.5f, 0.0f,
+        -0.5f,  0.5f, 0.0f
+    };
+    uint32_t quadIndices[] = { 0, 1, 2, 0, 2, 3 };
 
-    // note that this is allowed, the call to glVertexAttribPointer registered VBO
-    // as the vertex attribute's bound vertex buffer object so afterwards we can safely unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // center and 6 vertices around it
+    float hexagonVertices[7 * 3] = { 0.0f, 0.0f, 0.0f };
+    uint32_t hexagonIndices[6 * 3];
+    for (int i = 0; i < 6; i++)
+    {
+        float angle = i * 3.14159265f / 3.0f;
+        hexagonVertices[(i + 1) * 3 + 0] = 0.5f * std::cos(angle);
+        hexagonVertices[(i + 1) * 3 + 1] = 0.5f * std::sin(angle);
+        hexagonVertices[(i + 1) * 3 + 2] = 0.0f;
+        hexagonIndices[i * 3 + 0] = 0;
+        hexagonIndices[i * 3 + 1] = i + 1;
+        hexagonIndices[i * 3 + 2] = (i + 1) % 6 + 1;
+    }
 
-    // you can unbind the VAO afterwards so other VAO calls won't accidentally
-    // modify this VAO, but this rarely happens. Modifying other VAOs requires a call
-    // to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs)
-    // when it's not directly necessary
-    glBindVertexArray(0);
+    batchRenderer.initialize();
+    triangleMesh = batchRenderer.addMesh(vertices, 3, triangleIndices, 3);
+    quadMesh = batchRenderer.addMesh(quadVertices, 4, quadIndices, 6);
+    hexagonMesh = batchRenderer.addMesh(hexagonVertices, 7, hexagonIndices, 18);
 
     // uncomment this call to draw in wireframe polygons
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 }
 
+// either our triangle or a stress test with lots of random instances of all the meshes
+// CPU only, so on startup it runs on a worker thread
+std::vector<InstanceData> generateSceneInstances(int count)
+{
+    std::vector<InstanceData> instances;
+    if (count == 0)
+    {
+        InstanceData triangle;
+        triangle.color[0] = 1.0f;
+        triangle.color[1] = 0.5f;
+        triangle.color[2] = 0.2f;
+        instances.push_back(triangle);
+        return instances;
+    }
+
+    // always the same seed, so runs are comparable
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f),
+                                          scale(0.01f, 0.05f),
+                                          rotation(0.0f, 6.2831853f),
+                                          color(0.2f, 1.0f);
+    instances.resize(count);
+    for (auto &instance : instances)
+    {
+        instance.offset[0] = position(random);
+        instance.offset[1] = position(random);
+        instance.scale = scale(random);
+        instance.rotation = rotation(random);
+        instance.color[0] = color(random);
+        instance.color[1] = color(random);
+        instance.color[2] = color(random);
+    }
+    return instances;
+}
+
+// the loaded mesh is normalized to a unit cube, it goes to the right of the triangle
+void addLoadedMeshInstance()
+{
+    InstanceData instance;
+    instance.offset[0] = 0.5f;
+    instance.scale = 0.8f;
+    instance.color[0] = 0.6f;
+    instance.color[1] = 0.8f;
+    instance.color[2] = 1.0f;
+    batchRenderer.addInstance(loadedMesh, instance);
+}
+
+// the triangle alone or meshes one after another
+void populateScene(std::vector<InstanceData> const &instances)
+{
+    batchRenderer.clearInstances();
+
+    // the first one is the triangle
+    const int meshes[] = { triangleMesh, quadMesh, hexagonMesh };
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        batchRenderer.addInstance(meshes[i % 3], instances[i]);
+    }
+    if (loadedMesh >= 0) { addLoadedMeshInstance(); }
+
+    trianglesCounted = 0;
+    trianglesPerSecond = 0.0;
+    trianglesCountStarted = std::chrono::steady_clock::now();
+}
+
+// dynamic geometry: every instance is changed every frame
+void animateSceneInstances()
+{
+    auto now = std::chrono::steady_clock::now();
+    float elapsed = std::min(std::chrono::duration<float>(now - sceneAnimated).count(), 0.1f);
+    sceneAnimated = now;
+
+    for (int mesh : { triangleMesh, quadMesh, hexagonMesh })
+    {
+        std::vector<InstanceData> &instances = batchRenderer.meshInstances(mesh);
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            // different speeds and directions, so it doesn't look like one big rotation
+            instances[i].rotation += elapsed * (static_cast<float>(i % 7) - 3.0f);
+        }
+    }
+    batchRenderer.instancesUpdated();
+}
+
+// items are only appended, as the list view indexes them in the background
+void generateListViewItems(int count)
+{
+    if (listView == NULL)
+    {
+        // resized up front, so items that are already generated never move
+        listViewItems.resize(listViewItemsMax);
+        listView = std::make_unique<ListView>(vector_getter, &listViewItems);
+        listView->setResultsCallback([]() { glfwPostEmptyEvent(); });
+    }
+
+    const char *folders[] = { "textures", "models", "sounds", "shaders", "levels", "fonts", "scripts" };
+    const char *words[] = {
+        "rock", "grass", "water", "metal", "wood", "sky", "door", "wall", "crate", "barrel",
+        "tree", "lamp", "player", "enemy", "boss", "coin", "ui", "menu", "button", "icon"
+    };
+    const char *extensions[] = { "png", "obj", "wav", "glsl", "json", "ttf", "lua" };
+
+    std::mt19937 generator(listViewItemsGenerated);
+    int last = std::min(listViewItemsGenerated + count, listViewItemsMax);
+    for (int i = listViewItemsGenerated; i < last; i++)
+    {
+        int folder = static_cast<int>(generator() % IM_ARRAYSIZE(folders));
+        std::ostringstream path;
+        path << "assets/" << folders[folder] << '/'
+             << words[generator() % IM_ARRAYSIZE(words)] << '_'
+             << words[generator() % IM_ARRAYSIZE(words)] << '_'
+             << i << '.' << extensions[folder];
+        listViewItems[i] = path.str();
+    }
+    listViewItemsGenerated = last;
+    listView->setItemsCount(listViewItemsGenerated);
+}
+
+// thumbnails of the custom window, the textures are streamed in the background
+void drawCustomWindowImages()
+{
+    if (!textureStreamer.initialized()) { return; }
+
+    ImGui::SliderInt("image set", &imageSet, 0, generatedImageSets - 1);
+    const float thumbnailSize = 96.0f;
+    for (int i = 0; i < generatedImagesPerSet; i++)
+    {
+        if (i > 0) { ImGui::SameLine(); }
+        ImTextureID texture = textureStreamer.texture(generatedImages[imageSet * generatedImagesPerSet + i]);
+        ImGui::Image(texture, ImVec2(thumbnailSize, thumbnailSize));
+    }
+    for (std::string const &image : options.images)
+    {
+        // square until the size is known
+        int width = 1, height = 1;
+        ImTextureID texture = textureStreamer.texture(image);
+        textureStreamer.imageSize(image, width, height);
+        float scale = thumbnailSize * 2.0f / std::max(width, height);
+        ImGui::Image(texture, ImVec2(width * scale, height * scale));
+    }
+
+    TextureStreamerStatistics const textures = textureStreamer.statistics();
+    ImGui::Text(
+        "textures: %d resident (%.1f MB), %d decoding, %d uploading",
+        textures.resident,
+        textures.residentBytes / (1024.0 * 1024.0),
+        textures.decoding,
+        textures.uploading
+    );
+    ImGui::Text(
+        "uploaded last frame: %.1f MB, evictions: %llu",
+        textures.uploadedLastFrame / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(textures.evictions)
+    );
+    // uploads only happen in frames, so they have to keep coming
+    if (textures.decoding > 0 || textures.uploading > 0) { powerSaving.forceRender = true; }
+}
+
+// what the windows show this frame
+ControlsStatistics gatherControlsStatistics()
+{
+    ControlsStatistics statistics;
+    // get the window size as a base for calculating widgets geometry
+    getFramebufferSize(&statistics.windowWidth, &statistics.windowHeight);
+    statistics.glfwVersion = glfwGetVersionString();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - shownFramesUpdated >= std::chrono::seconds(1))
+    {
+        shownRenderedFrames = powerSaving.renderedFrames;
+        shownSkippedFrames = powerSaving.skippedFrames;
+        shownInputLatency = inputLatency.statistics();
+        shownFramesUpdated = now;
+    }
+    statistics.renderedFrames = shownRenderedFrames;
+    statistics.skippedFrames = shownSkippedFrames;
+    statistics.swapInterval = options.swapInterval;
+    statistics.targetFPS = options.targetFPS;
+    statistics.framePacing = framePacer.period() > 0.0 && !framePipeline.running();
+    statistics.frameWorkMilliseconds = framePacer.workEstimate();
+    statistics.inputLatency = shownInputLatency;
+    statistics.pipelined = framePipeline.running();
+    statistics.pipelineDepth = options.pipelineDepth;
+    statistics.pipelineBlockedMilliseconds = framePipeline.blockedMilliseconds();
+    statistics.profilerFrames = FrameProfiler::historySize;
+    statistics.imguiRenderer = useImGuiRenderer;
+    statistics.persistentlyMapped = imguiRenderer.persistentlyMapped();
+    statistics.retainedLayers = retainedLayers.initialized();
+
+    statistics.allocationTracking = allocationTrackingEnabled();
+    statistics.allocations = allocationTracker.lastFrame();
+    statistics.liveHeapBytes = liveHeapBytes();
+    statistics.peakLiveBytes = allocationTracker.peakLiveBytes();
+    statistics.framesWithoutAllocations = allocationTracker.framesWithoutAllocations();
+    statistics.arenaHighWater = frameArena.highWater();
+    statistics.arenaCapacity = frameArena.capacity();
+    statistics.shaderCacheHits = shaderCache.hits();
+    statistics.shaderCacheMisses = shaderCache.misses();
+    statistics.shaderCacheRejected = shaderCache.rejected();
+
+    statistics.instancesMax = stressInstancesMax;
+    {
+        std::lock_guard<std::mutex> lock(sceneStatisticsMutex);
+        statistics.scene = sceneStatistics;
+    }
+    statistics.particles = particles.initialized();
+    statistics.particlesCountMax = particlesCountMax;
+    statistics.dynamicResolution = sceneResolution.initialized();
+    statistics.mesh = !options.mesh.empty();
+    return statistics;
+}
+
+// passes what was edited in the windows on to the rest of the application,
+// GL objects are changed on the render thread
+void applyControlsChanges(ControlsChanges const &changes)
+{
+    if (changes.forceRender) { powerSaving.forceRender = true; }
+    if (changes.powerSaving)
+    {
+        powerSaving.enabled = controls.powerSaving;
+        powerSaving.forceRender = true;
+    }
+    if (changes.lateInput) { framePacer.lateInput = controls.lateInput; }
+    if (changes.profiler) { profiler.enabled = controls.profiler; }
+    if (changes.retainWindows)
+    {
+        bool retain = controls.retainWindows;
+        runOnRenderThread([retain]() { retainedLayers.enabled = retain; });
+    }
+    if (changes.instances)
+    {
+        auto instances = std::make_shared<std::vector<InstanceData>>(generateSceneInstances(controls.instances));
+        runOnRenderThread([instances]() { populateScene(*instances); });
+    }
+    if (changes.animate)
+    {
+        bool animate = controls.animate;
+        runOnRenderThread(
+            [animate]()
+            {
+                batchRenderer.setStreamInstances(animate);
+                sceneAnimated = std::chrono::steady_clock::now();
+            }
+        );
+    }
+    if (changes.particles)
+    {
+        bool show = controls.particles;
+        int count = controls.particlesCount;
+        runOnRenderThread(
+            [show, count]()
+            {
+                particles.enabled = show;
+                if (show) { particles.setCount(count); }
+            }
+        );
+    }
+    if (changes.particlesCount)
+    {
+        int count = controls.particlesCount;
+        runOnRenderThread([count]() { particles.setCount(count); });
+    }
+    if (changes.particlesBackend)
+    {
+        ParticleBackend backend = static_cast<ParticleBackend>(controls.particlesBackend);
+        runOnRenderThread([backend]() { particles.setBackend(backend); });
+    }
+    if (changes.validateParticles) { runOnRenderThread([]() { particles.validate(); }); }
+    if (changes.dynamicResolution)
+    {
+        bool enable = controls.dynamicResolution;
+        runOnRenderThread([enable]() { sceneResolution.enabled = enable; });
+    }
+    if (changes.sceneBudget)
+    {
+        double budget = controls.sceneBudget;
+        runOnRenderThread([budget]() { sceneResolution.settings.budgetMilliseconds = budget; });
+    }
+    if (changes.signalGenerator)
+    {
+        if (controls.signalGenerator) { startSignalGenerator(); }
+        else { stopSignalGenerator(); }
+    }
+}
+
 void composeDearImGuiFrame()
 {
+    // a frame of the UI thread lasts from one composition to the next
+    allocationTracker.frameStarted();
+    frameArena.reset();
+
     ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (options.headless)
+    {
+        // fixed timestep, so every benchmark run builds exactly the same frames
+        ImGui::GetIO().DeltaTime = 1.0f / 60.0f;
+    }
+    else
+    {
+        ImGui_ImplGlfw_NewFrame();
+    }
 
     ImGui::NewFrame();
+    // input received from now on goes to the next frame
+    inputRecorder.frameComposed();
 
-    // standard demo window
-    if (show_demo_window) { ImGui::ShowDemoWindow(&show_demo_window); }
-
-    // a window is defined by Begin/End pair
-    {
-        int glfw_width = 0, glfw_height = 0, controls_width = 0;
-        // get the window size as a base for calculating widgets geometry
-        glfwGetFramebufferSize(glfWindow, &glfw_width, &glfw_height);
-        controls_width = glfw_width;
-        // make controls widget width to be 1/3 of the main window width
-        if ((controls_width /= 3) < 300) { controls_width = 300; }
-
-        // position the controls widget in the top-right corner with some margin
-        ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
-        // here we set the calculated width and also make the height to be
-        // be the height of the main window also with some margin
-        ImGui::SetNextWindowSize(
-            ImVec2(static_cast<float>(controls_width), static_cast<float>(glfw_height - 20)),
-            ImGuiCond_Always
-            );
+    // a chunk of items every frame while the list view is shown
+    if (controls.showListView && listViewItemsGenerated < listViewItemsMax)
+    {
+        generateListViewItems(listViewItemsPerFrame);
+        controls.listView = listView.get();
+        controls.listViewItems = &listViewItems;
+        powerSaving.forceRender = true;
+    }
+
+    // these can also change outside of the windows
+    controls.powerSaving = powerSaving.enabled;
+    controls.lateInput = framePacer.lateInput;
+    controls.profiler = profiler.enabled;
+
+    static const ControlsHooks hooks = {
+        []() { profiler.drawGraph(); },
+        drawCustomWindowImages
+    };
+    applyControlsChanges(composeControls(controls, gatherControlsStatistics(), hooks, frameArena));
+}
+
+// texture of the font atlas, created by the backend on its first NewFrame()
+ImTextureID fontTextureID()
+{
+#if IMGUI_VERSION_NUM >= 19200
+    return ImGui::GetIO().Fonts->TexRef.GetTexID();
+#else
+    return ImGui::GetIO().Fonts->TexID;
+#endif
+}
+
+// builds the Dear ImGui frame, no GL calls yet
+void buildFrame()
+{
+    {
+        ProfilerScope phase(profiler, FramePhase::ComposeUI);
+        composeDearImGuiFrame();
+    }
+    {
+        ProfilerScope phase(profiler, FramePhase::ImGuiRender);
+        ImGui::Render();
+    }
+}
 
-        ImGui::SetNextWindowBgAlpha(0.7f);
-        // create a window and append into it
-        ImGui::Begin("Controls", NULL, ImGuiWindowFlags_NoResize);
+void renderDearImGui(ImDrawData *drawData)
+{
+    if (useImGuiRenderer) { imguiRenderer.render(drawData); }
+    else { ImGui_ImplOpenGL3_RenderDrawData(drawData); }
+}
+
+// submits the scene and the already built Dear ImGui frame to GL
+void submitFrame(ImDrawData *drawData)
+{
+    // the frame starts with a clean scene
+    {
+        ProfilerScope phase(profiler, FramePhase::Clear);
+        // with dynamic resolution the scene (and so the clear) goes into its own target
+        sceneResolution.beginScene();
+        glClearColor(backgroundR, backgroundG, backgroundB, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    }
+
+    // a part of the mesh every frame, so a big one doesn't stall any of them
+    int completedMesh = meshLoader.update(batchRenderer, meshUploadBudget);
+    if (completedMesh >= 0)
+    {
+        loadedMesh = completedMesh;
+        addLoadedMeshInstance();
+    }
+
+    // draw our triangle (or the whole stress test batch)
+    {
+        ProfilerScope phase(profiler, FramePhase::Scene);
+        // that's the render thread's copy of the animate flag
+        if (batchRenderer.streamingInstances()) { animateSceneInstances(); }
+        if (particles.enabled)
+        {
+            particles.update();
+            particles.draw();
+        }
+        else
+        {
+            glUseProgram(shaderProgram);
+            batchRenderer.draw();
+        }
+        // upscaled into the window before the UI, which stays at the native resolution
+        sceneResolution.endScene();
+    }
+
+    if (!particles.enabled) { trianglesCounted += batchRenderer.statistics().triangles; }
+    auto now = std::chrono::steady_clock::now();
+    double countedSeconds = std::chrono::duration<double>(now - trianglesCountStarted).count();
+    if (countedSeconds >= 1.0)
+    {
+        trianglesPerSecond = trianglesCounted / countedSeconds;
+        trianglesCounted = 0;
+        trianglesCountStarted = now;
+        if (controls.instances > 0)
+        {
+            logInfo(
+                "Stress test: %d instances, %.1f M triangles per second",
+                controls.instances,
+                trianglesPerSecond / 1000000.0
+            );
+        }
+    }
 
-        ImGui::Dummy(ImVec2(0.0f, 1.0f));
-        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Time");
-        ImGui::Text("%s", currentTime(std::chrono::system_clock::now()).c_str());
+    // textures of this frame have to be there before Dear ImGui draws them
+    textureStreamer.update();
 
-        ImGui::Dummy(ImVec2(0.0f, 3.0f));
-        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Application");
-        ImGui::Text("Main window width: %d", glfw_width);
-        ImGui::Text("Main window height: %d", glfw_height);
+    // Dear ImGui frame
+    if (drawDataRecorder.isOpen()) { drawDataRecorder.recordFrame(drawData, fontTextureID()); }
+    {
+        ProfilerScope phase(profiler, FramePhase::ImGuiSubmit);
+        renderDearImGui(retainedLayers.prepare(drawData, renderDearImGui));
+    }
 
-        ImGui::Dummy(ImVec2(0.0f, 3.0f));
-        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "GLFW");
-        ImGui::Text("%s", glfwGetVersionString());
+    std::lock_guard<std::mutex> lock(sceneStatisticsMutex);
+    sceneStatistics.batch = batchRenderer.statistics();
+    sceneStatistics.multiDrawIndirect = batchRenderer.usingMultiDrawIndirect();
+    sceneStatistics.trianglesPerSecond = trianglesPerSecond;
+    sceneStatistics.streamWrites = batchRenderer.instancesStream().writes();
+    sceneStatistics.streamFenceWaits = batchRenderer.instancesStream().fenceWaits();
+    sceneStatistics.streamFenceWaitMilliseconds = batchRenderer.instancesStream().fenceWaitMilliseconds();
+    sceneStatistics.imgui = imguiRenderer.statistics();
+    sceneStatistics.retainedLayers = retainedLayers.statistics();
+    sceneStatistics.resolution = sceneResolution.statistics();
+    sceneStatistics.mesh = meshLoader.statistics();
+    sceneStatistics.particles = particles.statistics();
+}
 
-        ImGui::Dummy(ImVec2(0.0f, 3.0f));
-        ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Dear ImGui");
-        ImGui::Text("%s", IMGUI_VERSION);
+// the first frame is the end of startup
+void frameSwapped()
+{
+    if (!startup.firstFrameReached())
+    {
+        startup.firstFrame();
+        if (options.startupReport) { startup.printReport(); }
+    }
+}
 
-        ImGui::Dummy(ImVec2(0.0f, 10.0f));
-        ImGui::Separator();
-        ImGui::Dummy(ImVec2(0.0f, 10.0f));
+// hands the context over to the render thread
+void startPipeline(
+    std::function<void()> const &attachContext,
+    std::function<void()> const &detachContext,
+    std::function<void()> const &swap
+)
+{
+    // GPU queries would need the context on both threads
+    profiler.enabled = false;
+    // creates Dear ImGui device objects while the context is still here,
+    // after that its NewFrame() doesn't make any GL calls
+    ImGui_ImplOpenGL3_NewFrame();
 
-        // buttons and most other widgets return true when clicked/edited/activated
-        if (ImGui::Button("Counter button"))
+    detachContext();
+    framePipeline.start(
+        options.pipelineDepth,
+        attachContext,
+        detachContext,
+        [swap](ImDrawData *drawData)
         {
-            std::cout << "counter button clicked" << std::endl;
-            counter++;
-            if (counter == 9) { ImGui::OpenPopup("Easter egg"); }
+            submitFrame(drawData);
+            swap();
         }
-        ImGui::SameLine();
-        ImGui::Text("counter = %d", counter);
+    );
+    logInfo("Pipelined rendering, up to %d frames ahead", options.pipelineDepth);
+}
+
+// renders what's left and takes the context back
+void stopPipeline(std::function<void()> const &attachContext)
+{
+    framePipeline.stop();
+    attachContext();
+}
+
+static_assert(framePhasesCount <= telemetryPhasesMax, "telemetry records don't have room for all the phases");
+
+// only stores into the shared memory, so it can be done every frame
+void publishTelemetry(bool rendered)
+{
+    if (!telemetry.isOpen()) { return; }
+
+    auto now = std::chrono::steady_clock::now();
+    TelemetryRecord record;
+    record.frameIndex = telemetryFrames++;
+    record.timestampMicroseconds = telemetry.microsecondsSinceOpen();
+    record.frameMilliseconds = std::chrono::duration<double, std::milli>(now - telemetryFrameEnded).count();
+    telemetryFrameEnded = now;
+
+    // a disabled profiler (always in pipelined mode) still has its last frames
+    const FrameTiming *frame = profiler.enabled ? profiler.lastFrame() : NULL;
+    const FrameTiming *gpuFrame = profiler.enabled ? profiler.lastGpuFrame() : NULL;
+    for (int p = 0; p < framePhasesCount; p++)
+    {
+        if (frame != NULL) { record.cpuPhaseMilliseconds[p] = frame->phases[p].cpuDuration / 1000.0; }
+        if (gpuFrame != NULL) { record.gpuPhaseMilliseconds[p] = gpuFrame->phases[p].gpuDuration / 1000.0; }
+    }
+    record.cpuPhasesValid = frame != NULL ? 1 : 0;
+    record.gpuPhasesValid = gpuFrame != NULL ? 1 : 0;
+    if (gpuFrame != NULL) { record.gpuFrameIndex = gpuFrame->frameIndex; }
+
+    record.rendered = rendered ? 1 : 0;
+    record.renderedFrames = powerSaving.renderedFrames;
+    record.skippedFrames = powerSaving.skippedFrames;
+    FrameAllocationStatistics const &allocations = allocationTracker.lastFrame();
+    record.allocations = allocations.allocations;
+    record.allocatedBytes = allocations.bytes;
+    record.imguiAllocations = allocations.imguiAllocations;
+
+    // in pipelined mode that's the UI thread, and the scene is on the render thread
+    BatchStatistics batch;
+    if (framePipeline.running())
+    {
+        std::lock_guard<std::mutex> lock(sceneStatisticsMutex);
+        batch = sceneStatistics.batch;
+    }
+    else { batch = batchRenderer.statistics(); }
+    // the UI side of the checkbox, particles.enabled belongs to the render thread
+    if (!controls.particles)
+    {
+        record.sceneDrawCalls = batch.drawCalls;
+        record.sceneTriangles = batch.triangles;
+    }
+    ImDrawData *drawData = ImGui::GetDrawData();
+    if (drawData != NULL)
+    {
+        for (int i = 0; i < drawData->CmdListsCount; i++) { record.imguiDrawCalls += drawData->CmdLists[i]->CmdBuffer.Size; }
+        record.imguiVertices = drawData->TotalVtxCount;
+    }
+    telemetry.publish(record);
+}
+
+void renderFrame()
+{
+    buildFrame();
+    submitFrame(ImGui::GetDrawData());
+}
+
+bool initializeHeadless()
+{
+    if (!initializeHeadlessContext()) { return false; }
+    if (!initializeGLAD(headlessProcAddressLoader())) { return false; }
+    return initializeHeadlessFramebuffer(windowWidth, windowHeight);
+}
+
+// renders the same dense frame (with the demo window open) with both Dear ImGui renderers
+std::string imguiRenderersJSON()
+{
+    if (!imguiRenderer.initialized()) { return ""; }
 
-        if (ImGui::BeginPopupModal("Easter egg", NULL))
+    const int iterations = 300;
+    bool demoWindowShown = controls.showDemoWindow;
+    controls.showDemoWindow = true;
+    buildFrame();
+    controls.showDemoWindow = demoWindowShown;
+    ImDrawData *drawData = ImGui::GetDrawData();
+
+    auto measure = [drawData](bool persistent, TimingStatistics &submit, TimingStatistics &finished)
+    {
+        auto render = [drawData, persistent]()
+        {
+            if (persistent) { imguiRenderer.render(drawData); }
+            else { ImGui_ImplOpenGL3_RenderDrawData(drawData); }
+        };
+        for (int i = 0; i < 10; i++) { render(); }
+        glFinish();
+
+        std::vector<double> submitTimes, finishedTimes;
+        for (int i = 0; i < iterations; i++)
         {
-            ImGui::Text("Ho-ho, you found me!");
-            if (ImGui::Button("Buy Ultimate Orb")) { ImGui::CloseCurrentPopup(); }
-            ImGui::EndPopup();
+            auto start = std::chrono::steady_clock::now();
+            render();
+            auto submitted = std::chrono::steady_clock::now();
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            submitTimes.push_back(std::chrono::duration<double, std::milli>(submitted - start).count());
+            finishedTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
         }
+        submit = calculateTimingStatistics(submitTimes);
+        finished = calculateTimingStatistics(finishedTimes);
+    };
+
+    TimingStatistics stockSubmit, stockFinished, persistentSubmit, persistentFinished;
+    measure(false, stockSubmit, stockFinished);
+    measure(true, persistentSubmit, persistentFinished);
+    ImGuiRendererStatistics const &statistics = imguiRenderer.statistics();
+
+    std::ostringstream json;
+    json << "  \"imgui_renderers\": {"
+         << "\"iterations\": " << iterations
+         << ", \"draw_lists\": " << drawData->CmdListsCount
+         << ", \"vertices\": " << drawData->TotalVtxCount
+         << ", \"indices\": " << drawData->TotalIdxCount
+         << ", \"commands\": " << statistics.commands
+         << ",\n    \"stock\": {\"submit_ms\": " << timingStatisticsJSON(stockSubmit)
+         << ", \"finished_ms\": " << timingStatisticsJSON(stockFinished) << "}"
+         << ",\n    \"persistent\": {\"submit_ms\": " << timingStatisticsJSON(persistentSubmit)
+         << ", \"finished_ms\": " << timingStatisticsJSON(persistentFinished)
+         << ", \"ranges\": " << statistics.ranges
+         << ", \"draw_calls\": " << statistics.drawCalls
+         << ", \"texture_binds\": " << statistics.textureBinds
+         << ", \"scissor_changes\": " << statistics.scissorChanges
+         << ", \"persistently_mapped\": " << (imguiRenderer.persistentlyMapped() ? "true" : "false") << "}"
+         << ",\n    \"submit_speedup\": "
+         << (persistentSubmit.median > 0.0 ? stockSubmit.median / persistentSubmit.median : 0.0)
+         << "},\n";
+    return json.str();
+}
 
-        ImGui::Dummy(ImVec2(0.0f, 15.0f));
-        if (!show_demo_window)
+// renders frames offscreen through the same path as the windowed loop
+// and reports frame times statistics as JSON
+bool runHeadlessBenchmark()
+{
+    int frames = options.benchmarkFrames;
+    if (frames == 0 && options.benchmarkSeconds == 0.0) { frames = benchmarkDefaultFrames; }
+
+    // the pipelined run can't have it, and both runs have to measure the same work
+    if (options.pipelined && profiler.enabled)
+    {
+        logWarning("The frame profiler is not available with --pipelined, the report has no phases");
+        profiler.enabled = false;
+    }
+
+    std::vector<double> frameTimes = runFrameLoop(
+        []()
         {
-            if (ImGui::Button("Open standard demo"))
+            profiler.beginFrame();
+            renderFrame();
             {
-                show_demo_window = true;
+                // there is no swap to wait for, so make sure that
+                // the frame is actually finished before measuring it
+                ProfilerScope phase(profiler, FramePhase::Swap);
+                glFinish();
             }
-        }
+            profiler.endFrame();
+            publishTelemetry(true);
+            frameSwapped();
+        },
+        options.benchmarkWarmupFrames,
+        frames,
+        options.benchmarkSeconds
+    );
+    TimingStatistics statistics = calculateTimingStatistics(frameTimes);
 
-        ImGui::Checkbox("show a custom window", &show_another_window);
-        if (show_another_window)
+    // only with --profile, there are no timings otherwise
+    std::ostringstream phases;
+    if (profiler.enabled)
+    {
+        double cpuAverages[framePhasesCount], gpuAverages[framePhasesCount];
+        profiler.averagePhaseDurations(FrameProfiler::historySize, cpuAverages, gpuAverages);
+        phases << "  \"phases_ms\": {\n";
+        for (int p = 0; p < framePhasesCount; p++)
         {
-            ImGui::SetNextWindowSize(
-                ImVec2(250.0f, 150.0f),
-                ImGuiCond_FirstUseEver // after first launch it will use values from imgui.ini
-                );
-            // the window will have a closing button that will clear the bool variable
-            ImGui::Begin("A custom window", &show_another_window);
+            phases << (p == 0 ? "" : ",\n")
+                   << "    \"" << framePhaseName(static_cast<FramePhase>(p)) << "\": "
+                   << "{\"cpu\": " << cpuAverages[p] << ", \"gpu\": " << gpuAverages[p] << "}";
+        }
+        phases << "\n  },\n";
+    }
 
-            ImGui::Dummy(ImVec2(0.0f, 1.0f));
-            ImGui::TextColored(ImVec4(1.0f, 0.0f, 1.0f, 1.0f), "Some label");
+    std::string imguiRenderers = imguiRenderersJSON();
 
-            ImGui::TextColored(ImVec4(128 / 255.0f, 128 / 255.0f, 128 / 255.0f, 1.0f), "%s", "another label");
-            ImGui::Dummy(ImVec2(0.0f, 0.5f));
+    // both backends against the scalar code, at the state the particles have reached
+    if (particles.enabled) { particles.validate(); }
+    ParticleStatistics const &particlesStatistics = particles.statistics();
 
-            ImGui::Dummy(ImVec2(0.0f, 1.0f));
-            if (ImGui::Button("Close"))
+    // the same frames once again, but built and rendered on different threads
+    std::ostringstream pipelined;
+    if (options.pipelined)
+    {
+        startPipeline(
+            []() { makeHeadlessContextCurrent(true); },
+            []() { makeHeadlessContextCurrent(false); },
+            []() { glFinish(); }
+        );
+        // when the queue is full, the UI thread waits for the render thread,
+        // so in the long run it builds frames as fast as they are rendered
+        std::vector<double> pipelinedFrameTimes = runFrameLoop(
+            []()
             {
-                std::cout << "close button clicked" << std::endl;
-                show_another_window = false;
-            }
+                buildFrame();
+                framePipeline.submit(ImGui::GetDrawData());
+            },
+            options.benchmarkWarmupFrames,
+            frames,
+            options.benchmarkSeconds
+        );
+        // frames still in the queue are a part of the run, so it lasts until the last one is swapped
+        auto drainStart = std::chrono::steady_clock::now();
+        framePipeline.drain();
+        if (!pipelinedFrameTimes.empty())
+        {
+            pipelinedFrameTimes.back() += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - drainStart
+            ).count();
+        }
+        double blockedMilliseconds = framePipeline.blockedMilliseconds();
+        stopPipeline([]() { makeHeadlessContextCurrent(true); });
+
+        TimingStatistics pipelinedStatistics = calculateTimingStatistics(pipelinedFrameTimes);
+        double sequentialFPS = statistics.total > 0.0 ? statistics.count / (statistics.total / 1000.0) : 0.0;
+        double pipelinedFPS = pipelinedStatistics.total > 0.0
+            ? pipelinedStatistics.count / (pipelinedStatistics.total / 1000.0)
+            : 0.0;
+        pipelined << "  \"pipelined\": {"
+                  << "\"depth\": " << options.pipelineDepth
+                  << ", \"frames\": " << pipelinedStatistics.count
+                  << ", \"frame_time_ms\": " << timingStatisticsJSON(pipelinedStatistics)
+                  << ", \"ui_blocked_ms\": " << blockedMilliseconds
+                  << ", \"sequential_fps\": " << sequentialFPS
+                  << ", \"pipelined_fps\": " << pipelinedFPS
+                  << ", \"throughput_gain\": " << (sequentialFPS > 0.0 ? pipelinedFPS / sequentialFPS : 0.0)
+                  << "},\n";
+    }
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"renderer\": \"" << jsonEscape(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) << "\",\n"
+           << "  \"gl_version\": \"" << jsonEscape(reinterpret_cast<const char*>(glGetString(GL_VERSION))) << "\",\n"
+           << "  \"time_to_first_frame_ms\": " << startup.timeToFirstFrame() << ",\n"
+           << "  \"font_atlas\": {\"ms\": " << fontCache.milliseconds()
+           << ", \"from_cache\": " << (fontCache.loadedFromCache() ? "true" : "false") << "},\n"
+           << "  \"width\": " << windowWidth << ",\n"
+           << "  \"height\": " << windowHeight << ",\n"
+           << "  \"warmup_frames\": " << options.benchmarkWarmupFrames << ",\n"
+           << "  " << frameTimeStatisticsJSON(statistics) << ",\n"
+           << phases.str()
+           << pipelined.str()
+           << imguiRenderers
+           << "  \"heap\": {"
+           << "\"tracking\": " << (allocationTrackingEnabled() ? "true" : "false")
+           << ", \"allocations_last_frame\": " << allocationTracker.lastFrame().allocations
+           << ", \"imgui_allocations_last_frame\": " << allocationTracker.lastFrame().imguiAllocations
+           << ", \"frames_without_allocations\": " << allocationTracker.framesWithoutAllocations()
+           << ", \"peak_bytes\": " << allocationTracker.peakLiveBytes()
+           << ", \"frame_arena_high_water\": " << frameArena.highWater()
+           << "},\n"
+           << "  \"scene\": {"
+           << "\"instances\": " << batchRenderer.statistics().instances
+           << ", \"triangles_per_frame\": " << batchRenderer.statistics().triangles
+           << ", \"draw_calls\": " << batchRenderer.statistics().drawCalls
+           << ", \"animated\": " << (controls.animate ? "true" : "false")
+           << ", \"stream_fence_waits\": " << batchRenderer.instancesStream().fenceWaits()
+           << ", \"triangles_per_second\": "
+           << (statistics.total > 0.0 ? batchRenderer.statistics().triangles * statistics.count / (statistics.total / 1000.0) : 0.0)
+           << "},\n"
+           << "  \"particles\": {"
+           << "\"count\": " << (particles.enabled ? particlesStatistics.count : 0)
+           << ", \"backend\": \"" << (particlesStatistics.backend == ParticleBackend::GPU ? "gpu" : "cpu") << "\""
+           << ", \"threads\": " << particlesStatistics.threads
+           << ", \"simd\": \"" << particlesStatistics.simd << "\""
+           << ", \"simulation_ms\": " << particlesStatistics.simulationMilliseconds
+           << ", \"render_ms\": " << particlesStatistics.renderMilliseconds
+           << ", \"simd_difference\": " << particlesStatistics.scalarDifference
+           << ", \"gpu_difference\": " << particlesStatistics.gpuDifference
+           << "}\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), options.benchmarkOutput);
+}
+
+// renders frames of a draw data recording (and nothing else)
+// one after another and reports how fast that goes
+bool runDrawDataReplay()
+{
+    // creates the font texture, which replaces the recorded one
+    ImGui_ImplOpenGL3_NewFrame();
+
+    DrawDataReplay replay;
+    if (!replay.open(options.replayDrawData, fontTextureID())) { return false; }
+    logInfo(
+        "Replaying %d frames of draw data (%.1f MB) from %s",
+        replay.framesCount(),
+        replay.fileSize() / 1024.0 / 1024.0,
+        options.replayDrawData.c_str()
+    );
+
+    // by default every recorded frame is rendered once
+    int frames = options.benchmarkFrames;
+    if (frames == 0 && options.benchmarkSeconds == 0.0) { frames = replay.framesCount(); }
+    int nextFrame = 0;
+    std::vector<double> frameTimes = runFrameLoop(
+        [&replay, &nextFrame]()
+        {
+            ImDrawData *drawData = replay.frame(nextFrame);
+            nextFrame = (nextFrame + 1) % replay.framesCount();
+            glClearColor(backgroundR, backgroundG, backgroundB, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (useImGuiRenderer) { imguiRenderer.render(drawData); }
+            else { ImGui_ImplOpenGL3_RenderDrawData(drawData); }
+            glFinish();
+        },
+        options.benchmarkWarmupFrames,
+        frames,
+        options.benchmarkSeconds
+    );
+    TimingStatistics statistics = calculateTimingStatistics(frameTimes);
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"renderer\": \"" << jsonEscape(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) << "\",\n"
+           << "  \"gl_version\": \"" << jsonEscape(reinterpret_cast<const char*>(glGetString(GL_VERSION))) << "\",\n"
+           << "  \"imgui_renderer\": \"" << (useImGuiRenderer ? "persistent" : "stock") << "\",\n"
+           << "  \"recording\": \"" << jsonEscape(options.replayDrawData) << "\",\n"
+           << "  \"recorded_frames\": " << replay.framesCount() << ",\n"
+           << "  \"file_bytes\": " << replay.fileSize() << ",\n"
+           << "  \"file_bytes_per_frame\": " << static_cast<double>(replay.fileSize()) / replay.framesCount() << ",\n"
+           << "  \"draw_data_bytes_per_frame\": " << replay.drawDataBytesPerFrame() << ",\n"
+           << "  \"warmup_frames\": " << options.benchmarkWarmupFrames << ",\n"
+           << "  " << frameTimeStatisticsJSON(statistics) << ",\n"
+           << "  \"fps\": " << (statistics.total > 0.0 ? statistics.count / (statistics.total / 1000.0) : 0.0) << "\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), options.benchmarkOutput);
+}
+
+// replays a recorded session frame by frame with a fixed timestep
+// and reports how long it took to build and submit every frame
+bool runInputReplay()
+{
+    InputReplay &replay = inputReplay;
+    logInfo("Replaying %d frames of input from %s", replay.framesCount(), options.replayInput.c_str());
+
+    struct FrameCosts
+    {
+        int events = 0;
+        double compose = 0.0,
+               render = 0.0,
+               submit = 0.0;
+        int vertices = 0;
+    };
+    std::vector<FrameCosts> costs(replay.framesCount());
+    std::vector<double> composeTimes, totalTimes;
+    ImGuiIO &io = ImGui::GetIO();
+    for (int frame = 0; frame < replay.framesCount(); frame++)
+    {
+        FrameCosts &cost = costs[frame];
+        cost.events = replay.apply(frame, io);
+        if (replay.displayWidth() > 0 && (replay.displayWidth() != windowWidth || replay.displayHeight() != windowHeight))
+        {
+            windowWidth = replay.displayWidth();
+            windowHeight = replay.displayHeight();
+            resizeHeadlessFramebuffer(windowWidth, windowHeight);
+        }
 
-            ImGui::End();
+        profiler.beginFrame();
+        auto start = std::chrono::steady_clock::now();
+        {
+            ProfilerScope phase(profiler, FramePhase::ComposeUI);
+            composeDearImGuiFrame();
         }
+        auto composed = std::chrono::steady_clock::now();
+        {
+            ProfilerScope phase(profiler, FramePhase::ImGuiRender);
+            ImGui::Render();
+        }
+        auto rendered = std::chrono::steady_clock::now();
+        submitFrame(ImGui::GetDrawData());
+        {
+            ProfilerScope phase(profiler, FramePhase::Swap);
+            glFinish();
+        }
+        auto finished = std::chrono::steady_clock::now();
+        profiler.endFrame();
+
+        cost.compose = std::chrono::duration<double, std::milli>(composed - start).count();
+        cost.render = std::chrono::duration<double, std::milli>(rendered - composed).count();
+        cost.submit = std::chrono::duration<double, std::milli>(finished - rendered).count();
+        cost.vertices = ImGui::GetDrawData()->TotalVtxCount;
+        composeTimes.push_back(cost.compose);
+        totalTimes.push_back(std::chrono::duration<double, std::milli>(finished - start).count());
+    }
 
-        ImGui::End();
+    // one line per frame, so reports of two builds can be compared line by line
+    std::ostringstream frames;
+    for (size_t f = 0; f < costs.size(); f++)
+    {
+        frames << (f == 0 ? "" : ",\n")
+               << "    {\"frame\": " << f
+               << ", \"events\": " << costs[f].events
+               << ", \"compose_ms\": " << costs[f].compose
+               << ", \"render_ms\": " << costs[f].render
+               << ", \"submit_ms\": " << costs[f].submit
+               << ", \"vertices\": " << costs[f].vertices << "}";
     }
+
+    std::ostringstream report;
+    report << "{\n"
+           << "  \"renderer\": \"" << jsonEscape(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) << "\",\n"
+           << "  \"recording\": \"" << jsonEscape(options.replayInput) << "\",\n"
+           << "  \"compose_ms\": " << timingStatisticsJSON(calculateTimingStatistics(composeTimes)) << ",\n"
+           << "  " << frameTimeStatisticsJSON(calculateTimingStatistics(totalTimes)) << ",\n"
+           << "  \"per_frame\": [\n" << frames.str() << "\n  ]\n"
+           << "}";
+    return writeBenchmarkReport(report.str(), options.benchmarkOutput);
 }
 
 int main(int argc, char *argv[])
 {
-    std::cout << "["
-              << currentTime(std::chrono::system_clock::now())
-              << "] "
-              << "Start\n- - -\n\n";
+    // before anything is allocated by Dear ImGui, so all of its memory has the tracking header
+    installImGuiAllocationTracking();
+
+    bool optionsFailed = false;
+    if (!parseOptions(argc, argv, options, optionsFailed))
+    {
+        return optionsFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // a JSON report on stdout has to be the only thing there, so it can be piped
+    bool reportToStdout = (options.headless || !options.benchmark.empty()) && options.benchmarkOutput.empty();
+    if (reportToStdout) { setLogSink(stderr); }
+    std::ostream &console = reportToStdout ? std::cerr : std::cout;
 
     // setting paths to resources
     currentPath = std::filesystem::current_path();
@@ -417,56 +1563,287 @@ int main(int argc, char *argv[])
     //std::cout << "[DEBUG] Executable name/path: " << argv[0] << std::endl
     //          << "parent path: " << basePath << std::endl << std::endl;
     fontName = (basePath / fontName).string();
+    // caches stay next to the executable, wherever it is started from
+    if (!options.shaderCache.empty()) { options.shaderCache = (basePath / options.shaderCache).string(); }
+    if (!options.fontCache.empty()) { options.fontCache = (basePath / options.fontCache).string(); }
 
-    if (!initializeGLFW())
+    // standalone benchmarks don't need a window or GL
+    if (options.benchmark == "logger")
     {
-        std::cerr << "[ERROR] GLFW initialization failed" << std::endl;
+        return runLoggerBenchmark(options.benchmarkOutput) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (options.benchmark == "font-atlas")
+    {
+        return runFontAtlasBenchmark(fontName, options.benchmarkOutput) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (options.benchmark == "time-series")
+    {
+        return runTimeSeriesBenchmark(options.benchmarkOutput) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (options.benchmark == "mesh-loading")
+    {
+        return runMeshLoadingBenchmark(options.mesh, options.benchmarkOutput) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (!options.benchmark.empty())
+    {
+        std::cerr << "[ERROR] Unknown benchmark: " << options.benchmark << std::endl;
         return EXIT_FAILURE;
     }
 
-    if (!initializeGLAD())
+    console << "["
+            << currentTime(std::chrono::system_clock::now())
+            << "] "
+            << "Start\n- - -\n\n";
+
+
+    // GLFW has to be initialized first, as on Windows it provides the scale factor for the font
+    if (!options.headless && !startup.run("GLFW", initializeGLFW))
     {
-        std::cerr << "[ERROR] glad initialization failed" << std::endl;
+        std::cerr << "[ERROR] GLFW initialization failed" << std::endl;
         return EXIT_FAILURE;
     }
 
-    if (!initializeDearImGui())
+    // fonts and style are built with the DPI scale of the recorded session
+    if (options.headless && options.replayDrawData.empty() && !options.replayInput.empty())
+    {
+        if (!inputReplay.open(options.replayInput)) { return EXIT_FAILURE; }
+        highDPIscaleFactor = inputReplay.dpiScale();
+    }
+
+    // CPU-only work goes to workers, while the main thread creates the context,
+    // they write into locals of main(), so every failure below joins them first
+    controls.instances = std::min(options.stressInstances, stressInstancesMax);
+    std::vector<InstanceData> sceneInstances;
+    startup.runAsync("font atlas", bakeFontAtlas);
+    startup.runAsync("shader sources", loadSceneShaderSources);
+    // it has its own thread, and it's uploaded over the first frames
+    if (!options.mesh.empty())
+    {
+        meshUploadBudget = static_cast<size_t>(options.meshUploadBudget) * 1024 * 1024;
+        meshLoader.load(options.mesh, options.meshThreads, options.saveMesh);
+    }
+    startup.runAsync(
+        "scene instances",
+        [&sceneInstances]()
+        {
+            sceneInstances = generateSceneInstances(controls.instances);
+            return true;
+        }
+    );
+
+    if (options.headless)
+    {
+        if (!startup.run("headless context", initializeHeadless))
+        {
+            std::cerr << "[ERROR] Headless initialization failed" << std::endl;
+            startup.joinWorkers();
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        if (!startup.run("window and context", createWindow))
+        {
+            std::cerr << "[ERROR] GLFW initialization failed" << std::endl;
+            startup.joinWorkers();
+            return EXIT_FAILURE;
+        }
+
+        if (!startup.run("GLAD", []() { return initializeGLAD((GLADloadproc)glfwGetProcAddress); }))
+        {
+            std::cerr << "[ERROR] glad initialization failed" << std::endl;
+            startup.joinWorkers();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // GL uploads join the workers on the main thread
+    if (!startup.wait("font atlas"))
+    {
+        std::cerr << "[ERROR] Couldn't load the font" << std::endl;
+        startup.joinWorkers();
+        return EXIT_FAILURE;
+    }
+    if (!startup.run("Dear ImGui", initializeDearImGui))
     {
         std::cerr << "[ERROR] Dear ImGui initialization failed" << std::endl;
+        startup.joinWorkers();
         return EXIT_FAILURE;
     }
 
     // build and compile our shader program
-    buildShaderProgram();
+    startup.wait("shader sources");
+    startup.run("shaders and meshes", []() { buildShaderProgram(); return true; });
+    // headless benchmark compares it with the stock one
+    if (options.imguiRenderer == "persistent" || options.headless)
+    {
+        startup.run("Dear ImGui renderer", []() { return imguiRenderer.initialize(&shaderCache); });
+        useImGuiRenderer = imguiRenderer.initialized() && options.imguiRenderer == "persistent";
+        if (!imguiRenderer.initialized()) { logWarning("Falling back to the stock Dear ImGui renderer"); }
+    }
+    startup.run("texture streaming", initializeTextureStreaming);
+    startup.run("retained layers", []() { return retainedLayers.initialize(&shaderCache); });
+    startup.run("scene render target", initializeDynamicResolution);
+    startup.run("particles", initializeParticles);
+    controls.retainWindows = retainedLayers.initialized() && options.retainedLayers;
+    retainedLayers.enabled = controls.retainWindows;
+    startup.wait("scene instances");
+    startup.run("scene", [&sceneInstances]() { populateScene(sceneInstances); return true; });
+    controls.animate = options.animate;
+    batchRenderer.setStreamInstances(controls.animate);
+    sceneAnimated = std::chrono::steady_clock::now();
+
+    profiler.initialize();
+    // telemetry needs the phase timings, but benchmarks measure frames
+    // without the profiler's queries unless it's asked for
+    profiler.enabled = options.profile || (options.telemetry && !options.headless);
+    if (options.telemetry)
+    {
+        std::string name = options.telemetryName.empty() ? telemetryDefaultName : options.telemetryName;
+        const char *phaseNames[framePhasesCount];
+        for (int p = 0; p < framePhasesCount; p++) { phaseNames[p] = framePhaseName(static_cast<FramePhase>(p)); }
+        if (telemetry.open(name, telemetryDefaultCapacity, phaseNames, framePhasesCount))
+        {
+            logInfo("Telemetry is published to %s", name.c_str());
+        }
+        else { logWarning("Couldn't create the telemetry segment %s", name.c_str()); }
+        telemetryFrameEnded = std::chrono::steady_clock::now();
+    }
+
+    if (!options.recordDrawData.empty()) { drawDataRecorder.open(options.recordDrawData); }
+
+    if (options.headless)
+    {
+        bool benchmarkSucceeded = false;
+        if (!options.replayDrawData.empty()) { benchmarkSucceeded = runDrawDataReplay(); }
+        else if (!options.replayInput.empty()) { benchmarkSucceeded = runInputReplay(); }
+        else { benchmarkSucceeded = runHeadlessBenchmark(); }
+        teardown();
+        return benchmarkSucceeded ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    powerSaving.enabled = options.powerSaving;
+
+    if (!sceneShaderFiles.empty())
+    {
+        shaderWatcher.start(glfWindow, sceneShaderFiles, "scene", &shaderCache);
+    }
+
+    // from now on logging from the UI thread doesn't block it
+    startLogger();
+
+    if (!options.recordInput.empty() && inputRecorder.open(options.recordInput))
+    {
+        // replay starts with the same window size
+        int currentWindowWidth = 0, currentWindowHeight = 0, framebufferWidth = 0, framebufferHeight = 0;
+        glfwGetWindowSize(glfWindow, &currentWindowWidth, &currentWindowHeight);
+        glfwGetFramebufferSize(glfWindow, &framebufferWidth, &framebufferHeight);
+        inputRecorder.resize(currentWindowWidth, currentWindowHeight, framebufferWidth, framebufferHeight, highDPIscaleFactor);
+    }
+
+    if (options.pipelined)
+    {
+        startPipeline(
+            []() { glfwMakeContextCurrent(glfWindow); },
+            []() { glfwMakeContextCurrent(NULL); },
+            []()
+            {
+                glfwSwapBuffers(glfWindow);
+                inputLatency.frameSwapped();
+                frameSwapped();
+            }
+        );
+    }
 
     // rendering loop
     while (!glfwWindowShouldClose(glfWindow))
     {
-        // the frame starts with a clean scene
-        glClearColor(backgroundR, backgroundG, backgroundB, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        profiler.beginFrame();
 
-        // draw our triangle
-        glUseProgram(shaderProgram);
-        // seeing as we only have a single VAO there's no need to bind it every time,
-        // but we'll do so to keep things a bit more organized
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        //glBindVertexArray(0); // no need to unbind it every time
+        // recompiled in the background, so it's ready to use right away
+        GLuint reloadedProgram = shaderWatcher.takeReloadedProgram();
+        if (reloadedProgram != 0)
+        {
+            runOnRenderThread(
+                [reloadedProgram]()
+                {
+                    glDeleteProgram(shaderProgram);
+                    shaderProgram = reloadedProgram;
+                }
+            );
+            powerSaving.forceRender = true;
+            logInfo("Scene shaders reloaded");
+        }
 
-        // Dear ImGui frame
-        composeDearImGuiFrame();
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        buildFrame();
 
-        glfwSwapBuffers(glfWindow);
+        // in power saving mode the frame is only submitted and swapped
+        // if it is different from the previous one
+        // animated scene changes every frame, whatever the UI does,
+        // and commands for the render thread only go with a frame
+        if (controls.animate || framePipeline.hasPendingCommands()) { powerSaving.forceRender = true; }
+        bool rendered = frameNeedsRendering(powerSaving, ImGui::GetDrawData());
+        if (rendered)
+        {
+            inputLatency.frameSubmitted();
+            if (framePipeline.running())
+            {
+                // the UI goes on with the next frame while this one is being rendered
+                framePipeline.submit(ImGui::GetDrawData());
+            }
+            else
+            {
+                submitFrame(ImGui::GetDrawData());
+                ProfilerScope phase(profiler, FramePhase::Swap);
+                framePacer.swapStarted();
+                glfwSwapBuffers(glfWindow);
+                framePacer.frameSwapped();
+                inputLatency.frameSwapped();
+                frameSwapped();
+            }
+        }
+        profiler.endFrame();
+        publishTelemetry(rendered);
+
+        // frame limiter and late input sampling wait here, with power saving too
+        framePacer.waitForFrameStart();
+        // without power saving it is continuous rendering, even if window
+        // is not visible or minimized; with power saving the thread sleeps
+        // until there are some events or until the clock needs to tick
+        if (powerSaving.enabled)
+        {
+            waitForEvents(powerSaving, controls.showMilliseconds);
+            framePacer.eventsReceived();
+        }
+        else { glfwPollEvents(); }
+    }
+
+    if (framePipeline.running())
+    {
+        stopPipeline([]() { glfwMakeContextCurrent(glfWindow); });
+    }
+
+    TimingStatistics latency = inputLatency.statistics();
+    if (latency.count > 0)
+    {
+        logInfo(
+            "Input-to-swap latency over the last %zu events: median %.2f ms, p99 %.2f ms, max %.2f ms",
+            latency.count,
+            latency.median,
+            latency.p99,
+            latency.max
+        );
+    }
 
-        // continuous rendering, even if window is not visible or minimized
-        glfwPollEvents();
-        // or you can sleep the thread until there are some events
-        // in case of running animations (glTF, for example), also call glfwPostEmptyEvent() in render()
-        //glfwWaitEvents();
+    if (powerSaving.enabled || powerSaving.skippedFrames > 0)
+    {
+        logInfo(
+            "Frames rendered: %llu, skipped: %llu",
+            static_cast<unsigned long long>(powerSaving.renderedFrames),
+            static_cast<unsigned long long>(powerSaving.skippedFrames)
+        );
     }
+    stopLogger();
 
     teardown();
 
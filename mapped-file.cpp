@@ -0,0 +1,97 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mapped-file.h"
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(std::filesystem::path const &path)
+{
+    close();
+
+    HANDLE file = CreateFileW(
+        path.wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the mapping keeps the file open on its own
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) { return false; }
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    mappingHandle = mapping;
+    mappedData = view;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mappedData != NULL) { UnmapViewOfFile(mappedData); }
+    if (mappingHandle != NULL) { CloseHandle(mappingHandle); }
+    mappedData = NULL;
+    mappingHandle = NULL;
+    mappedSize = 0;
+}
+#else
+bool MappedFile::open(std::filesystem::path const &path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) { return false; }
+
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void *view = mmap(NULL, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) { return false; }
+
+    mappedData = view;
+    mappedSize = static_cast<size_t>(fileStatus.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mappedData != NULL) { munmap(mappedData, mappedSize); }
+    mappedData = NULL;
+    mappedSize = 0;
+}
+#endif
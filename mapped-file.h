@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file (mmap or MapViewOfFile),
+// pages are loaded by the OS on access and shared with its file cache
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    bool open(std::filesystem::path const &path);
+    void close();
+
+    bool isOpen() const { return mappedData != NULL; }
+    const unsigned char *data() const { return static_cast<const unsigned char *>(mappedData); }
+    size_t size() const { return mappedSize; }
+
+private:
+    void *mappedData = NULL;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void *mappingHandle = NULL;
+#endif
+};
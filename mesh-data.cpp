@@ -0,0 +1,659 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <functional>
+#include <thread>
+#include <chrono>
+
+#include "mesh-data.h"
+#include "functions.h"
+#include "logger.h"
+
+namespace
+{
+    const char meshMagic[4] = { 'M', 'E', 'S', 'H' };
+    const uint32_t meshVersion = 1;
+
+    struct MeshHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t fileSize;
+        uint64_t verticesCount;
+        uint64_t indicesCount;
+        uint64_t positionsOffset;
+        uint64_t indicesOffset;
+    };
+
+    size_t alignedSize(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // chunks smaller than that aren't worth a thread
+    const size_t minimumChunkSize = 64 * 1024;
+    // face indices of a chunk that refer to its own vertices relatively (negative
+    // OBJ indices) are stored with this added, the chunk's first vertex isn't known yet
+    const int64_t relativeBias = static_cast<int64_t>(1) << 40;
+
+    struct ObjChunk
+    {
+        const char *begin = NULL;
+        const char *end = NULL;
+        std::vector<float> positions;
+        std::vector<int64_t> indices;
+        bool failed = false;
+    };
+
+    bool isSpace(char character)
+    {
+        return character == ' ' || character == '\t' || character == '\r';
+    }
+
+    const char *skipSpaces(const char *p, const char *end)
+    {
+        while (p < end && isSpace(*p)) { p++; }
+        return p;
+    }
+
+    // locale independent and a lot faster than strtof, exact enough for positions
+    const char *parseFloat(const char *p, const char *end, float &value)
+    {
+        static const double powers[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool digits = false;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            mantissa = mantissa * 10.0 + (*p - '0');
+            digits = true;
+            p++;
+        }
+        if (p < end && *p == '.')
+        {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                mantissa = mantissa * 10.0 + (*p - '0');
+                exponent--;
+                digits = true;
+                p++;
+            }
+        }
+        if (!digits) { return NULL; }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negativeExponent = *p == '-';
+                p++;
+            }
+            int written = 0;
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                written = std::min(written * 10 + (*p - '0'), 1000);
+                p++;
+            }
+            exponent += negativeExponent ? -written : written;
+        }
+
+        double result = mantissa;
+        if (exponent < 0)
+        {
+            result = -exponent <= 22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+        }
+        else if (exponent > 0)
+        {
+            result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+        }
+        value = static_cast<float>(negative ? -result : result);
+        return p;
+    }
+
+    const char *parseInt(const char *p, const char *end, int64_t &value)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+        const char *start = p;
+        int64_t result = 0;
+        while (p < end && *p >= '0' && *p <= '9' && result < relativeBias)
+        {
+            result = result * 10 + (*p - '0');
+            p++;
+        }
+        if (p == start) { return NULL; }
+        value = negative ? -result : result;
+        return p;
+    }
+
+    void parseChunk(ObjChunk &chunk)
+    {
+        // polygon being triangulated, reused between the faces
+        std::vector<int64_t> polygon;
+        const char *end = chunk.end;
+        for (const char *line = chunk.begin; line < end && !chunk.failed; )
+        {
+            const char *lineEnd = static_cast<const char *>(std::memchr(line, '\n', end - line));
+            if (lineEnd == NULL) { lineEnd = end; }
+            const char *p = skipSpaces(line, lineEnd);
+
+            if (lineEnd - p > 1 && p[0] == 'v' && isSpace(p[1]))
+            {
+                // the optional w and vertex colors are ignored
+                float position[3];
+                p += 2;
+                for (int i = 0; i < 3 && p != NULL; i++)
+                {
+                    p = parseFloat(skipSpaces(p, lineEnd), lineEnd, position[i]);
+                }
+                if (p == NULL) { chunk.failed = true; }
+                else { chunk.positions.insert(chunk.positions.end(), position, position + 3); }
+            }
+            else if (lineEnd - p > 1 && p[0] == 'f' && isSpace(p[1]))
+            {
+                int64_t localVertices = static_cast<int64_t>(chunk.positions.size() / 3);
+                polygon.clear();
+                p = skipSpaces(p + 2, lineEnd);
+                while (p < lineEnd)
+                {
+                    int64_t index = 0;
+                    p = parseInt(p, lineEnd, index);
+                    if (p == NULL || index == 0)
+                    {
+                        chunk.failed = true;
+                        break;
+                    }
+                    polygon.push_back(index > 0 ? index - 1 : localVertices + index + relativeBias);
+                    // texture coordinates and normals
+                    while (p < lineEnd && !isSpace(*p)) { p++; }
+                    p = skipSpaces(p, lineEnd);
+                }
+                for (size_t i = 2; i < polygon.size(); i++)
+                {
+                    chunk.indices.push_back(polygon[0]);
+                    chunk.indices.push_back(polygon[i - 1]);
+                    chunk.indices.push_back(polygon[i]);
+                }
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    // writes the chunk at its place in the mesh, false if it refers to vertices that don't exist
+    bool mergeChunk(ObjChunk const &chunk, size_t baseVertex, size_t firstIndex, MeshData &mesh)
+    {
+        std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + baseVertex * 3);
+
+        int64_t verticesCount = static_cast<int64_t>(mesh.verticesCount());
+        uint32_t *destination = mesh.indices.data() + firstIndex;
+        for (int64_t index : chunk.indices)
+        {
+            int64_t resolved = index >= relativeBias / 2 ? static_cast<int64_t>(baseVertex) + index - relativeBias : index;
+            if (resolved < 0 || resolved >= verticesCount) { return false; }
+            *destination++ = static_cast<uint32_t>(resolved);
+        }
+        return true;
+    }
+
+    void runInParallel(size_t count, std::function<void(size_t)> const &task)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; i++) { threads.emplace_back(task, i); }
+        task(0);
+        for (std::thread &thread : threads) { thread.join(); }
+    }
+
+    // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    namespace forsyth
+    {
+        const int cacheSize = 32;
+        const uint32_t maximumValence = 32;
+        const float cacheDecayPower = 1.5f,
+                    lastTriangleScore = 0.75f,
+                    valenceBoostScale = 2.0f,
+                    valenceBoostPower = 0.5f;
+
+        struct ScoreTable
+        {
+            // cache position + 1 (0 is not in the cache) and remaining triangles
+            float scores[cacheSize + 1][maximumValence + 1];
+
+            ScoreTable()
+            {
+                for (int position = -1; position < cacheSize; position++)
+                {
+                    for (uint32_t valence = 0; valence <= maximumValence; valence++)
+                    {
+                        scores[position + 1][valence] = calculate(position, valence);
+                    }
+                }
+            }
+
+            static float calculate(int cachePosition, uint32_t remainingTriangles)
+            {
+                if (remainingTriangles == 0) { return -1.0f; }
+                float score = 0.0f;
+                if (cachePosition >= 0)
+                {
+                    // the last triangle's vertices are used in any order
+                    if (cachePosition < 3) { score = lastTriangleScore; }
+                    else
+                    {
+                        float scale = 1.0f / (cacheSize - 3);
+                        score = std::pow(1.0f - (cachePosition - 3) * scale, cacheDecayPower);
+                    }
+                }
+                // vertices with few triangles left are better finished off
+                score += valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+                return score;
+            }
+
+            float score(int cachePosition, uint32_t remainingTriangles) const
+            {
+                return scores[cachePosition + 1][std::min(remainingTriangles, maximumValence)];
+            }
+        };
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t verticesCount)
+    {
+        static const forsyth::ScoreTable table;
+        const uint32_t none = std::numeric_limits<uint32_t>::max();
+        size_t trianglesCount = indices.size() / 3;
+        if (trianglesCount == 0) { return; }
+
+        // triangles of every vertex, the remaining ones are at the front of its list
+        std::vector<uint32_t> remaining(verticesCount, 0),
+                              firstTriangle(verticesCount + 1, 0);
+        for (uint32_t index : indices) { remaining[index]++; }
+        for (size_t vertex = 0; vertex < verticesCount; vertex++)
+        {
+            firstTriangle[vertex + 1] = firstTriangle[vertex] + remaining[vertex];
+        }
+        std::vector<uint32_t> vertexTriangles(indices.size());
+        {
+            std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                vertexTriangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<int> cachePosition(verticesCount, -1);
+        std::vector<float> vertexScore(verticesCount);
+        for (size_t vertex = 0; vertex < verticesCount; vertex++)
+        {
+            vertexScore[vertex] = table.score(-1, remaining[vertex]);
+        }
+        std::vector<float> triangleScore(trianglesCount);
+        std::vector<bool> emitted(trianglesCount, false);
+        for (size_t triangle = 0; triangle < trianglesCount; triangle++)
+        {
+            triangleScore[triangle] = vertexScore[indices[triangle * 3]]
+                + vertexScore[indices[triangle * 3 + 1]]
+                + vertexScore[indices[triangle * 3 + 2]];
+        }
+
+        std::vector<uint32_t> cache, newCache;
+        cache.reserve(forsyth::cacheSize + 3);
+        newCache.reserve(forsyth::cacheSize + 3);
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        uint32_t best = 0;
+        // when nothing in the cache has triangles left, it continues from here
+        size_t cursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < trianglesCount; emittedCount++)
+        {
+            if (best == none)
+            {
+                while (emitted[cursor]) { cursor++; }
+                best = static_cast<uint32_t>(cursor);
+            }
+
+            emitted[best] = true;
+            const uint32_t *triangle = &indices[best * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+
+            newCache.clear();
+            for (int i = 0; i < 3; i++)
+            {
+                uint32_t vertex = triangle[i];
+                // the emitted triangle moves to the end of the vertex's remaining ones
+                uint32_t *list = &vertexTriangles[firstTriangle[vertex]];
+                uint32_t *found = std::find(list, list + remaining[vertex], best);
+                std::swap(*found, list[remaining[vertex] - 1]);
+                remaining[vertex]--;
+                newCache.push_back(vertex);
+            }
+            for (uint32_t vertex : cache)
+            {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) { newCache.push_back(vertex); }
+            }
+            cache.swap(newCache);
+
+            // scores change with cache positions, and triangles get the difference
+            best = none;
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < cache.size(); i++)
+            {
+                uint32_t vertex = cache[i];
+                int position = i < static_cast<size_t>(forsyth::cacheSize) ? static_cast<int>(i) : -1;
+                cachePosition[vertex] = position;
+                float score = table.score(position, remaining[vertex]);
+                float difference = score - vertexScore[vertex];
+                vertexScore[vertex] = score;
+
+                const uint32_t *list = &vertexTriangles[firstTriangle[vertex]];
+                for (uint32_t j = 0; j < remaining[vertex]; j++)
+                {
+                    uint32_t adjacent = list[j];
+                    triangleScore[adjacent] += difference;
+                    if (triangleScore[adjacent] > bestScore)
+                    {
+                        bestScore = triangleScore[adjacent];
+                        best = adjacent;
+                    }
+                }
+            }
+            if (cache.size() > static_cast<size_t>(forsyth::cacheSize)) { cache.resize(forsyth::cacheSize); }
+        }
+        indices.swap(result);
+    }
+
+    // vertices in the order of the first use, so fetching them goes through memory sequentially
+    void optimizeVertexFetch(MeshData &mesh)
+    {
+        const uint32_t none = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(mesh.verticesCount(), none);
+        std::vector<float> positions;
+        positions.reserve(mesh.positions.size());
+        uint32_t next = 0;
+        for (uint32_t &index : mesh.indices)
+        {
+            if (remap[index] == none)
+            {
+                remap[index] = next++;
+                positions.insert(positions.end(), &mesh.positions[index * 3], &mesh.positions[index * 3] + 3);
+            }
+            index = remap[index];
+        }
+        mesh.positions.swap(positions);
+    }
+}
+
+bool importObj(std::filesystem::path const &path, MeshData &mesh, int threads, MeshImportStatistics *statistics)
+{
+    mesh = MeshData();
+    MappedFile file;
+    if (!file.open(path)) { return false; }
+
+    auto started = std::chrono::steady_clock::now();
+    const char *data = reinterpret_cast<const char *>(file.data());
+    size_t size = file.size();
+    size_t chunksCount = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    chunksCount = std::max<size_t>(1, std::min(chunksCount, size / minimumChunkSize));
+
+    // every chunk starts at the beginning of a line
+    std::vector<ObjChunk> chunks(chunksCount);
+    for (size_t i = 0; i < chunksCount; i++)
+    {
+        const char *begin = i == 0 ? data : chunks[i - 1].end;
+        const char *end = data + size;
+        if (i + 1 < chunksCount)
+        {
+            end = std::max(begin, data + size / chunksCount * (i + 1));
+            const char *newline = static_cast<const char *>(std::memchr(end, '\n', data + size - end));
+            end = newline != NULL ? newline + 1 : data + size;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+    }
+    runInParallel(chunksCount, [&chunks](size_t i) { parseChunk(chunks[i]); });
+    double parseMilliseconds = millisecondsSince(started);
+
+    auto mergeStarted = std::chrono::steady_clock::now();
+    std::vector<size_t> baseVertices(chunksCount + 1, 0),
+                        firstIndices(chunksCount + 1, 0);
+    for (size_t i = 0; i < chunksCount; i++)
+    {
+        if (chunks[i].failed)
+        {
+            logError("Mesh %s has an invalid vertex or face", path.string().c_str());
+            return false;
+        }
+        baseVertices[i + 1] = baseVertices[i] + chunks[i].positions.size() / 3;
+        firstIndices[i + 1] = firstIndices[i] + chunks[i].indices.size();
+    }
+    if (baseVertices[chunksCount] >= std::numeric_limits<uint32_t>::max())
+    {
+        logError("Mesh %s has too many vertices", path.string().c_str());
+        return false;
+    }
+    mesh.positions.resize(baseVertices[chunksCount] * 3);
+    mesh.indices.resize(firstIndices[chunksCount]);
+    std::vector<char> merged(chunksCount, 0);
+    runInParallel(
+        chunksCount,
+        [&](size_t i)
+        {
+            merged[i] = mergeChunk(chunks[i], baseVertices[i], firstIndices[i], mesh);
+            // the chunk isn't needed anymore
+            chunks[i] = ObjChunk();
+        }
+    );
+    if (std::find(merged.begin(), merged.end(), 0) != merged.end())
+    {
+        logError("Mesh %s has faces with invalid vertex indices", path.string().c_str());
+        mesh = MeshData();
+        return false;
+    }
+
+    if (statistics != NULL)
+    {
+        statistics->fileBytes = size;
+        statistics->threads = static_cast<int>(chunksCount);
+        statistics->parseMilliseconds = parseMilliseconds;
+        statistics->mergeMilliseconds = millisecondsSince(mergeStarted);
+        statistics->sourceVertices = mesh.verticesCount();
+        statistics->vertices = mesh.verticesCount();
+        statistics->triangles = mesh.indices.size() / 3;
+    }
+    return true;
+}
+
+size_t deduplicateVertices(MeshData &mesh)
+{
+    const uint32_t empty = std::numeric_limits<uint32_t>::max();
+    size_t count = mesh.verticesCount();
+    size_t tableSize = 1;
+    while (tableSize < count * 2) { tableSize *= 2; }
+
+    // open addressing, unique positions are moved to the front as they are found
+    std::vector<uint32_t> table(tableSize, empty),
+                          remap(count);
+    float *positions = mesh.positions.data();
+    uint32_t unique = 0;
+    for (size_t vertex = 0; vertex < count; vertex++)
+    {
+        const float *position = positions + vertex * 3;
+        size_t slot = hashBytes(position, 3 * sizeof(float)) & (tableSize - 1);
+        while (true)
+        {
+            uint32_t existing = table[slot];
+            if (existing == empty)
+            {
+                std::memmove(positions + unique * 3, position, 3 * sizeof(float));
+                table[slot] = unique;
+                remap[vertex] = unique++;
+                break;
+            }
+            if (std::memcmp(positions + existing * 3, position, 3 * sizeof(float)) == 0)
+            {
+                remap[vertex] = existing;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+    mesh.positions.resize(static_cast<size_t>(unique) * 3);
+    for (uint32_t &index : mesh.indices) { index = remap[index]; }
+    return count - unique;
+}
+
+void optimizeMesh(MeshData &mesh)
+{
+    optimizeVertexCache(mesh.indices, mesh.verticesCount());
+    optimizeVertexFetch(mesh);
+}
+
+double averageCacheMissRatio(std::vector<uint32_t> const &indices, size_t verticesCount, size_t cacheSize)
+{
+    if (indices.size() < 3) { return 0.0; }
+
+    // FIFO: a vertex is in the cache if less than cacheSize misses happened since its own
+    std::vector<size_t> insertedAt(verticesCount, 0);
+    size_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        size_t time = misses + cacheSize + 1;
+        if (time - insertedAt[index] > cacheSize)
+        {
+            insertedAt[index] = time;
+            misses++;
+        }
+    }
+    return static_cast<double>(misses) / (indices.size() / 3);
+}
+
+void normalizeMesh(MeshData &mesh)
+{
+    if (mesh.positions.empty()) { return; }
+
+    float minimum[3], maximum[3];
+    for (int axis = 0; axis < 3; axis++) { minimum[axis] = maximum[axis] = mesh.positions[axis]; }
+    for (size_t i = 0; i < mesh.positions.size(); i += 3)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            minimum[axis] = std::min(minimum[axis], mesh.positions[i + axis]);
+            maximum[axis] = std::max(maximum[axis], mesh.positions[i + axis]);
+        }
+    }
+    float extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] });
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    for (size_t i = 0; i < mesh.positions.size(); i += 3)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float center = (minimum[axis] + maximum[axis]) * 0.5f;
+            mesh.positions[i + axis] = (mesh.positions[i + axis] - center) * scale;
+        }
+    }
+}
+
+bool saveMeshFile(std::filesystem::path const &path, MeshData const &mesh)
+{
+    size_t positionsSize = mesh.positions.size() * sizeof(float),
+           indicesSize = mesh.indices.size() * sizeof(uint32_t);
+
+    MeshHeader header;
+    std::memcpy(header.magic, meshMagic, sizeof(meshMagic));
+    header.version = meshVersion;
+    header.verticesCount = mesh.verticesCount();
+    header.indicesCount = mesh.indices.size();
+    header.positionsOffset = alignedSize(sizeof(header), 16);
+    header.indicesOffset = alignedSize(header.positionsOffset + positionsSize, 16);
+    header.fileSize = header.indicesOffset + indicesSize;
+
+    std::string contents(static_cast<size_t>(header.fileSize), '\0');
+    std::memcpy(&contents[0], &header, sizeof(header));
+    if (positionsSize > 0) { std::memcpy(&contents[header.positionsOffset], mesh.positions.data(), positionsSize); }
+    if (indicesSize > 0) { std::memcpy(&contents[header.indicesOffset], mesh.indices.data(), indicesSize); }
+
+    // temporary file first, so it's never loaded half-written
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    std::error_code error;
+    if (!writeFile(temporaryPath, contents.data(), contents.size())) { return false; }
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+bool MeshFile::open(std::filesystem::path const &path)
+{
+    positionsData = NULL;
+    indicesData = NULL;
+    vertices = indicesTotal = 0;
+    if (!mapping.open(path)) { return false; }
+
+    MeshHeader header;
+    bool valid = mapping.size() >= sizeof(header);
+    if (valid)
+    {
+        std::memcpy(&header, mapping.data(), sizeof(header));
+        valid = std::memcmp(header.magic, meshMagic, sizeof(meshMagic)) == 0
+            && header.version == meshVersion
+            && header.fileSize == mapping.size()
+            && header.verticesCount < std::numeric_limits<uint32_t>::max()
+            && header.indicesCount % 3 == 0
+            && header.positionsOffset % alignof(float) == 0
+            && header.indicesOffset % alignof(uint32_t) == 0
+            // in this order, so that nothing can overflow
+            && header.positionsOffset <= header.fileSize
+            && header.indicesOffset <= header.fileSize
+            && header.verticesCount <= (header.fileSize - header.positionsOffset) / (3 * sizeof(float))
+            && header.indicesCount <= (header.fileSize - header.indicesOffset) / sizeof(uint32_t);
+    }
+    if (valid)
+    {
+        // an index out of range would make GPU read past the vertex buffer
+        const uint32_t *indices = reinterpret_cast<const uint32_t *>(mapping.data() + header.indicesOffset);
+        for (uint64_t i = 0; i < header.indicesCount && valid; i++) { valid = indices[i] < header.verticesCount; }
+    }
+    if (!valid)
+    {
+        mapping.close();
+        return false;
+    }
+
+    positionsData = reinterpret_cast<const float *>(mapping.data() + header.positionsOffset);
+    indicesData = reinterpret_cast<const uint32_t *>(mapping.data() + header.indicesOffset);
+    vertices = static_cast<size_t>(header.verticesCount);
+    indicesTotal = static_cast<size_t>(header.indicesCount);
+    return true;
+}
+
+void MeshFile::prefault() const
+{
+    const size_t pageSize = 4096;
+    const unsigned char *data = mapping.data();
+    unsigned char sum = 0;
+    for (size_t offset = 0; offset < mapping.size(); offset += pageSize) { sum += data[offset]; }
+    // so the reads aren't optimized out
+    volatile unsigned char sink = sum;
+    (void)sink;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+#include "mapped-file.h"
+
+// positions are 3 floats per vertex, triangles only
+struct MeshData
+{
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+
+    size_t verticesCount() const { return positions.size() / 3; }
+};
+
+struct MeshImportStatistics
+{
+    size_t fileBytes = 0;
+    int threads = 0;
+    // reading the text in parallel chunks and joining the chunks
+    double parseMilliseconds = 0.0;
+    double mergeMilliseconds = 0.0;
+    double deduplicateMilliseconds = 0.0;
+    double optimizeMilliseconds = 0.0;
+    size_t sourceVertices = 0;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    // average cache miss ratio (transformed vertices per triangle)
+    // of a 16 entries FIFO cache, before and after the optimization
+    double acmrBefore = 0.0;
+    double acmrAfter = 0.0;
+};
+
+// Wavefront OBJ, only the positions ("v") and faces ("f") are read, polygons
+// are triangulated as fans. The file is mapped and split into chunks at line
+// boundaries, which are parsed on their own threads (0 is all the cores);
+// faces may refer to vertices of earlier chunks, including with negative
+// indices, so those are resolved once the vertices of every chunk are counted
+bool importObj(std::filesystem::path const &path, MeshData &mesh, int threads, MeshImportStatistics *statistics = NULL);
+
+// merges vertices with exactly the same position, returns how many were removed
+size_t deduplicateVertices(MeshData &mesh);
+// reorders triangles for the post-transform vertex cache (Tom Forsyth's
+// linear-speed algorithm) and then vertices in the order of the first use,
+// so fetching them goes through memory sequentially; unused vertices are dropped
+void optimizeMesh(MeshData &mesh);
+// of a FIFO cache of the given size, 3.0 is the worst and ~0.5 is the best possible
+double averageCacheMissRatio(std::vector<uint32_t> const &indices, size_t verticesCount, size_t cacheSize = 16);
+// centers the mesh and fits it into a cube of unit size, like the other meshes of the scene
+void normalizeMesh(MeshData &mesh);
+
+// binary mesh file: a header, positions and indices, aligned, so they are
+// used right from the mapping without being parsed or copied
+bool saveMeshFile(std::filesystem::path const &path, MeshData const &mesh);
+
+class MeshFile
+{
+public:
+    bool open(std::filesystem::path const &path);
+    void close() { mapping.close(); }
+    bool isOpen() const { return mapping.isOpen(); }
+
+    const float *positions() const { return positionsData; }
+    const uint32_t *indices() const { return indicesData; }
+    size_t verticesCount() const { return vertices; }
+    size_t indicesCount() const { return indicesTotal; }
+    size_t size() const { return mapping.size(); }
+
+    // reads one byte of every page, so the OS loads the file into memory
+    // on the calling thread and not on the one that uploads from the mapping
+    void prefault() const;
+
+private:
+    MappedFile mapping;
+    const float *positionsData = NULL;
+    const uint32_t *indicesData = NULL;
+    size_t vertices = 0,
+           indicesTotal = 0;
+};
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cctype>
+
+#include "mesh-loader.h"
+#include "logger.h"
+
+namespace
+{
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+MeshLoader::~MeshLoader()
+{
+    if (worker.joinable()) { worker.join(); }
+}
+
+void MeshLoader::load(std::filesystem::path const &meshPath, int importThreads, std::filesystem::path const &meshSavePath)
+{
+    if (worker.joinable()) { worker.join(); }
+    path = meshPath;
+    savePath = meshSavePath;
+    threads = importThreads;
+    fromBinary = false;
+    mesh = -1;
+    verticesTotal = indicesTotal = uploadedVertices = uploadedIndices = 0;
+    loadMilliseconds = 0.0;
+    started = std::chrono::steady_clock::now();
+    state = State::Loading;
+    worker = std::thread(&MeshLoader::loadInBackground, this);
+}
+
+void MeshLoader::shutdown()
+{
+    // the GL side of the mesh goes with the batch renderer
+    if (worker.joinable()) { worker.join(); }
+    imported = MeshData();
+    binary.close();
+    if (state != State::Nothing) { state = State::Nothing; }
+}
+
+void MeshLoader::fail(const char *reason)
+{
+    logError("Couldn't load mesh %s: %s", path.string().c_str(), reason);
+    imported = MeshData();
+    binary.close();
+    state = State::Failed;
+}
+
+void MeshLoader::loadInBackground()
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (extension != ".obj")
+    {
+        if (!binary.open(path))
+        {
+            fail("not a valid mesh file");
+            return;
+        }
+        binary.prefault();
+        fromBinary = true;
+        logInfo(
+            "Mesh %s mapped: %zu vertices, %zu triangles",
+            path.string().c_str(),
+            binary.verticesCount(),
+            binary.indicesCount() / 3
+        );
+        state.store(State::Loaded, std::memory_order_release);
+        return;
+    }
+
+    MeshImportStatistics &stats = importStatistics;
+    stats = MeshImportStatistics();
+    if (!importObj(path, imported, threads, &stats))
+    {
+        fail("not a valid OBJ file");
+        return;
+    }
+    if (imported.indices.empty())
+    {
+        fail("there are no faces");
+        return;
+    }
+
+    auto deduplicateStarted = std::chrono::steady_clock::now();
+    deduplicateVertices(imported);
+    stats.deduplicateMilliseconds = millisecondsSince(deduplicateStarted);
+    stats.acmrBefore = averageCacheMissRatio(imported.indices, imported.verticesCount());
+    auto optimizeStarted = std::chrono::steady_clock::now();
+    optimizeMesh(imported);
+    stats.optimizeMilliseconds = millisecondsSince(optimizeStarted);
+    stats.acmrAfter = averageCacheMissRatio(imported.indices, imported.verticesCount());
+    stats.vertices = imported.verticesCount();
+    normalizeMesh(imported);
+
+    logInfo(
+        "Mesh %s imported on %d threads: %zu MB in %.1f ms (%.1f MB/s), %zu of %zu vertices are unique, "
+        "%zu triangles, ACMR %.3f -> %.3f",
+        path.string().c_str(),
+        stats.threads,
+        stats.fileBytes / (1024 * 1024),
+        stats.parseMilliseconds + stats.mergeMilliseconds,
+        stats.fileBytes / (1024.0 * 1024.0) / ((stats.parseMilliseconds + stats.mergeMilliseconds) / 1000.0),
+        stats.vertices,
+        stats.sourceVertices,
+        stats.triangles,
+        stats.acmrBefore,
+        stats.acmrAfter
+    );
+    if (!savePath.empty())
+    {
+        if (saveMeshFile(savePath, imported)) { logInfo("Mesh saved to %s", savePath.string().c_str()); }
+        else { logWarning("Couldn't save mesh to %s", savePath.string().c_str()); }
+    }
+    state.store(State::Loaded, std::memory_order_release);
+}
+
+int MeshLoader::update(BatchRenderer &renderer, size_t budgetBytes)
+{
+    State current = state.load(std::memory_order_acquire);
+    if (current == State::Loaded)
+    {
+        worker.join();
+        verticesTotal = fromBinary ? binary.verticesCount() : imported.verticesCount();
+        indicesTotal = fromBinary ? binary.indicesCount() : imported.indices.size();
+        mesh = renderer.reserveMesh(verticesTotal, indicesTotal);
+        if (mesh < 0)
+        {
+            fail("the mesh is empty");
+            return -1;
+        }
+        state = current = State::Uploading;
+    }
+    if (current != State::Uploading) { return -1; }
+
+    const float *positions = fromBinary ? binary.positions() : imported.positions.data();
+    const uint32_t *indices = fromBinary ? binary.indices() : imported.indices.data();
+    // every frame makes some progress, even with a tiny budget
+    size_t budget = std::max<size_t>(budgetBytes, 3 * sizeof(uint32_t));
+
+    const size_t vertexSize = 3 * sizeof(float);
+    if (uploadedVertices < verticesTotal)
+    {
+        size_t count = std::min(verticesTotal - uploadedVertices, std::max<size_t>(1, budget / vertexSize));
+        renderer.uploadMeshVertices(mesh, uploadedVertices, positions + uploadedVertices * 3, count);
+        uploadedVertices += count;
+        budget -= std::min(budget, count * vertexSize);
+    }
+    if (uploadedVertices == verticesTotal && uploadedIndices < indicesTotal && budget >= 3 * sizeof(uint32_t))
+    {
+        // whole triangles, not that it matters until the mesh is completed
+        size_t count = std::min(indicesTotal - uploadedIndices, budget / (3 * sizeof(uint32_t)) * 3);
+        renderer.uploadMeshIndices(mesh, uploadedIndices, indices + uploadedIndices, count);
+        uploadedIndices += count;
+    }
+    if (uploadedVertices < verticesTotal || uploadedIndices < indicesTotal) { return -1; }
+
+    renderer.completeMesh(mesh);
+    loadMilliseconds = millisecondsSince(started);
+    logInfo("Mesh %s is uploaded, %.1f ms after loading started", path.string().c_str(), loadMilliseconds);
+    // the buffers have their own copy now
+    imported = MeshData();
+    binary.close();
+    state = State::Ready;
+    return mesh;
+}
+
+MeshLoaderStatistics MeshLoader::statistics() const
+{
+    MeshLoaderStatistics result;
+    State current = state.load(std::memory_order_acquire);
+    switch (current)
+    {
+    case State::Nothing:
+        result.state = "nothing";
+        break;
+    case State::Loading:
+        result.state = "loading";
+        break;
+    case State::Loaded:
+    case State::Uploading:
+        result.state = "uploading";
+        break;
+    case State::Ready:
+        result.state = "ready";
+        break;
+    case State::Failed:
+        result.state = "failed";
+        break;
+    }
+    // the worker is done with these only after that
+    if (current == State::Uploading || current == State::Ready)
+    {
+        result.vertices = verticesTotal;
+        result.triangles = indicesTotal / 3;
+        result.uploadedBytes = uploadedVertices * 3 * sizeof(float) + uploadedIndices * sizeof(uint32_t);
+        result.totalBytes = verticesTotal * 3 * sizeof(float) + indicesTotal * sizeof(uint32_t);
+        result.loadMilliseconds = loadMilliseconds;
+        result.fromBinary = fromBinary;
+        result.import = importStatistics;
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#include "mesh-data.h"
+#include "batch-renderer.h"
+
+struct MeshLoaderStatistics
+{
+    // nothing, loading, uploading, ready or failed
+    const char *state = "nothing";
+    size_t vertices = 0;
+    size_t triangles = 0;
+    size_t uploadedBytes = 0;
+    size_t totalBytes = 0;
+    // from the start of loading until the mesh is drawn
+    double loadMilliseconds = 0.0;
+    bool fromBinary = false;
+    MeshImportStatistics import;
+};
+
+// Loads a mesh on a background thread: a binary file is only mapped
+// (and prefaulted), an OBJ file is imported, deduplicated and optimized.
+// Then update() uploads it on the GL thread in parts of limited size,
+// so a big mesh doesn't stall any frame, straight from the mapping
+// in case of a binary file
+class MeshLoader
+{
+public:
+    ~MeshLoader();
+
+    // OBJ files are recognized by the extension, everything else is binary;
+    // the imported mesh can be saved as a binary file to load it faster next time
+    void load(std::filesystem::path const &path, int threads, std::filesystem::path const &savePath = "");
+    void shutdown();
+
+    // GL thread, every frame: uploads at most budgetBytes of the mesh,
+    // returns the mesh index once in the frame when it is completed, -1 otherwise
+    int update(BatchRenderer &renderer, size_t budgetBytes);
+
+    // GL thread as well
+    MeshLoaderStatistics statistics() const;
+
+private:
+    enum class State
+    {
+        Nothing,
+        Loading,
+        Loaded,
+        Uploading,
+        Ready,
+        Failed
+    };
+
+    std::thread worker;
+    std::atomic<State> state{State::Nothing};
+    std::filesystem::path path;
+    std::filesystem::path savePath;
+    int threads = 0;
+    std::chrono::steady_clock::time_point started;
+    double loadMilliseconds = 0.0;
+
+    // one of these is the source of the upload
+    MeshData imported;
+    MeshFile binary;
+    bool fromBinary = false;
+    MeshImportStatistics importStatistics;
+
+    int mesh = -1;
+    size_t verticesTotal = 0,
+           indicesTotal = 0,
+           uploadedVertices = 0,
+           uploadedIndices = 0;
+
+    void loadInBackground();
+    void fail(const char *reason);
+};
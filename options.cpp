@@ -0,0 +1,323 @@
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+
+#include "options.h"
+
+namespace
+{
+    bool parseInt(std::string const &value, int &result)
+    {
+        char *end = NULL;
+        long parsed = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed < 0) { return false; }
+        result = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool parseDouble(std::string const &value, double &result)
+    {
+        char *end = NULL;
+        double parsed = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || parsed < 0) { return false; }
+        result = parsed;
+        return true;
+    }
+
+    // directories given on the command line are relative to the working directory,
+    // while relative defaults are resolved against the executable directory later
+    std::string absoluteDirectory(std::string const &value)
+    {
+        if (value.empty()) { return value; }
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::absolute(value, error);
+        return error ? value : path.string();
+    }
+}
+
+bool parseOptions(int argc, char *argv[], ApplicationOptions &options, bool &failed)
+{
+    failed = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        // options that require a value
+        bool hasValue = i + 1 < argc;
+        std::string value = hasValue ? argv[i + 1] : "";
+
+        if (argument == "-h" || argument == "--help")
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        else if (argument == "--power-saving")
+        {
+            options.powerSaving = true;
+        }
+        else if (argument == "--profile")
+        {
+            options.profile = true;
+        }
+        else if (argument == "--stress-instances" && hasValue && parseInt(value, options.stressInstances))
+        {
+            i++;
+        }
+        else if (argument == "--animate")
+        {
+            options.animate = true;
+        }
+        else if (argument == "--shader-cache" && hasValue)
+        {
+            options.shaderCache = absoluteDirectory(value);
+            i++;
+        }
+        else if (argument == "--no-shader-cache")
+        {
+            options.shaderCache = "";
+        }
+        else if (argument == "--font-cache" && hasValue)
+        {
+            options.fontCache = absoluteDirectory(value);
+            i++;
+        }
+        else if (argument == "--no-font-cache")
+        {
+            options.fontCache = "";
+        }
+        else if (argument == "--shader-dir" && hasValue)
+        {
+            options.shaderDirectory = value;
+            i++;
+        }
+        else if (argument == "--swap-interval" && hasValue && parseInt(value, options.swapInterval))
+        {
+            i++;
+        }
+        else if (argument == "--fps" && hasValue && parseDouble(value, options.targetFPS))
+        {
+            i++;
+        }
+        else if (argument == "--late-input")
+        {
+            options.lateInput = true;
+        }
+        else if (argument == "--pipelined")
+        {
+            options.pipelined = true;
+        }
+        else if (
+            argument == "--pipeline-depth" && hasValue
+            && parseInt(value, options.pipelineDepth) && options.pipelineDepth > 0
+        )
+        {
+            i++;
+        }
+        else if (
+            argument == "--imgui-renderer" && hasValue
+            && (value == "stock" || value == "persistent")
+        )
+        {
+            options.imguiRenderer = value;
+            i++;
+        }
+        else if (argument == "--retained-layers")
+        {
+            options.retainedLayers = true;
+        }
+        else if (argument == "--scene-budget" && hasValue && parseDouble(value, options.sceneBudget))
+        {
+            i++;
+        }
+        else if (
+            argument == "--min-scene-scale" && hasValue
+            && parseDouble(value, options.minimumSceneScale)
+            && options.minimumSceneScale > 0.0 && options.minimumSceneScale <= 1.0
+        )
+        {
+            i++;
+        }
+        else if (
+            argument == "--max-scene-scale" && hasValue
+            && parseDouble(value, options.maximumSceneScale)
+            && options.maximumSceneScale > 0.0 && options.maximumSceneScale <= 1.0
+        )
+        {
+            i++;
+        }
+        else if (argument == "--startup-report")
+        {
+            options.startupReport = true;
+        }
+        else if (argument == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (argument == "--frames" && hasValue && parseInt(value, options.benchmarkFrames))
+        {
+            i++;
+        }
+        else if (argument == "--seconds" && hasValue && parseDouble(value, options.benchmarkSeconds))
+        {
+            i++;
+        }
+        else if (argument == "--warmup-frames" && hasValue && parseInt(value, options.benchmarkWarmupFrames))
+        {
+            i++;
+        }
+        else if (argument == "--benchmark" && hasValue)
+        {
+            options.benchmark = value;
+            i++;
+        }
+        else if (argument == "--benchmark-output" && hasValue)
+        {
+            options.benchmarkOutput = value;
+            i++;
+        }
+        else if (argument == "--record-input" && hasValue)
+        {
+            options.recordInput = value;
+            i++;
+        }
+        else if (argument == "--replay-input" && hasValue)
+        {
+            options.replayInput = value;
+            // recorded sessions are replayed offscreen
+            options.headless = true;
+            i++;
+        }
+        else if (argument == "--record-draw-data" && hasValue)
+        {
+            options.recordDrawData = value;
+            i++;
+        }
+        else if (argument == "--replay-draw-data" && hasValue)
+        {
+            options.replayDrawData = value;
+            // replay is a benchmark, there is nothing to interact with
+            options.headless = true;
+            i++;
+        }
+        else if (argument == "--image" && hasValue)
+        {
+            options.images.push_back(value);
+            i++;
+        }
+        else if (
+            argument == "--texture-budget" && hasValue
+            && parseInt(value, options.textureBudget) && options.textureBudget > 0
+        )
+        {
+            i++;
+        }
+        else if (
+            argument == "--texture-upload-budget" && hasValue
+            && parseInt(value, options.textureUploadBudget) && options.textureUploadBudget > 0
+        )
+        {
+            i++;
+        }
+        else if (argument == "--mesh" && hasValue)
+        {
+            options.mesh = value;
+            i++;
+        }
+        else if (argument == "--save-mesh" && hasValue)
+        {
+            options.saveMesh = value;
+            i++;
+        }
+        else if (argument == "--mesh-threads" && hasValue && parseInt(value, options.meshThreads))
+        {
+            i++;
+        }
+        else if (
+            argument == "--mesh-upload-budget" && hasValue
+            && parseInt(value, options.meshUploadBudget) && options.meshUploadBudget > 0
+        )
+        {
+            i++;
+        }
+        else if (argument == "--particles" && hasValue && parseInt(value, options.particles) && options.particles >= 0)
+        {
+            i++;
+        }
+        else if (argument == "--particles-backend" && hasValue && (value == "gpu" || value == "cpu"))
+        {
+            options.particlesBackend = value;
+            i++;
+        }
+        else if (argument == "--particle-threads" && hasValue && parseInt(value, options.particleThreads))
+        {
+            i++;
+        }
+        else if (argument == "--telemetry")
+        {
+            options.telemetry = true;
+        }
+        else if (argument == "--telemetry-name" && hasValue)
+        {
+            options.telemetry = true;
+            options.telemetryName = value;
+            i++;
+        }
+        else
+        {
+            std::cerr << "[ERROR] Unknown or incomplete argument: " << argument << std::endl;
+            printUsage(argv[0]);
+            failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+void printUsage(std::string const &executableName)
+{
+    std::cout << "Usage: " << executableName << " [options]\n\n"
+              << "  --power-saving            wait for events instead of redrawing continuously\n"
+              << "  --profile                 enable frame profiler (F12 saves Chrome trace of recent frames)\n"
+              << "  --stress-instances N      draw N random mesh instances and report triangles per second\n"
+              << "  --animate                 animate the scene (instances are streamed every frame)\n"
+              << "  --shader-cache DIR        where to cache linked shader programs (default: shader-cache next to the executable)\n"
+              << "  --no-shader-cache         always compile shaders from sources\n"
+              << "  --font-cache DIR          where to cache baked font atlases (default: font-cache next to the executable)\n"
+              << "  --no-font-cache           always rasterize the font on startup\n"
+              << "  --shader-dir DIR          load scene shaders from DIR and reload them when they change\n"
+              << "  --swap-interval N         swap every N-th screen refresh, 0 is uncapped (default: 1)\n"
+              << "  --fps N                   limit frame rate to N frames per second\n"
+              << "  --late-input              poll input and build the frame right before its deadline\n"
+              << "  --pipelined               build the UI and render frames on separate threads\n"
+              << "  --pipeline-depth N        pipelined: how many frames the UI can be ahead (default: 2)\n"
+              << "  --imgui-renderer NAME     Dear ImGui renderer: stock (default) or persistent\n"
+              << "  --retained-layers         render static windows into cached textures and composite those\n"
+              << "  --scene-budget MS         lower the scene resolution to keep its GPU time within MS\n"
+              << "  --min-scene-scale S       dynamic resolution: the lowest scale of the window size (default: 0.5)\n"
+              << "  --max-scene-scale S       dynamic resolution: the highest scale (default: 1.0)\n"
+              << "  --startup-report          print per-stage startup times and time to the first frame\n"
+              << "  --headless                render offscreen (no window) and benchmark the frame loop\n"
+              << "  --frames N                headless: amount of frames to measure (default: "
+              << benchmarkDefaultFrames << ")\n"
+              << "  --seconds S               headless: measure for S seconds instead\n"
+              << "  --warmup-frames N         headless: frames to skip before measuring (default: 10)\n"
+              << "  --benchmark NAME          run a standalone benchmark: logger, font-atlas,\n"
+              << "                            time-series, mesh-loading (of --mesh or a generated one)\n"
+              << "  --benchmark-output PATH   save JSON report of a benchmark to PATH instead of stdout\n"
+              << "  --record-input PATH       save input events (with frame numbers) to PATH\n"
+              << "  --replay-input PATH       replay recorded input offscreen and report CPU time of every frame\n"
+              << "  --record-draw-data PATH   save Dear ImGui draw data of every frame to PATH\n"
+              << "  --replay-draw-data PATH   render a draw data recording offscreen as fast as possible\n"
+              << "  --image PATH              show the image (PPM, BMP or TGA) in the custom window, can be repeated\n"
+              << "  --texture-budget MB       GPU memory for streamed textures (default: 256)\n"
+              << "  --texture-upload-budget MB  texture data uploaded per frame at most (default: 8)\n"
+              << "  --mesh PATH               add an OBJ or a binary mesh to the scene, loaded in the background\n"
+              << "  --save-mesh PATH          save the imported OBJ mesh as a binary one, which loads much faster\n"
+              << "  --mesh-threads N          threads parsing the OBJ mesh (default: 0, all the cores)\n"
+              << "  --mesh-upload-budget MB   mesh data uploaded per frame at most (default: 16)\n"
+              << "  --particles N             simulate and draw N particles instead of the meshes\n"
+              << "  --particles-backend NAME  particles: gpu (compute shader, default) or cpu (SSE/AVX threads)\n"
+              << "  --particle-threads N      threads simulating the particles on CPU (default: 0, all the cores)\n"
+              << "  --telemetry               publish per-frame metrics into shared memory (see glfw-imgui-telemetry)\n"
+              << "  --telemetry-name NAME     shared memory segment of the telemetry (default: /glfw-imgui-telemetry)\n"
+              << "  -h, --help                show this help\n";
+}
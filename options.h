@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// everything that can be changed from the command line
+struct ApplicationOptions
+{
+    // sleep until there are events and don't redraw unchanged frames
+    bool powerSaving = false;
+    // amount of random mesh instances to draw instead of our triangle
+    int stressInstances = 0;
+    // rotate the instances, so they are updated and streamed every frame
+    bool animate = false;
+    // CPU/GPU frame profiler enabled from the start (also always on in headless mode)
+    bool profile = false;
+    // where linked shader programs are cached, relative to the executable directory, empty disables the cache
+    std::string shaderCache = "shader-cache";
+    // where baked font atlases are cached, relative to the executable directory, empty disables the cache
+    std::string fontCache = "font-cache";
+    // load scene shaders from this directory and recompile them when the files change
+    std::string shaderDirectory = "";
+    // 1 is VSync, 0 is uncapped
+    int swapInterval = 1;
+    // frame limiter, 0 is no limit
+    double targetFPS = 0.0;
+    // poll events and build the frame as late as possible before its deadline
+    bool lateInput = false;
+    // build the UI on the main thread and render it on a separate one
+    bool pipelined = false;
+    // how many frames the UI can be ahead of the render thread
+    int pipelineDepth = 2;
+    // Dear ImGui renderer: "stock" backend or "persistent" (persistently mapped buffer, merged draws)
+    std::string imguiRenderer = "stock";
+    // draw unchanged windows from cached textures
+    bool retainedLayers = false;
+    // GPU time of the scene in milliseconds to keep by lowering its resolution, 0 disables that
+    double sceneBudget = 0.0;
+    // bounds of the scene resolution, relative to the window
+    double minimumSceneScale = 0.5;
+    double maximumSceneScale = 1.0;
+    // print how long every startup stage took once the first frame is rendered
+    bool startupReport = false;
+    // render into an offscreen framebuffer instead of a window
+    bool headless = false;
+    // headless benchmark: amount of frames (or seconds) to render,
+    // if both are zero, then benchmarkDefaultFrames is used
+    int benchmarkFrames = 0;
+    double benchmarkSeconds = 0.0;
+    // frames rendered before measurements start (shaders, font texture, etc)
+    int benchmarkWarmupFrames = 10;
+    // run one of the standalone benchmarks (logger, font-atlas, time-series, mesh-loading) instead of the application
+    std::string benchmark = "";
+    // where to save the JSON report, stdout if empty
+    std::string benchmarkOutput = "";
+    // save Dear ImGui draw data of every frame to this file
+    std::string recordDrawData = "";
+    // save GLFW input events to this file
+    std::string recordInput = "";
+    // replay recorded input with a fixed timestep and report CPU time of every frame (implies headless)
+    std::string replayInput = "";
+    // render frames from a draw data recording instead of the application's UI (implies headless)
+    std::string replayDrawData = "";
+    // shown in the custom window next to the generated images, loaded in the background
+    std::vector<std::string> images;
+    // megabytes of textures kept on GPU before the least recently used ones are evicted
+    int textureBudget = 256;
+    // megabytes of pixels uploaded per frame at most
+    int textureUploadBudget = 8;
+    // OBJ or binary mesh added to the scene, loaded in the background
+    std::string mesh = "";
+    // save the imported OBJ mesh as a binary one, which loads without parsing
+    std::string saveMesh = "";
+    // threads parsing the OBJ mesh, 0 is all the cores
+    int meshThreads = 0;
+    // megabytes of the mesh uploaded per frame at most
+    int meshUploadBudget = 16;
+    // amount of particles drawn instead of the meshes, 0 is no particles
+    int particles = 0;
+    // gpu (compute shader) or cpu
+    std::string particlesBackend = "gpu";
+    // threads simulating the particles on CPU, 0 is all the cores
+    int particleThreads = 0;
+    // publish per-frame metrics into shared memory for external monitors
+    bool telemetry = false;
+    // name of the shared memory segment, the default one if empty
+    std::string telemetryName = "";
+};
+
+const int benchmarkDefaultFrames = 600;
+
+// returns false if arguments are invalid or if the usage was requested,
+// in which case the application should just exit
+bool parseOptions(int argc, char *argv[], ApplicationOptions &options, bool &failed);
+
+void printUsage(std::string const &executableName);
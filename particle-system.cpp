@@ -0,0 +1,638 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+#include "particle-system.h"
+#include "logger.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_SSE
+#include <immintrin.h>
+// AVX code is compiled for its own functions only and used if the CPU has it,
+// so the rest of the application doesn't need any special flags
+#if defined(__GNUC__) || defined(__clang__)
+#define PARTICLES_AVX
+#define PARTICLES_AVX_TARGET __attribute__((target("avx")))
+#elif defined(_MSC_VER)
+#define PARTICLES_AVX
+#define PARTICLES_AVX_TARGET
+#include <intrin.h>
+#endif
+#endif
+
+typedef ParticleSystem::StepParameters StepParameters;
+
+namespace
+{
+    // the attraction, its softening (so particles close to the attractor don't
+    // fly away at huge speeds) and the part of the speed that is left after a second
+    const float strength = 0.08f,
+                softening = 0.02f,
+                dampingPerSecond = 0.5f;
+    // a long frame doesn't turn into a huge step
+    const float maximumDeltaTime = 1.0f / 30.0f;
+    // the particles of one work group of the compute shader
+    const GLuint workGroupSize = 256;
+    // parts of the arrays for the threads are aligned to the widest SIMD
+    const size_t simdWidth = 8;
+
+    const char *computeShaderSource = "#version 430 core\n"
+        "layout (local_size_x = 256) in;\n"
+        "layout (std430, binding = 0) buffer Particles { float values[]; };\n"
+        "uniform uint Count;\n"
+        "uniform float DeltaTime;\n"
+        "uniform vec2 Attractor;\n"
+        "uniform float Damping;\n"
+        "uniform float Strength;\n"
+        "uniform float Softening;\n"
+        "void main()\n"
+        "{\n"
+        "   uint i = gl_GlobalInvocationID.x;\n"
+        "   if (i >= Count) { return; }\n"
+        "   vec2 position = vec2(values[i], values[Count + i]);\n"
+        "   vec2 velocity = vec2(values[2u * Count + i], values[3u * Count + i]);\n"
+        "   vec2 toAttractor = Attractor - position;\n"
+        "   float distanceSquared = dot(toAttractor, toAttractor) + Softening;\n"
+        "   float force = Strength * DeltaTime / (distanceSquared * sqrt(distanceSquared));\n"
+        "   velocity = (velocity + toAttractor * force) * Damping;\n"
+        "   position += velocity * DeltaTime;\n"
+        // bounce off the edges, losing half of the speed
+        "   bvec2 outside = greaterThan(abs(position), vec2(1.0));\n"
+        "   position = mix(position, sign(position), outside);\n"
+        "   velocity = mix(velocity, velocity * -0.5, outside);\n"
+        "   values[i] = position.x;\n"
+        "   values[Count + i] = position.y;\n"
+        "   values[2u * Count + i] = velocity.x;\n"
+        "   values[3u * Count + i] = velocity.y;\n"
+        "}\n";
+
+    // X and Y come from different parts of the same buffer
+    const char *vertexShaderSource = "#version 330 core\n"
+        "layout (location = 0) in float X;\n"
+        "layout (location = 1) in float Y;\n"
+        "out vec4 color;\n"
+        "void main()\n"
+        "{\n"
+        "   gl_Position = vec4(X, Y, 0.0, 1.0);\n"
+        "   float shade = float(gl_VertexID % 64) / 64.0;\n"
+        "   color = vec4(0.3 + 0.5 * shade, 0.5, 1.0 - 0.4 * shade, 0.35);\n"
+        "}\n";
+    const char *fragmentShaderSource = "#version 330 core\n"
+        "in vec4 color;\n"
+        "out vec4 FragColor;\n"
+        "void main()\n"
+        "{\n"
+        "   FragColor = color;\n"
+        "}\n";
+
+    // the reference, every SIMD variant does exactly the same operations
+    void simulateScalar(float *x, float *y, float *vx, float *vy, size_t count, StepParameters const &parameters)
+    {
+        const float forceScale = strength * parameters.deltaTime;
+        for (size_t i = 0; i < count; i++)
+        {
+            float dx = parameters.attractor[0] - x[i],
+                  dy = parameters.attractor[1] - y[i];
+            float distanceSquared = dx * dx + dy * dy + softening;
+            float force = forceScale / (distanceSquared * std::sqrt(distanceSquared));
+            vx[i] = (vx[i] + dx * force) * parameters.damping;
+            vy[i] = (vy[i] + dy * force) * parameters.damping;
+            x[i] += vx[i] * parameters.deltaTime;
+            y[i] += vy[i] * parameters.deltaTime;
+            if (std::fabs(x[i]) > 1.0f)
+            {
+                x[i] = std::copysign(1.0f, x[i]);
+                vx[i] *= -0.5f;
+            }
+            if (std::fabs(y[i]) > 1.0f)
+            {
+                y[i] = std::copysign(1.0f, y[i]);
+                vy[i] *= -0.5f;
+            }
+        }
+    }
+
+#ifdef PARTICLES_SSE
+    // selects b where mask is set
+    inline __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    }
+
+    void simulateSSE(float *x, float *y, float *vx, float *vy, size_t count, StepParameters const &parameters)
+    {
+        const __m128 attractorX = _mm_set1_ps(parameters.attractor[0]),
+                     attractorY = _mm_set1_ps(parameters.attractor[1]),
+                     forceScale = _mm_set1_ps(strength * parameters.deltaTime),
+                     damping = _mm_set1_ps(parameters.damping),
+                     deltaTime = _mm_set1_ps(parameters.deltaTime),
+                     soften = _mm_set1_ps(softening),
+                     one = _mm_set1_ps(1.0f),
+                     bounce = _mm_set1_ps(-0.5f),
+                     signBit = _mm_set1_ps(-0.0f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 px = _mm_loadu_ps(x + i),
+                   py = _mm_loadu_ps(y + i),
+                   velocityX = _mm_loadu_ps(vx + i),
+                   velocityY = _mm_loadu_ps(vy + i);
+            __m128 dx = _mm_sub_ps(attractorX, px),
+                   dy = _mm_sub_ps(attractorY, py);
+            __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), soften);
+            __m128 force = _mm_div_ps(forceScale, _mm_mul_ps(distanceSquared, _mm_sqrt_ps(distanceSquared)));
+            velocityX = _mm_mul_ps(_mm_add_ps(velocityX, _mm_mul_ps(dx, force)), damping);
+            velocityY = _mm_mul_ps(_mm_add_ps(velocityY, _mm_mul_ps(dy, force)), damping);
+            px = _mm_add_ps(px, _mm_mul_ps(velocityX, deltaTime));
+            py = _mm_add_ps(py, _mm_mul_ps(velocityY, deltaTime));
+
+            __m128 outsideX = _mm_cmpgt_ps(_mm_andnot_ps(signBit, px), one),
+                   outsideY = _mm_cmpgt_ps(_mm_andnot_ps(signBit, py), one);
+            px = select(outsideX, px, _mm_or_ps(_mm_and_ps(px, signBit), one));
+            py = select(outsideY, py, _mm_or_ps(_mm_and_ps(py, signBit), one));
+            velocityX = select(outsideX, velocityX, _mm_mul_ps(velocityX, bounce));
+            velocityY = select(outsideY, velocityY, _mm_mul_ps(velocityY, bounce));
+
+            _mm_storeu_ps(x + i, px);
+            _mm_storeu_ps(y + i, py);
+            _mm_storeu_ps(vx + i, velocityX);
+            _mm_storeu_ps(vy + i, velocityY);
+        }
+        simulateScalar(x + i, y + i, vx + i, vy + i, count - i, parameters);
+    }
+#endif
+
+#ifdef PARTICLES_AVX
+    bool cpuSupportsAVX()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        // the CPU has it, and the OS saves its registers
+        int info[4];
+        __cpuid(info, 1);
+        bool osSupport = (info[2] & (1 << 27)) != 0,
+             avx = (info[2] & (1 << 28)) != 0;
+        return osSupport && avx && (_xgetbv(0) & 6) == 6;
+#else
+        return __builtin_cpu_supports("avx");
+#endif
+    }
+
+    PARTICLES_AVX_TARGET
+    void simulateAVX(float *x, float *y, float *vx, float *vy, size_t count, StepParameters const &parameters)
+    {
+        const __m256 attractorX = _mm256_set1_ps(parameters.attractor[0]),
+                     attractorY = _mm256_set1_ps(parameters.attractor[1]),
+                     forceScale = _mm256_set1_ps(strength * parameters.deltaTime),
+                     damping = _mm256_set1_ps(parameters.damping),
+                     deltaTime = _mm256_set1_ps(parameters.deltaTime),
+                     soften = _mm256_set1_ps(softening),
+                     one = _mm256_set1_ps(1.0f),
+                     bounce = _mm256_set1_ps(-0.5f),
+                     signBit = _mm256_set1_ps(-0.0f);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 px = _mm256_loadu_ps(x + i),
+                   py = _mm256_loadu_ps(y + i),
+                   velocityX = _mm256_loadu_ps(vx + i),
+                   velocityY = _mm256_loadu_ps(vy + i);
+            __m256 dx = _mm256_sub_ps(attractorX, px),
+                   dy = _mm256_sub_ps(attractorY, py);
+            __m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), soften);
+            __m256 force = _mm256_div_ps(forceScale, _mm256_mul_ps(distanceSquared, _mm256_sqrt_ps(distanceSquared)));
+            velocityX = _mm256_mul_ps(_mm256_add_ps(velocityX, _mm256_mul_ps(dx, force)), damping);
+            velocityY = _mm256_mul_ps(_mm256_add_ps(velocityY, _mm256_mul_ps(dy, force)), damping);
+            px = _mm256_add_ps(px, _mm256_mul_ps(velocityX, deltaTime));
+            py = _mm256_add_ps(py, _mm256_mul_ps(velocityY, deltaTime));
+
+            __m256 outsideX = _mm256_cmp_ps(_mm256_andnot_ps(signBit, px), one, _CMP_GT_OQ),
+                   outsideY = _mm256_cmp_ps(_mm256_andnot_ps(signBit, py), one, _CMP_GT_OQ);
+            px = _mm256_blendv_ps(px, _mm256_or_ps(_mm256_and_ps(px, signBit), one), outsideX);
+            py = _mm256_blendv_ps(py, _mm256_or_ps(_mm256_and_ps(py, signBit), one), outsideY);
+            velocityX = _mm256_blendv_ps(velocityX, _mm256_mul_ps(velocityX, bounce), outsideX);
+            velocityY = _mm256_blendv_ps(velocityY, _mm256_mul_ps(velocityY, bounce), outsideY);
+
+            _mm256_storeu_ps(x + i, px);
+            _mm256_storeu_ps(y + i, py);
+            _mm256_storeu_ps(vx + i, velocityX);
+            _mm256_storeu_ps(vy + i, velocityY);
+        }
+        simulateSSE(x + i, y + i, vx + i, vy + i, count - i, parameters);
+    }
+
+    const bool useAVX = cpuSupportsAVX();
+#endif
+
+    // the widest one this CPU supports, the others (ARM) rely on auto-vectorization
+    void simulateSIMD(float *x, float *y, float *vx, float *vy, size_t count, StepParameters const &parameters)
+    {
+#if defined(PARTICLES_AVX)
+        if (useAVX)
+        {
+            simulateAVX(x, y, vx, vy, count, parameters);
+            return;
+        }
+#endif
+#if defined(PARTICLES_SSE)
+        simulateSSE(x, y, vx, vy, count, parameters);
+#else
+        simulateScalar(x, y, vx, vy, count, parameters);
+#endif
+    }
+
+    const char *simdName()
+    {
+#if defined(PARTICLES_AVX)
+        if (useAVX) { return "AVX"; }
+#endif
+#if defined(PARTICLES_SSE)
+        return "SSE";
+#else
+        return "scalar";
+#endif
+    }
+
+    float largestDifference(std::vector<float> const &a, std::vector<float> const &b)
+    {
+        float difference = 0.0f;
+        for (size_t i = 0; i < a.size(); i++) { difference = std::max(difference, std::fabs(a[i] - b[i])); }
+        return difference;
+    }
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    // GL objects can't be deleted here anymore, but the threads have to be stopped
+    std::unique_lock<std::mutex> lock(poolMutex);
+    stopping = true;
+    lock.unlock();
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+}
+
+bool ParticleSystem::initialize(ShaderProgramCache *cache, int threads)
+{
+    std::vector<ShaderStage> renderStages =
+    {
+        { GL_VERTEX_SHADER, vertexShaderSource },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource }
+    };
+    renderProgram = cache != NULL ? cache->loadProgram(renderStages, "particles") : compileShaderProgram(renderStages, "particles");
+    if (renderProgram == 0) { return false; }
+
+    // compute shaders and storage buffers are core in 4.3, macOS only has 4.1
+    if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3))
+    {
+        std::vector<ShaderStage> computeStages = { { GL_COMPUTE_SHADER, computeShaderSource } };
+        computeProgram = cache != NULL
+            ? cache->loadProgram(computeStages, "particles-simulation")
+            : compileShaderProgram(computeStages, "particles-simulation");
+    }
+    if (computeProgram != 0)
+    {
+        countLocation = glGetUniformLocation(computeProgram, "Count");
+        deltaTimeLocation = glGetUniformLocation(computeProgram, "DeltaTime");
+        attractorLocation = glGetUniformLocation(computeProgram, "Attractor");
+        dampingLocation = glGetUniformLocation(computeProgram, "Damping");
+        strengthLocation = glGetUniformLocation(computeProgram, "Strength");
+        softeningLocation = glGetUniformLocation(computeProgram, "Softening");
+        glGenBuffers(1, &particleBuffer);
+    }
+    else { logWarning("Compute shaders are not supported, particles are simulated on CPU only"); }
+    backend = stats.backend = computeProgram != 0 ? ParticleBackend::GPU : ParticleBackend::CPU;
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    positionsStream.initialize(GL_ARRAY_BUFFER, 1024 * 1024, true);
+    glGenQueries(queriesInFlight * 4, &queries[0][0]);
+
+    // the GL thread simulates a part as well
+    int threadsCount = threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    stopping = false;
+    for (int i = 1; i < threadsCount; i++) { workers.emplace_back(&ParticleSystem::workerLoop, this, i); }
+
+    stats.computeSupported = computeProgram != 0;
+    stats.threads = threadsCount;
+    stats.simd = simdName();
+    lastUpdate = std::chrono::steady_clock::now();
+    return true;
+}
+
+void ParticleSystem::shutdown()
+{
+    std::unique_lock<std::mutex> lock(poolMutex);
+    stopping = true;
+    lock.unlock();
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+    workers.clear();
+
+    if (renderProgram == 0) { return; }
+    glDeleteQueries(queriesInFlight * 4, &queries[0][0]);
+    positionsStream.shutdown();
+    glDeleteVertexArrays(1, &vertexArray);
+    if (particleBuffer != 0) { glDeleteBuffers(1, &particleBuffer); }
+    if (computeProgram != 0) { glDeleteProgram(computeProgram); }
+    glDeleteProgram(renderProgram);
+    renderProgram = computeProgram = vertexArray = particleBuffer = 0;
+    count = 0;
+}
+
+void ParticleSystem::workerLoop(int index)
+{
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(poolMutex);
+    while (true)
+    {
+        workAvailable.wait(lock, [this, generation]() { return stopping || jobGeneration != generation; });
+        if (stopping) { return; }
+        generation = jobGeneration;
+
+        // the job doesn't change until every part of it is done
+        lock.unlock();
+        job(index);
+        lock.lock();
+        if (--jobsLeft == 0) { workDone.notify_one(); }
+    }
+}
+
+void ParticleSystem::runParallel(std::function<void(int)> const &task)
+{
+    if (workers.empty())
+    {
+        task(0);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    job = task;
+    jobsLeft = static_cast<int>(workers.size());
+    jobGeneration++;
+    lock.unlock();
+    workAvailable.notify_all();
+
+    task(0);
+
+    lock.lock();
+    workDone.wait(lock, [this]() { return jobsLeft == 0; });
+}
+
+void ParticleSystem::setCount(int newCount)
+{
+    if (static_cast<size_t>(newCount) == count) { return; }
+    count = static_cast<size_t>(std::max(0, newCount));
+    stats.count = static_cast<int>(count);
+    reset();
+}
+
+// particles all over the window, going around the center
+void ParticleSystem::reset()
+{
+    // always the same seed, so runs are comparable
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    positionsX.resize(count);
+    positionsY.resize(count);
+    velocitiesX.resize(count);
+    velocitiesY.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        positionsX[i] = position(random);
+        positionsY[i] = position(random);
+        velocitiesX[i] = -0.4f * positionsY[i];
+        velocitiesY[i] = 0.4f * positionsX[i];
+    }
+    if (backend == ParticleBackend::GPU) { uploadToGPU(); }
+}
+
+void ParticleSystem::uploadToGPU()
+{
+    size_t arrayBytes = count * sizeof(float);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(arrayBytes * 4, sizeof(float)), NULL, GL_DYNAMIC_DRAW);
+    if (count > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, arrayBytes, positionsX.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes, arrayBytes, positionsY.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 2, arrayBytes, velocitiesX.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 3, arrayBytes, velocitiesY.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ParticleSystem::readFromGPU()
+{
+    if (count == 0) { return; }
+    size_t arrayBytes = count * sizeof(float);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, arrayBytes, positionsX.data());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes, arrayBytes, positionsY.data());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 2, arrayBytes, velocitiesX.data());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 3, arrayBytes, velocitiesY.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ParticleSystem::setBackend(ParticleBackend newBackend)
+{
+    if (newBackend == ParticleBackend::GPU && !computeSupported()) { newBackend = ParticleBackend::CPU; }
+    if (newBackend == backend) { return; }
+
+    // the particles continue where they were
+    if (newBackend == ParticleBackend::GPU) { uploadToGPU(); }
+    else { readFromGPU(); }
+    backend = stats.backend = newBackend;
+}
+
+void ParticleSystem::dispatch(GLuint buffer, StepParameters const &parameters)
+{
+    glUseProgram(computeProgram);
+    glUniform1ui(countLocation, static_cast<GLuint>(count));
+    glUniform1f(deltaTimeLocation, parameters.deltaTime);
+    glUniform2f(attractorLocation, parameters.attractor[0], parameters.attractor[1]);
+    glUniform1f(dampingLocation, parameters.damping);
+    glUniform1f(strengthLocation, strength);
+    glUniform1f(softeningLocation, softening);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+    glDispatchCompute(static_cast<GLuint>((count + workGroupSize - 1) / workGroupSize), 1, 1);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    // the results are read as vertex attributes and by glGetBufferSubData()
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void ParticleSystem::simulateOnCPU(StepParameters const &parameters)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // positions go into the stream right after they are simulated, by every thread,
+    // X of all the particles and then Y, like in the storage buffer
+    size_t arrayBytes = count * sizeof(float);
+    float *destination = static_cast<float *>(positionsStream.beginWrite(arrayBytes * 2));
+    size_t parts = workers.size() + 1;
+    size_t partSize = ((count + parts - 1) / parts + simdWidth - 1) / simdWidth * simdWidth;
+    runParallel(
+        [this, &parameters, destination, partSize](int part)
+        {
+            size_t first = std::min(count, part * partSize),
+                   last = std::min(count, first + partSize);
+            if (first == last) { return; }
+            simulateSIMD(
+                &positionsX[first], &positionsY[first], &velocitiesX[first], &velocitiesY[first],
+                last - first,
+                parameters
+            );
+            if (destination == NULL) { return; }
+            std::memcpy(destination + first, &positionsX[first], (last - first) * sizeof(float));
+            std::memcpy(destination + count + first, &positionsY[first], (last - first) * sizeof(float));
+        }
+    );
+    positionsStream.endWrite(arrayBytes * 2);
+    positionsBuffer = positionsStream.buffer();
+    positionsOffset = positionsStream.offset();
+
+    stats.simulationMilliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
+
+void ParticleSystem::readQueries()
+{
+    for (int i = 0; i < queriesInFlight; i++)
+    {
+        int slot = (queryIndex + i) % queriesInFlight;
+        if (!queryPending[slot]) { continue; }
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[slot][3], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available != GL_TRUE) { continue; }
+
+        GLuint64 timestamps[4] = {};
+        for (int j = 0; j < 4; j++) { glGetQueryObjectui64v(queries[slot][j], GL_QUERY_RESULT, &timestamps[j]); }
+        queryPending[slot] = false;
+        if (queryBackend[slot] == ParticleBackend::GPU)
+        {
+            stats.simulationMilliseconds = (timestamps[1] - timestamps[0]) / 1000000.0;
+        }
+        stats.renderMilliseconds = (timestamps[3] - timestamps[2]) / 1000000.0;
+    }
+}
+
+void ParticleSystem::update()
+{
+    auto now = std::chrono::steady_clock::now();
+    float deltaTime = std::min(std::chrono::duration<float>(now - lastUpdate).count(), maximumDeltaTime);
+    lastUpdate = now;
+    if (!enabled || !initialized() || count == 0) { return; }
+
+    readQueries();
+    time += deltaTime;
+    StepParameters parameters;
+    parameters.deltaTime = deltaTime;
+    parameters.attractor[0] = 0.6f * std::cos(time * 0.7f);
+    parameters.attractor[1] = 0.4f * std::sin(time * 1.3f);
+    parameters.damping = std::pow(dampingPerSecond, deltaTime);
+
+    // GPU is too far behind if the slot is still pending, that frame is just not measured
+    queryPending[queryIndex] = false;
+    queryBackend[queryIndex] = backend;
+    glQueryCounter(queries[queryIndex][0], GL_TIMESTAMP);
+    if (backend == ParticleBackend::GPU)
+    {
+        dispatch(particleBuffer, parameters);
+        positionsBuffer = particleBuffer;
+        positionsOffset = 0;
+    }
+    else { simulateOnCPU(parameters); }
+    glQueryCounter(queries[queryIndex][1], GL_TIMESTAMP);
+}
+
+void ParticleSystem::draw()
+{
+    if (!enabled || !initialized() || count == 0 || positionsBuffer == 0) { return; }
+
+    glQueryCounter(queries[queryIndex][2], GL_TIMESTAMP);
+    glUseProgram(renderProgram);
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, positionsBuffer);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), reinterpret_cast<void *>(positionsOffset));
+    glVertexAttribPointer(
+        1, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+        reinterpret_cast<void *>(positionsOffset + count * sizeof(float))
+    );
+    // overlapping particles add up
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (backend == ParticleBackend::CPU) { positionsStream.fence(); }
+    glQueryCounter(queries[queryIndex][3], GL_TIMESTAMP);
+
+    queryPending[queryIndex] = true;
+    queryIndex = (queryIndex + 1) % queriesInFlight;
+}
+
+void ParticleSystem::validate()
+{
+    if (!initialized() || count == 0) { return; }
+    if (backend == ParticleBackend::GPU) { readFromGPU(); }
+
+    StepParameters parameters;
+    parameters.deltaTime = 1.0f / 60.0f;
+    parameters.attractor[0] = 0.6f * std::cos(time * 0.7f);
+    parameters.attractor[1] = 0.4f * std::sin(time * 1.3f);
+    parameters.damping = std::pow(dampingPerSecond, parameters.deltaTime);
+
+    std::vector<float> simd[4] = { positionsX, positionsY, velocitiesX, velocitiesY },
+                       scalar[4] = { positionsX, positionsY, velocitiesX, velocitiesY };
+    simulateSIMD(simd[0].data(), simd[1].data(), simd[2].data(), simd[3].data(), count, parameters);
+    simulateScalar(scalar[0].data(), scalar[1].data(), scalar[2].data(), scalar[3].data(), count, parameters);
+    float scalarDifference = 0.0f;
+    for (int i = 0; i < 4; i++) { scalarDifference = std::max(scalarDifference, largestDifference(simd[i], scalar[i])); }
+    stats.scalarDifference = scalarDifference;
+
+    if (computeSupported())
+    {
+        // a buffer of its own, the particles stay as they are
+        size_t arrayBytes = count * sizeof(float);
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 4, NULL, GL_DYNAMIC_READ);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, arrayBytes, positionsX.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes, arrayBytes, positionsY.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 2, arrayBytes, velocitiesX.data());
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * 3, arrayBytes, velocitiesY.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        dispatch(buffer, parameters);
+
+        std::vector<float> gpu(count);
+        float gpuDifference = 0.0f;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        for (int i = 0; i < 4; i++)
+        {
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, arrayBytes * i, arrayBytes, gpu.data());
+            gpuDifference = std::max(gpuDifference, largestDifference(gpu, scalar[i]));
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        stats.gpuDifference = gpuDifference;
+    }
+
+    if (computeSupported())
+    {
+        logInfo(
+            "Particles validated: %zu particles, %s differs from scalar by %g, compute shader by %g",
+            count,
+            simdName(),
+            stats.scalarDifference,
+            stats.gpuDifference
+        );
+    }
+    else { logInfo("Particles validated: %zu particles, %s differs from scalar by %g", count, simdName(), stats.scalarDifference); }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "shader-cache.h"
+#include "stream-buffer.h"
+
+enum class ParticleBackend
+{
+    // compute shader over a storage buffer, GL 4.3
+    GPU,
+    // worker threads with SSE/AVX, positions are streamed every frame
+    CPU
+};
+
+struct ParticleStatistics
+{
+    int count = 0;
+    ParticleBackend backend = ParticleBackend::CPU;
+    bool computeSupported = false;
+    // CPU backend: threads simulating, including the GL one, and the widest SIMD in use
+    int threads = 0;
+    const char *simd = "scalar";
+    // CPU time of the CPU backend (including writing the positions into the stream),
+    // GPU time of the compute dispatch
+    double simulationMilliseconds = 0.0;
+    // GPU time of drawing the particles
+    double renderMilliseconds = 0.0;
+    // the largest difference of positions and velocities after one step from the same state:
+    // of the compute shader and of the scalar code from the SIMD one, negative if not validated
+    double gpuDifference = -1.0;
+    double scalarDifference = -1.0;
+};
+
+// Particles around an attractor that moves along a curve, drawn as points
+// without any CPU round trip. Both backends keep the particles in the same
+// structure-of-arrays layout (all X, all Y, then the velocities), so the
+// vertex shader reads positions right from the compute shader's storage
+// buffer or from the stream that the CPU backend writes them into, and
+// switching the backend carries the particles over
+class ParticleSystem
+{
+public:
+    ~ParticleSystem();
+
+    // 0 threads is all the cores
+    bool initialize(ShaderProgramCache *cache, int threads = 0);
+    void shutdown();
+    bool initialized() const { return renderProgram != 0; }
+    bool computeSupported() const { return computeProgram != 0; }
+
+    // the particles start over when the count changes
+    void setCount(int count);
+    // GPU falls back to CPU if compute shaders are not supported
+    void setBackend(ParticleBackend backend);
+
+    // GL thread, once per frame: simulates a step and draws the particles
+    void update();
+    void draw();
+
+    // simulates one step from the current state with every implementation
+    // (without changing the state) and compares the results
+    void validate();
+
+    bool enabled = false;
+
+    ParticleStatistics const &statistics() const { return stats; }
+
+    // what changes between the steps, the same for both backends
+    struct StepParameters
+    {
+        float deltaTime = 0.0f;
+        float attractor[2] = { 0.0f, 0.0f };
+        float damping = 1.0f;
+    };
+
+private:
+    static const int queriesInFlight = 4;
+
+    GLuint computeProgram = 0,
+           renderProgram = 0,
+           vertexArray = 0,
+           // the particles of the GPU backend, 4 floats per particle
+           particleBuffer = 0;
+    GLint countLocation = -1,
+          deltaTimeLocation = -1,
+          attractorLocation = -1,
+          dampingLocation = -1,
+          strengthLocation = -1,
+          softeningLocation = -1;
+    StreamBuffer positionsStream;
+
+    ParticleBackend backend = ParticleBackend::CPU;
+    size_t count = 0;
+    // the particles of the CPU backend
+    std::vector<float> positionsX, positionsY, velocitiesX, velocitiesY;
+    // where the current frame's positions are in the buffer that is drawn
+    GLuint positionsBuffer = 0;
+    size_t positionsOffset = 0;
+
+    std::chrono::steady_clock::time_point lastUpdate;
+    float time = 0.0f;
+
+    // simulation and drawing of a frame: dispatch start and end, draw start and end
+    GLuint queries[queriesInFlight][4] = {};
+    bool queryPending[queriesInFlight] = {};
+    // the simulation part is only measured on GPU for its backend
+    ParticleBackend queryBackend[queriesInFlight] = {};
+    int queryIndex = 0;
+
+    // a pool that simulates parts of the arrays, the GL thread takes a part as well
+    std::vector<std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable workAvailable,
+                            workDone;
+    std::function<void(int)> job;
+    uint64_t jobGeneration = 0;
+    int jobsLeft = 0;
+    bool stopping = false;
+
+    ParticleStatistics stats;
+
+    void reset();
+    void uploadToGPU();
+    void readFromGPU();
+    void dispatch(GLuint buffer, StepParameters const &parameters);
+    void simulateOnCPU(StepParameters const &parameters);
+    void readQueries();
+    void runParallel(std::function<void(int)> const &task);
+    void workerLoop(int index);
+};
@@ -0,0 +1,122 @@
+#include <GLFW/glfw3.h>
+
+#include "power-saving.h"
+#include "functions.h"
+
+namespace
+{
+    // ImDrawCmd has padding and pointers which are not part of the output,
+    // so only the fields that affect rendering go into the hash
+    struct HashedDrawCommand
+    {
+        float clipRect[4];
+        uint64_t textureId;
+        uint64_t userCallback;
+        unsigned int vertexOffset;
+        unsigned int indexOffset;
+        unsigned int elementsCount;
+        unsigned int padding;
+    };
+}
+
+uint64_t hashDrawList(ImDrawList const *drawList, uint64_t seed)
+{
+    uint64_t hash = hashBytes(drawList->VtxBuffer.Data, drawList->VtxBuffer.size_in_bytes(), seed);
+    hash = hashBytes(drawList->IdxBuffer.Data, drawList->IdxBuffer.size_in_bytes(), hash);
+    for (const ImDrawCmd &cmd : drawList->CmdBuffer)
+    {
+        HashedDrawCommand hashed = {};
+        hashed.clipRect[0] = cmd.ClipRect.x;
+        hashed.clipRect[1] = cmd.ClipRect.y;
+        hashed.clipRect[2] = cmd.ClipRect.z;
+        hashed.clipRect[3] = cmd.ClipRect.w;
+        hashed.textureId = reinterpret_cast<uint64_t>(cmd.TextureId);
+        hashed.userCallback = reinterpret_cast<uint64_t>(cmd.UserCallback);
+        hashed.vertexOffset = cmd.VtxOffset;
+        hashed.indexOffset = cmd.IdxOffset;
+        hashed.elementsCount = cmd.ElemCount;
+        hash = hashBytes(&hashed, sizeof(hashed), hash);
+    }
+    return hash;
+}
+
+uint64_t hashDrawData(ImDrawData const *drawData)
+{
+    if (drawData == NULL || !drawData->Valid) { return 0; }
+
+    const float display[6] =
+    {
+        drawData->DisplayPos.x, drawData->DisplayPos.y,
+        drawData->DisplaySize.x, drawData->DisplaySize.y,
+        drawData->FramebufferScale.x, drawData->FramebufferScale.y
+    };
+    uint64_t hash = hashBytes(display, sizeof(display));
+
+    for (int n = 0; n < drawData->CmdListsCount; n++)
+    {
+        hash = hashDrawList(drawData->CmdLists[n], hash);
+    }
+    return hash;
+}
+
+bool frameNeedsRendering(PowerSavingState &state, ImDrawData const *drawData)
+{
+    if (!state.enabled)
+    {
+        state.renderedFrames++;
+        return true;
+    }
+
+    uint64_t hash = hashDrawData(drawData);
+    bool changed = state.forceRender || hash != state.previousDrawDataHash;
+    state.previousDrawDataHash = hash;
+    state.forceRender = false;
+
+    if (changed)
+    {
+        state.renderedFrames++;
+        state.framesToSettle = 2;
+    }
+    else
+    {
+        state.skippedFrames++;
+    }
+    return changed;
+}
+
+double secondsUntilNextClockTick(
+    std::chrono::time_point<std::chrono::system_clock> now,
+    bool showMilliseconds
+)
+{
+    if (showMilliseconds) { return 0.001; }
+
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()
+        ) % 1000;
+    // plus a millisecond to be sure to wake up already in the next second
+    return (1000 - milliseconds.count() + 1) / 1000.0;
+}
+
+void waitForEvents(PowerSavingState &state, bool showMilliseconds)
+{
+    if (!state.enabled)
+    {
+        glfwPollEvents();
+        return;
+    }
+
+    if (state.framesToSettle > 0)
+    {
+        state.framesToSettle--;
+        glfwPollEvents();
+    }
+    else
+    {
+        glfwWaitEventsTimeout(
+            secondsUntilNextClockTick(std::chrono::system_clock::now(), showMilliseconds)
+        );
+        // whatever woke us up, build one more frame after this one before sleeping again
+        state.framesToSettle = 1;
+    }
+}
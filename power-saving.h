@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+#include <dearimgui/imgui.h>
+
+// Instead of redrawing at the full VSync rate all the time, the rendering loop
+// sleeps until there are some events (or until the clock in the "Controls" window
+// needs to show a new value), and a frame which would look exactly
+// like the previous one is neither submitted to GL nor swapped
+struct PowerSavingState
+{
+    bool enabled = false;
+    uint64_t renderedFrames = 0;
+    uint64_t skippedFrames = 0;
+    uint64_t previousDrawDataHash = 0;
+    // some changes take Dear ImGui more than one frame (popups opening and such),
+    // so the loop keeps building frames without waiting until the output settles
+    int framesToSettle = 0;
+    // the next frame has to be rendered regardless of its draw data (window resize, etc)
+    bool forceRender = true;
+};
+
+uint64_t hashDrawList(ImDrawList const *drawList, uint64_t seed);
+uint64_t hashDrawData(ImDrawData const *drawData);
+
+// returns true if the frame needs to be rendered and swapped,
+// also counts rendered and skipped frames
+bool frameNeedsRendering(PowerSavingState &state, ImDrawData const *drawData);
+
+// how long can we sleep until the clock has to show a different value
+double secondsUntilNextClockTick(
+    std::chrono::time_point<std::chrono::system_clock> now,
+    bool showMilliseconds
+);
+
+// polls events if the output hasn't settled yet, otherwise blocks until
+// there are some events or the clock ticks
+void waitForEvents(PowerSavingState &state, bool showMilliseconds);
@@ -0,0 +1,332 @@
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <dearimgui/imgui.h>
+
+#include "profiler.h"
+#include "logger.h"
+
+namespace
+{
+    const char *phaseNames[framePhasesCount] =
+    {
+        "Clear",
+        "Scene",
+        "Compose UI",
+        "ImGui::Render",
+        "ImGui submit",
+        "Swap"
+    };
+
+    const ImU32 phaseColors[framePhasesCount] =
+    {
+        IM_COL32(120, 120, 120, 255),
+        IM_COL32(255, 128,  51, 255),
+        IM_COL32( 80, 160, 255, 255),
+        IM_COL32(170, 110, 255, 255),
+        IM_COL32( 90, 220, 120, 255),
+        IM_COL32(230, 200,  60, 255)
+    };
+}
+
+const char *framePhaseName(FramePhase phase)
+{
+    return phaseNames[static_cast<int>(phase)];
+}
+
+void FrameProfiler::initialize()
+{
+    for (QuerySlot &slot : slots)
+    {
+        glGenQueries(framePhasesCount * 2, &slot.queries[0][0]);
+    }
+    epoch = std::chrono::steady_clock::now();
+    initialized = true;
+}
+
+void FrameProfiler::shutdown()
+{
+    if (!initialized) { return; }
+    for (QuerySlot &slot : slots)
+    {
+        glDeleteQueries(framePhasesCount * 2, &slot.queries[0][0]);
+    }
+    initialized = false;
+}
+
+double FrameProfiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+FrameTiming &FrameProfiler::currentFrame()
+{
+    return history[frameIndex % historySize];
+}
+
+FrameProfiler::QuerySlot &FrameProfiler::currentSlot()
+{
+    return slots[frameIndex % framesInFlight];
+}
+
+void FrameProfiler::resolveQueries()
+{
+    for (QuerySlot &slot : slots)
+    {
+        if (!slot.pending) { continue; }
+
+        // results of all the queries of the frame have to be there,
+        // if they aren't, then we'll check again next frame
+        bool available = true;
+        for (int p = 0; p < framePhasesCount && available; p++)
+        {
+            if (!slot.used[p]) { continue; }
+            GLint resultAvailable = GL_FALSE;
+            glGetQueryObjectiv(slot.queries[p][1], GL_QUERY_RESULT_AVAILABLE, &resultAvailable);
+            available = resultAvailable == GL_TRUE;
+        }
+        if (!available) { continue; }
+
+        slot.pending = false;
+        FrameTiming &frame = history[slot.frameIndex % historySize];
+        // the history has already moved on
+        if (frame.frameIndex != slot.frameIndex) { continue; }
+
+        GLuint64 timestamps[framePhasesCount][2] = {};
+        GLuint64 frameGpuStart = UINT64_MAX;
+        for (int p = 0; p < framePhasesCount; p++)
+        {
+            if (!slot.used[p]) { continue; }
+            glGetQueryObjectui64v(slot.queries[p][0], GL_QUERY_RESULT, &timestamps[p][0]);
+            glGetQueryObjectui64v(slot.queries[p][1], GL_QUERY_RESULT, &timestamps[p][1]);
+            frameGpuStart = std::min(frameGpuStart, timestamps[p][0]);
+        }
+        for (int p = 0; p < framePhasesCount; p++)
+        {
+            if (!slot.used[p]) { continue; }
+            // nanoseconds to microseconds
+            frame.phases[p].gpuStart = (timestamps[p][0] - frameGpuStart) / 1000.0;
+            frame.phases[p].gpuDuration = (timestamps[p][1] - timestamps[p][0]) / 1000.0;
+        }
+        frame.gpuResolved = true;
+    }
+}
+
+void FrameProfiler::beginFrame()
+{
+    if (!enabled || !initialized) { return; }
+
+    resolveQueries();
+
+    // GPU is too far behind, results of that frame are lost,
+    // but that's still better than waiting for them
+    QuerySlot &slot = currentSlot();
+    slot.pending = false;
+    slot.frameIndex = frameIndex;
+    std::fill(std::begin(slot.used), std::end(slot.used), false);
+
+    FrameTiming &frame = currentFrame();
+    frame = FrameTiming();
+    frame.cpuStart = now();
+    frameActive = true;
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!frameActive) { return; }
+    frameActive = false;
+
+    FrameTiming &frame = currentFrame();
+    frame.cpuDuration = now() - frame.cpuStart;
+    // only now the frame counts as recorded
+    frame.frameIndex = frameIndex;
+    currentSlot().pending = true;
+    frameIndex++;
+}
+
+void FrameProfiler::beginPhase(FramePhase phase)
+{
+    if (!frameActive) { return; }
+
+    int p = static_cast<int>(phase);
+    QuerySlot &slot = currentSlot();
+    glQueryCounter(slot.queries[p][0], GL_TIMESTAMP);
+    slot.used[p] = true;
+
+    PhaseTiming &timing = currentFrame().phases[p];
+    timing.recorded = true;
+    timing.cpuStart = now();
+}
+
+void FrameProfiler::endPhase(FramePhase phase)
+{
+    if (!frameActive) { return; }
+
+    int p = static_cast<int>(phase);
+    PhaseTiming &timing = currentFrame().phases[p];
+    timing.cpuDuration = now() - timing.cpuStart;
+    glQueryCounter(currentSlot().queries[p][1], GL_TIMESTAMP);
+}
+
+std::vector<const FrameTiming *> FrameProfiler::recentFrames(int count) const
+{
+    std::vector<const FrameTiming *> frames;
+    count = std::min(count, historySize);
+    for (uint64_t i = frameIndex - std::min<uint64_t>(frameIndex, count); i < frameIndex; i++)
+    {
+        const FrameTiming &frame = history[i % historySize];
+        if (frame.frameIndex == i) { frames.push_back(&frame); }
+    }
+    return frames;
+}
+
+const FrameTiming *FrameProfiler::lastFrame() const
+{
+    if (frameIndex == 0) { return NULL; }
+    const FrameTiming &frame = history[(frameIndex - 1) % historySize];
+    return frame.frameIndex == frameIndex - 1 ? &frame : NULL;
+}
+
+const FrameTiming *FrameProfiler::lastGpuFrame() const
+{
+    // queries are read at most a few frames later, or never
+    for (uint64_t i = frameIndex; i > 0 && frameIndex - i <= framesInFlight; i--)
+    {
+        const FrameTiming &frame = history[(i - 1) % historySize];
+        if (frame.frameIndex == i - 1 && frame.gpuResolved) { return &frame; }
+    }
+    return NULL;
+}
+
+void FrameProfiler::averagePhaseDurations(int frames, double cpuAverages[], double gpuAverages[]) const
+{
+    std::vector<const FrameTiming *> recent = recentFrames(frames);
+    int gpuFrames = 0;
+    for (int p = 0; p < framePhasesCount; p++)
+    {
+        cpuAverages[p] = 0.0;
+        gpuAverages[p] = 0.0;
+    }
+    for (const FrameTiming *frame : recent)
+    {
+        if (frame->gpuResolved) { gpuFrames++; }
+        for (int p = 0; p < framePhasesCount; p++)
+        {
+            cpuAverages[p] += frame->phases[p].cpuDuration / 1000.0;
+            if (frame->gpuResolved) { gpuAverages[p] += frame->phases[p].gpuDuration / 1000.0; }
+        }
+    }
+    for (int p = 0; p < framePhasesCount; p++)
+    {
+        if (!recent.empty()) { cpuAverages[p] /= recent.size(); }
+        if (gpuFrames > 0) { gpuAverages[p] /= gpuFrames; }
+    }
+}
+
+void FrameProfiler::drawGraph()
+{
+    ImGui::RadioButton("CPU", &graphSource, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("GPU", &graphSource, 1);
+    bool showGpuTimes = graphSource == 1;
+
+    const float barWidth = 2.0f;
+    ImVec2 size = ImVec2(ImGui::GetContentRegionAvail().x, 80.0f);
+    int barsCount = static_cast<int>(size.x / barWidth);
+    std::vector<const FrameTiming *> frames = recentFrames(barsCount);
+
+    // scale to the slowest frame, but not less than 60 FPS worth
+    double scaleMs = 1000.0 / 60.0;
+    for (const FrameTiming *frame : frames)
+    {
+        double total = 0.0;
+        for (const PhaseTiming &phase : frame->phases)
+        {
+            total += showGpuTimes ? phase.gpuDuration : phase.cpuDuration;
+        }
+        scaleMs = std::max(scaleMs, total / 1000.0);
+    }
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(0, 0, 0, 100));
+    float x = origin.x + size.x - frames.size() * barWidth;
+    for (const FrameTiming *frame : frames)
+    {
+        float y = origin.y + size.y;
+        if (!showGpuTimes || frame->gpuResolved)
+        {
+            for (int p = 0; p < framePhasesCount; p++)
+            {
+                double duration = showGpuTimes ? frame->phases[p].gpuDuration : frame->phases[p].cpuDuration;
+                float height = static_cast<float>(duration / 1000.0 / scaleMs) * size.y;
+                if (height <= 0.0f) { continue; }
+                drawList->AddRectFilled(ImVec2(x, y - height), ImVec2(x + barWidth, y), phaseColors[p]);
+                y -= height;
+            }
+        }
+        x += barWidth;
+    }
+    ImGui::Dummy(size);
+    ImGui::Text("scale: %.1f ms", scaleMs);
+
+    double cpuAverages[framePhasesCount], gpuAverages[framePhasesCount];
+    averagePhaseDurations(60, cpuAverages, gpuAverages);
+    for (int p = 0; p < framePhasesCount; p++)
+    {
+        ImVec2 marker = ImGui::GetCursorScreenPos();
+        float lineHeight = ImGui::GetTextLineHeight();
+        drawList->AddRectFilled(
+            marker,
+            ImVec2(marker.x + lineHeight, marker.y + lineHeight),
+            phaseColors[p]
+        );
+        ImGui::Dummy(ImVec2(lineHeight, lineHeight));
+        ImGui::SameLine();
+        ImGui::Text("%s: %.3f / %.3f ms", phaseNames[p], cpuAverages[p], gpuAverages[p]);
+    }
+    ImGui::TextDisabled("CPU / GPU, average of 60 frames");
+}
+
+bool FrameProfiler::dumpChromeTrace(std::string const &path) const
+{
+    std::ofstream trace(path);
+    if (!trace)
+    {
+        logError("Couldn't open %s for writing", path.c_str());
+        return false;
+    }
+
+    // CPU phases go to the first "thread", GPU phases to the second one,
+    // GPU track is aligned to the CPU start of the frame
+    // microseconds since the start can be big enough to lose precision otherwise
+    trace << std::fixed << std::setprecision(3);
+    trace << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+          << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n"
+          << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}";
+    for (const FrameTiming *frame : recentFrames(historySize))
+    {
+        trace << ",\n{\"name\": \"Frame " << frame->frameIndex << "\", \"cat\": \"frame\", \"ph\": \"X\""
+              << ", \"ts\": " << frame->cpuStart << ", \"dur\": " << frame->cpuDuration
+              << ", \"pid\": 1, \"tid\": 1}";
+        for (int p = 0; p < framePhasesCount; p++)
+        {
+            const PhaseTiming &phase = frame->phases[p];
+            if (!phase.recorded) { continue; }
+            trace << ",\n{\"name\": \"" << phaseNames[p] << "\", \"cat\": \"cpu\", \"ph\": \"X\""
+                  << ", \"ts\": " << phase.cpuStart << ", \"dur\": " << phase.cpuDuration
+                  << ", \"pid\": 1, \"tid\": 1}";
+            if (frame->gpuResolved)
+            {
+                trace << ",\n{\"name\": \"" << phaseNames[p] << "\", \"cat\": \"gpu\", \"ph\": \"X\""
+                      << ", \"ts\": " << frame->cpuStart + phase.gpuStart << ", \"dur\": " << phase.gpuDuration
+                      << ", \"pid\": 1, \"tid\": 2}";
+            }
+        }
+    }
+    trace << "\n]}\n";
+
+    logInfo("Frame trace saved to %s", path.c_str());
+    return true;
+}
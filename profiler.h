@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// phases of a frame in the order they happen
+enum class FramePhase
+{
+    Clear = 0,
+    Scene,
+    ComposeUI,
+    ImGuiRender,
+    ImGuiSubmit,
+    Swap,
+    Count
+};
+
+const int framePhasesCount = static_cast<int>(FramePhase::Count);
+
+const char *framePhaseName(FramePhase phase);
+
+// all the times are in microseconds, starts are relative to the profiler creation
+struct PhaseTiming
+{
+    bool recorded = false;
+    double cpuStart = 0.0;
+    double cpuDuration = 0.0;
+    double gpuStart = 0.0; // relative to the first GPU timestamp of the frame
+    double gpuDuration = 0.0;
+};
+
+struct FrameTiming
+{
+    uint64_t frameIndex = UINT64_MAX;
+    double cpuStart = 0.0;
+    double cpuDuration = 0.0;
+    bool gpuResolved = false;
+    PhaseTiming phases[framePhasesCount];
+};
+
+// Measures CPU time of frame phases with steady_clock and GPU time
+// with GL_TIMESTAMP queries. Queries of a frame are read back only
+// a few frames later and only if they are already available,
+// so reading them never stalls the pipeline
+class FrameProfiler
+{
+public:
+    // how many frames can GPU lag behind before their queries are reused
+    static const int framesInFlight = 4;
+    // frames kept for the graph and for the trace
+    static const int historySize = 240;
+
+    bool enabled = false;
+
+    // need GL context
+    void initialize();
+    void shutdown();
+
+    void beginFrame();
+    void endFrame();
+    void beginPhase(FramePhase phase);
+    void endPhase(FramePhase phase);
+
+    // frames in chronological order, only the ones that were completely recorded
+    std::vector<const FrameTiming *> recentFrames(int count) const;
+    // the last recorded frame and the last one with GPU times, NULL if there is none yet
+    const FrameTiming *lastFrame() const;
+    const FrameTiming *lastGpuFrame() const;
+    // average CPU and GPU durations (ms) of every phase over the last frames
+    void averagePhaseDurations(int frames, double cpuAverages[], double gpuAverages[]) const;
+
+    // stacked graph of the recent frames and per-phase averages,
+    // to be called between ImGui::Begin/End
+    void drawGraph();
+    // Chrome trace_event JSON of the recorded history (chrome://tracing, Perfetto)
+    bool dumpChromeTrace(std::string const &path) const;
+
+private:
+    struct QuerySlot
+    {
+        bool pending = false;
+        uint64_t frameIndex = 0;
+        bool used[framePhasesCount] = {};
+        GLuint queries[framePhasesCount][2] = {};
+    };
+
+    bool initialized = false;
+    // enabling the profiler in the middle of a frame should not record half of it
+    bool frameActive = false;
+    uint64_t frameIndex = 0;
+    std::chrono::time_point<std::chrono::steady_clock> epoch = std::chrono::steady_clock::now();
+    std::vector<FrameTiming> history = std::vector<FrameTiming>(historySize);
+    QuerySlot slots[framesInFlight];
+    // 0 - CPU, 1 - GPU
+    int graphSource = 0;
+
+    double now() const;
+    FrameTiming &currentFrame();
+    QuerySlot &currentSlot();
+    void resolveQueries();
+};
+
+// profiles the enclosing scope as one phase
+class ProfilerScope
+{
+public:
+    ProfilerScope(FrameProfiler &profiler, FramePhase phase) : profiler(profiler), phase(phase)
+    {
+        profiler.beginPhase(phase);
+    }
+    ~ProfilerScope() { profiler.endPhase(phase); }
+
+    ProfilerScope(ProfilerScope const &) = delete;
+    ProfilerScope &operator=(ProfilerScope const &) = delete;
+
+private:
+    FrameProfiler &profiler;
+    FramePhase phase;
+};
@@ -0,0 +1,487 @@
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include <limits>
+
+#include "retained-layers.h"
+#include "power-saving.h"
+#include "functions.h"
+
+namespace
+{
+    // a window that changed in that many frames in a row is drawn directly
+    const int volatileFrames = 2;
+    // layers of windows that are not there anymore are deleted after that
+    const uint64_t unusedFrames = 120;
+
+    // the whole texture over the rectangle, which is in normalized device coordinates
+    const char *vertexShaderSource = "#version 330 core\n"
+        "uniform vec4 Rectangle;\n"
+        "out vec2 Frag_UV;\n"
+        "void main()\n"
+        "{\n"
+        "   vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));\n"
+        "   Frag_UV = vec2(corner.x, 1.0 - corner.y);\n"
+        "   gl_Position = vec4(mix(Rectangle.xy, Rectangle.zw, corner), 0.0, 1.0);\n"
+        "}\n";
+    const char *fragmentShaderSource = "#version 330 core\n"
+        "in vec2 Frag_UV;\n"
+        "uniform sampler2D Texture;\n"
+        "out vec4 Out_Color;\n"
+        "void main()\n"
+        "{\n"
+        "   Out_Color = texture(Texture, Frag_UV.st);\n"
+        "}\n";
+
+    bool isMarker(ImDrawCmd const &command)
+    {
+        return command.UserCallback == retainedLayerMarker
+            || command.UserCallback == volatileBeginMarker
+            || command.UserCallback == volatileEndMarker;
+    }
+
+    // ImVector pointing into another one, it must be released before it's destroyed
+    template<typename T>
+    void shareVector(ImVector<T> &vector, ImVector<T> const &source)
+    {
+        vector.Data = source.Data;
+        vector.Size = vector.Capacity = source.Size;
+    }
+
+    template<typename T>
+    void releaseVector(ImVector<T> &vector)
+    {
+        vector.Data = NULL;
+        vector.Size = vector.Capacity = 0;
+    }
+
+    // unlike hashDrawList(), doesn't depend on where the vertices of a command are
+    // in the buffer, as volatile regions before it change how many vertices there are
+    uint64_t hashCommands(ImDrawList const *drawList, uint64_t seed)
+    {
+        uint64_t hash = seed;
+        ImDrawIdx relative[256];
+        for (ImDrawCmd const &command : drawList->CmdBuffer)
+        {
+            if (command.UserCallback != NULL || command.ElemCount == 0) { continue; }
+            const ImDrawIdx *indices = drawList->IdxBuffer.Data + command.IdxOffset;
+            ImDrawIdx first = std::numeric_limits<ImDrawIdx>::max(),
+                      last = 0;
+            for (unsigned int i = 0; i < command.ElemCount; i++)
+            {
+                first = std::min(first, indices[i]);
+                last = std::max(last, indices[i]);
+            }
+
+#if IMGUI_VERSION_NUM >= 19200
+            uint64_t texture = (uint64_t)(intptr_t)command.GetTexID();
+#else
+            uint64_t texture = (uint64_t)(intptr_t)command.TextureId;
+#endif
+            const float clip[4] = { command.ClipRect.x, command.ClipRect.y, command.ClipRect.z, command.ClipRect.w };
+            hash = hashBytes(clip, sizeof(clip), hash);
+            hash = hashBytes(&texture, sizeof(texture), hash);
+            hash = hashBytes(
+                drawList->VtxBuffer.Data + command.VtxOffset + first,
+                (static_cast<size_t>(last) - first + 1) * sizeof(ImDrawVert),
+                hash
+            );
+            for (unsigned int i = 0; i < command.ElemCount; i += 256)
+            {
+                unsigned int count = std::min(command.ElemCount - i, 256u);
+                for (unsigned int j = 0; j < count; j++) { relative[j] = static_cast<ImDrawIdx>(indices[i + j] - first); }
+                hash = hashBytes(relative, count * sizeof(ImDrawIdx), hash);
+            }
+        }
+        return hash;
+    }
+
+    bool findMarker(ImDrawList const *drawList, ImGuiID &id)
+    {
+        for (ImDrawCmd const &command : drawList->CmdBuffer)
+        {
+            if (command.UserCallback == retainedLayerMarker)
+            {
+                id = static_cast<ImGuiID>(reinterpret_cast<uintptr_t>(command.UserCallbackData));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // what the list covers, in framebuffer pixels
+    bool listBounds(
+        ImDrawList const *drawList,
+        ImDrawData const *drawData,
+        int framebufferWidth,
+        int framebufferHeight,
+        int bounds[4]
+    )
+    {
+        ImVec4 vertices(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX),
+               clip(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (ImDrawVert const &vertex : drawList->VtxBuffer)
+        {
+            vertices.x = std::min(vertices.x, vertex.pos.x);
+            vertices.y = std::min(vertices.y, vertex.pos.y);
+            vertices.z = std::max(vertices.z, vertex.pos.x);
+            vertices.w = std::max(vertices.w, vertex.pos.y);
+        }
+        for (ImDrawCmd const &command : drawList->CmdBuffer)
+        {
+            if (command.UserCallback != NULL || command.ElemCount == 0) { continue; }
+            clip.x = std::min(clip.x, command.ClipRect.x);
+            clip.y = std::min(clip.y, command.ClipRect.y);
+            clip.z = std::max(clip.z, command.ClipRect.z);
+            clip.w = std::max(clip.w, command.ClipRect.w);
+        }
+
+        ImVec2 position = drawData->DisplayPos,
+               scale = drawData->FramebufferScale;
+        bounds[0] = std::max(0, static_cast<int>(std::floor((std::max(vertices.x, clip.x) - position.x) * scale.x)));
+        bounds[1] = std::max(0, static_cast<int>(std::floor((std::max(vertices.y, clip.y) - position.y) * scale.y)));
+        bounds[2] = std::min(framebufferWidth, static_cast<int>(std::ceil((std::min(vertices.z, clip.z) - position.x) * scale.x)));
+        bounds[3] = std::min(framebufferHeight, static_cast<int>(std::ceil((std::min(vertices.w, clip.w) - position.y) * scale.y)));
+        return bounds[2] > bounds[0] && bounds[3] > bounds[1];
+    }
+}
+
+bool RetainedLayers::initialize(ShaderProgramCache *cache)
+{
+    std::vector<ShaderStage> stages =
+    {
+        { GL_VERTEX_SHADER, vertexShaderSource },
+        { GL_FRAGMENT_SHADER, fragmentShaderSource }
+    };
+    program = cache != NULL ? cache->loadProgram(stages, "retained-layer") : compileShaderProgram(stages, "retained-layer");
+    if (program == 0) { return false; }
+    rectangleLocation = glGetUniformLocation(program, "Rectangle");
+    textureLocation = glGetUniformLocation(program, "Texture");
+    // the quad comes from gl_VertexID, but core profile needs a vertex array anyway
+    glGenVertexArrays(1, &vertexArray);
+    return true;
+}
+
+void RetainedLayers::shutdown()
+{
+    for (auto &item : layers) { deleteLayer(item.second); }
+    layers.clear();
+    for (TimerQuery &query : pendingQueries) { glDeleteQueries(2, query.queries); }
+    for (TimerQuery &query : freeQueries) { glDeleteQueries(2, query.queries); }
+    pendingQueries.clear();
+    freeQueries.clear();
+    if (vertexArray != 0) { glDeleteVertexArrays(1, &vertexArray); }
+    if (program != 0) { glDeleteProgram(program); }
+    vertexArray = program = 0;
+}
+
+void RetainedLayers::resizeLayer(Layer &layer, int width, int height)
+{
+    if (layer.texture == 0)
+    {
+        glGenTextures(1, &layer.texture);
+        glGenFramebuffers(1, &layer.framebuffer);
+    }
+    glBindTexture(GL_TEXTURE_2D, layer.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    // texels map exactly to pixels
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer.texture, 0);
+    layer.width = width;
+    layer.height = height;
+    layer.valid = false;
+}
+
+void RetainedLayers::deleteLayer(Layer &layer)
+{
+    if (layer.framebuffer != 0) { glDeleteFramebuffers(1, &layer.framebuffer); }
+    if (layer.texture != 0) { glDeleteTextures(1, &layer.texture); }
+    if (layer.composite != NULL) { IM_DELETE(layer.composite); }
+    for (ImDrawList *part : { layer.staticPart, layer.volatilePart })
+    {
+        if (part == NULL) { continue; }
+        releaseVector(part->VtxBuffer);
+        releaseVector(part->IdxBuffer);
+        IM_DELETE(part);
+    }
+    layer.framebuffer = layer.texture = 0;
+    layer.composite = layer.staticPart = layer.volatilePart = NULL;
+}
+
+bool RetainedLayers::splitVolatile(Layer &layer, ImDrawList *drawList)
+{
+    bool found = false;
+    for (ImDrawCmd const &command : drawList->CmdBuffer)
+    {
+        if (command.UserCallback == volatileBeginMarker)
+        {
+            found = true;
+            break;
+        }
+    }
+    if (!found) { return false; }
+
+    if (layer.staticPart == NULL)
+    {
+        layer.staticPart = IM_NEW(ImDrawList)(NULL);
+        layer.volatilePart = IM_NEW(ImDrawList)(NULL);
+    }
+    layer.staticPart->CmdBuffer.resize(0);
+    layer.volatilePart->CmdBuffer.resize(0);
+    int depth = 0;
+    for (ImDrawCmd const &command : drawList->CmdBuffer)
+    {
+        if (command.UserCallback == volatileBeginMarker) { depth++; }
+        else if (command.UserCallback == volatileEndMarker) { depth = std::max(depth - 1, 0); }
+        if (isMarker(command) || (command.UserCallback == NULL && command.ElemCount == 0)) { continue; }
+        (depth > 0 ? layer.volatilePart : layer.staticPart)->CmdBuffer.push_back(command);
+    }
+    for (ImDrawList *part : { layer.staticPart, layer.volatilePart })
+    {
+        shareVector(part->VtxBuffer, drawList->VtxBuffer);
+        shareVector(part->IdxBuffer, drawList->IdxBuffer);
+    }
+    return true;
+}
+
+void RetainedLayers::resolveQueries()
+{
+    for (size_t i = 0; i < pendingQueries.size();)
+    {
+        TimerQuery &query = pendingQueries[i];
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available != GL_TRUE)
+        {
+            i++;
+            continue;
+        }
+
+        GLuint64 timestamps[2] = {};
+        glGetQueryObjectui64v(query.queries[0], GL_QUERY_RESULT, &timestamps[0]);
+        glGetQueryObjectui64v(query.queries[1], GL_QUERY_RESULT, &timestamps[1]);
+        auto found = layers.find(query.layer);
+        // nanoseconds to milliseconds
+        if (found != layers.end()) { found->second.renderMilliseconds = (timestamps[1] - timestamps[0]) / 1000000.0; }
+
+        freeQueries.push_back(query);
+        pendingQueries[i] = pendingQueries.back();
+        pendingQueries.pop_back();
+    }
+}
+
+void RetainedLayers::renderLayer(Layer &layer, ImDrawList *drawList, ImDrawData const *drawData, Renderer const &render)
+{
+    TimerQuery query;
+    if (!freeQueries.empty())
+    {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    else { glGenQueries(2, query.queries); }
+    query.layer = layer.id;
+    glQueryCounter(query.queries[0], GL_TIMESTAMP);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, layer.width, layer.height);
+    // unlike glClear(), doesn't change the clear color of the frame
+    const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, transparent);
+
+    ImVec2 scale = drawData->FramebufferScale;
+    single.Valid = true;
+    single.CmdListsCount = 1;
+    single.TotalVtxCount = drawList->VtxBuffer.Size;
+    single.TotalIdxCount = drawList->IdxBuffer.Size;
+    single.DisplayPos = ImVec2(drawData->DisplayPos.x + layer.x / scale.x, drawData->DisplayPos.y + layer.y / scale.y);
+    single.DisplaySize = ImVec2(layer.width / scale.x, layer.height / scale.y);
+    single.FramebufferScale = scale;
+#if IMGUI_VERSION_NUM >= 19200
+    // textures are created when they are first rendered, which could be right here
+    single.Textures = drawData->Textures;
+#endif
+    singleList.assign(1, drawList);
+#if IMGUI_VERSION_NUM >= 18980
+    single.CmdLists.resize(1);
+    single.CmdLists[0] = drawList;
+#else
+    single.CmdLists = singleList.data();
+#endif
+    render(&single);
+
+    glQueryCounter(query.queries[1], GL_TIMESTAMP);
+    pendingQueries.push_back(query);
+    layer.valid = true;
+}
+
+ImDrawData *RetainedLayers::prepare(ImDrawData *drawData, Renderer const &render)
+{
+    if (!initialized() || drawData == NULL || !drawData->Valid) { return drawData; }
+    if (!enabled)
+    {
+        for (auto &item : layers) { deleteLayer(item.second); }
+        layers.clear();
+        return drawData;
+    }
+
+    frame++;
+    resolveQueries();
+    framebufferWidth = static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+    framebufferHeight = static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+
+    GLint previousFramebuffer = 0;
+    bool framebufferChanged = false;
+    bool retained = false;
+    composedLists.clear();
+    for (int n = 0; n < drawData->CmdListsCount; n++)
+    {
+        ImDrawList *drawList = drawData->CmdLists[n];
+        ImGuiID id = 0;
+        int bounds[4] = {};
+        if (
+            !findMarker(drawList, id)
+            || !listBounds(drawList, drawData, framebufferWidth, framebufferHeight, bounds)
+        )
+        {
+            composedLists.push_back(drawList);
+            continue;
+        }
+
+        Layer &layer = layers[id];
+        if (layer.composite == NULL)
+        {
+            layer.owner = this;
+            layer.id = id;
+            layer.composite = IM_NEW(ImDrawList)(NULL);
+            // drawing the texture changes the state, so the renderer has to set it again
+            ImDrawCmd command;
+            command.UserCallback = compositeCallback;
+            command.UserCallbackData = &layer;
+            layer.composite->CmdBuffer.push_back(command);
+            command.UserCallback = ImDrawCallback_ResetRenderState;
+            command.UserCallbackData = NULL;
+            layer.composite->CmdBuffer.push_back(command);
+        }
+        layer.lastUsedFrame = frame;
+
+        // with volatile regions only the rest of the window goes into the texture
+        bool split = splitVolatile(layer, drawList);
+        ImDrawList *retainedList = split ? layer.staticPart : drawList;
+        uint64_t hash = split
+            ? hashCommands(retainedList, hashBytes(bounds, sizeof(bounds)))
+            : hashDrawList(drawList, hashBytes(bounds, sizeof(bounds)));
+        layer.changedFrames = hash != layer.previousHash ? layer.changedFrames + 1 : 0;
+        layer.previousHash = hash;
+
+        if (layer.valid && hash == layer.textureHash)
+        {
+            totals.hits++;
+            totals.gpuMillisecondsSaved += layer.renderMilliseconds;
+        }
+        else if (layer.changedFrames <= volatileFrames)
+        {
+            if (!framebufferChanged)
+            {
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+                framebufferChanged = true;
+            }
+            int width = bounds[2] - bounds[0],
+                height = bounds[3] - bounds[1];
+            if (width != layer.width || height != layer.height) { resizeLayer(layer, width, height); }
+            layer.x = bounds[0];
+            layer.y = bounds[1];
+            renderLayer(layer, retainedList, drawData, render);
+            layer.textureHash = hash;
+            totals.misses++;
+        }
+        else
+        {
+            // the texture is out of date, it will be rendered again once the window settles
+            layer.valid = false;
+            totals.bypassed++;
+            composedLists.push_back(drawList);
+            continue;
+        }
+        composedLists.push_back(layer.composite);
+        if (split) { composedLists.push_back(layer.volatilePart); }
+        retained = true;
+    }
+    if (framebufferChanged)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+    }
+
+    totals.layers = 0;
+    totals.textureBytes = 0;
+    for (auto item = layers.begin(); item != layers.end();)
+    {
+        if (frame - item->second.lastUsedFrame > unusedFrames)
+        {
+            deleteLayer(item->second);
+            item = layers.erase(item);
+            continue;
+        }
+        totals.layers++;
+        totals.textureBytes += static_cast<size_t>(item->second.width) * item->second.height * 4;
+        ++item;
+    }
+    if (!retained) { return drawData; }
+
+    composed.Valid = true;
+    composed.CmdListsCount = static_cast<int>(composedLists.size());
+    composed.TotalIdxCount = 0;
+    composed.TotalVtxCount = 0;
+    for (ImDrawList const *drawList : composedLists)
+    {
+        composed.TotalIdxCount += drawList->IdxBuffer.Size;
+        composed.TotalVtxCount += drawList->VtxBuffer.Size;
+    }
+    composed.DisplayPos = drawData->DisplayPos;
+    composed.DisplaySize = drawData->DisplaySize;
+    composed.FramebufferScale = drawData->FramebufferScale;
+#if IMGUI_VERSION_NUM >= 19200
+    composed.Textures = drawData->Textures;
+#endif
+#if IMGUI_VERSION_NUM >= 18980
+    composed.CmdLists.resize(composed.CmdListsCount);
+    for (int n = 0; n < composed.CmdListsCount; n++) { composed.CmdLists[n] = composedLists[n]; }
+#else
+    composed.CmdLists = composedLists.data();
+#endif
+    return &composed;
+}
+
+void RetainedLayers::compositeCallback(ImDrawList const *, ImDrawCmd const *command)
+{
+    Layer const *layer = static_cast<Layer const *>(command->UserCallbackData);
+    layer->owner->composite(*layer);
+}
+
+void RetainedLayers::composite(Layer const &layer)
+{
+    float left = static_cast<float>(layer.x) / framebufferWidth * 2.0f - 1.0f,
+          right = static_cast<float>(layer.x + layer.width) / framebufferWidth * 2.0f - 1.0f,
+          top = 1.0f - static_cast<float>(layer.y) / framebufferHeight * 2.0f,
+          bottom = 1.0f - static_cast<float>(layer.y + layer.height) / framebufferHeight * 2.0f;
+
+    glUseProgram(program);
+    glUniform1i(textureLocation, 0);
+    glUniform4f(rectangleLocation, left, top, right, bottom);
+    glBindVertexArray(vertexArray);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, layer.texture);
+    // the layer was rendered over transparent black, so its colors are already multiplied by alpha
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <dearimgui/imgui.h>
+
+#include "shader-cache.h"
+#include "retained-windows.h"
+
+struct RetainedLayersStatistics
+{
+    int layers = 0;
+    // the window was unchanged and its cached texture was composited
+    uint64_t hits = 0;
+    // the window changed and was rendered into its texture again
+    uint64_t misses = 0;
+    // the window changes every frame, so it was rendered directly
+    uint64_t bypassed = 0;
+    // what the hits would have taken to render, by the last measured time of every layer
+    double gpuMillisecondsSaved = 0.0;
+    size_t textureBytes = 0;
+
+    double hitRate() const
+    {
+        uint64_t total = hits + misses + bypassed;
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+// Renders the draw lists of the marked windows into their own textures and
+// composites those over the scene instead of drawing the lists themselves.
+// A draw list is hashed every frame, and the window is rendered into its
+// texture again only when the hash changes. Windows that change in several
+// frames in a row are drawn directly until they settle, as caching them
+// would only add work. Volatile regions of a window are neither hashed nor
+// rendered into the texture, but drawn over it. Child windows, popups and
+// tooltips have their own draw lists and are drawn as usual
+class RetainedLayers
+{
+public:
+    // renders draw data with whatever renderer draws the frame
+    using Renderer = std::function<void(ImDrawData *)>;
+
+    bool initialize(ShaderProgramCache *cache);
+    void shutdown();
+    bool initialized() const { return program != 0; }
+
+    // GL thread, before the Dear ImGui pass: re-renders changed layers and returns
+    // draw data to render instead, the same draw data if nothing is retained
+    ImDrawData *prepare(ImDrawData *drawData, Renderer const &render);
+
+    RetainedLayersStatistics const &statistics() const { return totals; }
+
+    bool enabled = false;
+
+private:
+    struct Layer
+    {
+        RetainedLayers *owner = NULL;
+        ImGuiID id = 0;
+        GLuint texture = 0;
+        GLuint framebuffer = 0;
+        int width = 0;
+        int height = 0;
+        // in framebuffer pixels, from the top-left corner
+        int x = 0;
+        int y = 0;
+        bool valid = false;
+        uint64_t textureHash = 0;
+        uint64_t previousHash = 0;
+        int changedFrames = 0;
+        uint64_t lastUsedFrame = 0;
+        double renderMilliseconds = 0.0;
+        // draws the texture instead of the window's draw list
+        ImDrawList *composite = NULL;
+        // commands of the window's draw list outside and inside of volatile regions,
+        // their vertices and indices point into the window's draw list of the frame
+        ImDrawList *staticPart = NULL;
+        ImDrawList *volatilePart = NULL;
+    };
+
+    struct TimerQuery
+    {
+        GLuint queries[2] = {};
+        ImGuiID layer = 0;
+    };
+
+    GLuint program = 0,
+           vertexArray = 0;
+    GLint rectangleLocation = -1,
+          textureLocation = -1;
+    std::unordered_map<ImGuiID, Layer> layers;
+    std::vector<TimerQuery> pendingQueries;
+    std::vector<TimerQuery> freeQueries;
+    uint64_t frame = 0;
+    int framebufferWidth = 0,
+        framebufferHeight = 0;
+    RetainedLayersStatistics totals;
+
+    // what is actually rendered
+    ImDrawData composed;
+    std::vector<ImDrawList *> composedLists;
+    // a window alone, rendered into its layer
+    ImDrawData single;
+    std::vector<ImDrawList *> singleList;
+
+    void renderLayer(Layer &layer, ImDrawList *drawList, ImDrawData const *drawData, Renderer const &render);
+    void resizeLayer(Layer &layer, int width, int height);
+    void deleteLayer(Layer &layer);
+    // false if the draw list has no volatile regions
+    bool splitVolatile(Layer &layer, ImDrawList *drawList);
+    void resolveQueries();
+    static void compositeCallback(ImDrawList const *drawList, ImDrawCmd const *command);
+    void composite(Layer const &layer);
+};
@@ -0,0 +1,34 @@
+#include <cstdint>
+
+#include "retained-windows.h"
+
+namespace
+{
+    // of the window marked last, volatile regions don't matter in other windows
+    ImDrawList const *retainedDrawList = NULL;
+}
+
+void retainedLayerMarker(ImDrawList const *, ImDrawCmd const *) {}
+void volatileBeginMarker(ImDrawList const *, ImDrawCmd const *) {}
+void volatileEndMarker(ImDrawList const *, ImDrawCmd const *) {}
+
+void retainCurrentWindow()
+{
+    // the ID is seeded with the window's, so it is unique for every window
+    ImGuiID id = ImGui::GetID("##retained-layer");
+    ImGui::GetWindowDrawList()->AddCallback(retainedLayerMarker, reinterpret_cast<void *>(static_cast<uintptr_t>(id)));
+    retainedDrawList = ImGui::GetWindowDrawList();
+}
+
+void beginVolatileRegion()
+{
+    // a callback ends the current command, so the region gets commands of its own
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    if (drawList == retainedDrawList) { drawList->AddCallback(volatileBeginMarker, NULL); }
+}
+
+void endVolatileRegion()
+{
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    if (drawList == retainedDrawList) { drawList->AddCallback(volatileEndMarker, NULL); }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <dearimgui/imgui.h>
+
+// The UI thread side of the retained layers (retained-layers.h): it only puts
+// markers into the draw lists, so it needs no GL and builds wherever the UI does
+
+// UI thread, between Begin() and End(): the window gets a marker in its
+// draw list, so it can be retained on the render thread (even in pipelined
+// mode, where the render thread only gets copies of the draw lists)
+void retainCurrentWindow();
+// UI thread, around the widgets of a retained window that change every frame
+// (clocks, counters, plots): they are left out of the window's texture and
+// drawn over it every frame, so the rest of the window is still reused
+void beginVolatileRegion();
+void endVolatileRegion();
+
+// the markers, they do nothing when the list is drawn as usual
+void retainedLayerMarker(ImDrawList const *, ImDrawCmd const *);
+void volatileBeginMarker(ImDrawList const *, ImDrawCmd const *);
+void volatileEndMarker(ImDrawList const *, ImDrawCmd const *);
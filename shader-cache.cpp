@@ -0,0 +1,438 @@
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <GLFW/glfw3.h>
+
+#include "shader-cache.h"
+#include "functions.h"
+#include "logger.h"
+
+namespace
+{
+    const char binaryMagic[4] = { 'G', 'L', 'P', 'B' };
+    const uint32_t binaryVersion = 1;
+
+    struct BinaryHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    const char *stageName(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_VERTEX_SHADER: return "vertex";
+            case GL_FRAGMENT_SHADER: return "fragment";
+            case GL_GEOMETRY_SHADER: return "geometry";
+#ifdef GL_COMPUTE_SHADER
+            case GL_COMPUTE_SHADER: return "compute";
+#endif
+            default: return "unknown";
+        }
+    }
+
+    // info logs can be longer than a log record, so they go out line by line
+    void logInfoLog(std::string const &infoLog)
+    {
+        std::istringstream lines(infoLog);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (!line.empty()) { logError("    %s", line.c_str()); }
+        }
+    }
+
+    std::string shaderInfoLog(GLuint shader)
+    {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetShaderInfoLog(shader, length, NULL, &infoLog[0]);
+        infoLog.resize(std::strlen(infoLog.c_str()));
+        return infoLog;
+    }
+
+    std::string programInfoLog(GLuint program)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(static_cast<size_t>(std::max(length, 1)), '\0');
+        glGetProgramInfoLog(program, length, NULL, &infoLog[0]);
+        infoLog.resize(std::strlen(infoLog.c_str()));
+        return infoLog;
+    }
+
+    // GL_ARB_get_program_binary is core since 4.1,
+    // but a driver is allowed to support no binary formats at all
+    bool programBinariesSupported()
+    {
+        if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) { return false; }
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte *value = glGetString(name);
+        return value != NULL ? reinterpret_cast<const char *>(value) : "";
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+    }
+
+    GLuint linkShaderProgram(std::vector<ShaderStage> const &stages, std::string const &name, bool retrievable)
+    {
+        std::vector<GLuint> shaders;
+        bool compiled = true;
+        for (auto const &stage : stages)
+        {
+            GLuint shader = glCreateShader(stage.type);
+            const char *source = stage.source.c_str();
+            glShaderSource(shader, 1, &source, NULL);
+            glCompileShader(shader);
+            shaders.push_back(shader);
+
+            GLint success = 0;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                logError("Couldn't compile %s shader of program %s", stageName(stage.type), name.c_str());
+                logInfoLog(shaderInfoLog(shader));
+                compiled = false;
+            }
+        }
+
+        GLuint program = 0;
+        if (compiled)
+        {
+            program = glCreateProgram();
+            if (retrievable)
+            {
+                glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            }
+            for (GLuint shader : shaders) { glAttachShader(program, shader); }
+            glLinkProgram(program);
+
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                logError("Couldn't link program %s", name.c_str());
+                logInfoLog(programInfoLog(program));
+                glDeleteProgram(program);
+                program = 0;
+            }
+            else
+            {
+                for (GLuint shader : shaders) { glDetachShader(program, shader); }
+            }
+        }
+
+        for (GLuint shader : shaders) { glDeleteShader(shader); }
+        return program;
+    }
+}
+
+GLuint compileShaderProgram(std::vector<ShaderStage> const &stages, std::string const &name)
+{
+    return linkShaderProgram(stages, name, false);
+}
+
+void ShaderProgramCache::setDirectory(std::filesystem::path const &cacheDirectory)
+{
+    directory = cacheDirectory;
+    if (directory.empty()) { return; }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        logWarning(
+            "Couldn't create shader cache directory %s: %s",
+            directory.string().c_str(),
+            error.message().c_str()
+        );
+        directory.clear();
+    }
+}
+
+std::filesystem::path ShaderProgramCache::entryPath(
+    std::vector<ShaderStage> const &stages,
+    std::string const &name
+) const
+{
+    std::string driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+    uint64_t key = hashBytes(driver.data(), driver.size());
+    for (auto const &stage : stages)
+    {
+        key = hashBytes(&stage.type, sizeof(stage.type), key);
+        key = hashBytes(stage.source.data(), stage.source.size(), key);
+    }
+
+    std::ostringstream fileName;
+    fileName << name << '-' << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return directory / fileName.str();
+}
+
+GLuint ShaderProgramCache::loadBinary(std::filesystem::path const &path)
+{
+    std::string contents;
+    if (!readFile(path, contents)) { return 0; }
+
+    BinaryHeader header;
+    if (contents.size() < sizeof(header)) { return 0; }
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (
+        std::memcmp(header.magic, binaryMagic, sizeof(binaryMagic)) != 0
+        || header.version != binaryVersion
+        || contents.size() != sizeof(header) + header.length
+    )
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, contents.data() + sizeof(header), static_cast<GLsizei>(header.length));
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void ShaderProgramCache::storeBinary(GLuint program, std::filesystem::path const &path)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) { return; }
+
+    std::string contents(sizeof(BinaryHeader) + static_cast<size_t>(length), '\0');
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, &contents[sizeof(BinaryHeader)]);
+    if (written <= 0) { return; }
+    contents.resize(sizeof(BinaryHeader) + static_cast<size_t>(written));
+
+    BinaryHeader header;
+    std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+    header.version = binaryVersion;
+    header.format = format;
+    header.length = static_cast<uint32_t>(written);
+    std::memcpy(&contents[0], &header, sizeof(header));
+
+    // write to a temporary file first, so a concurrently starting instance
+    // never sees a half-written entry
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    std::error_code error;
+    if (writeFile(temporaryPath, contents.data(), contents.size()))
+    {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    else
+    {
+        logWarning("Couldn't write shader cache entry %s", path.string().c_str());
+    }
+}
+
+GLuint ShaderProgramCache::loadProgram(std::vector<ShaderStage> const &stages, std::string const &name)
+{
+    auto started = std::chrono::steady_clock::now();
+    bool cacheEnabled = !directory.empty() && programBinariesSupported();
+
+    std::filesystem::path path;
+    if (cacheEnabled)
+    {
+        path = entryPath(stages, name);
+        if (std::filesystem::exists(path))
+        {
+            GLuint program = loadBinary(path);
+            if (program != 0)
+            {
+                hitsCount++;
+                logInfo(
+                    "Loaded program %s from the shader cache in %.2f ms",
+                    name.c_str(),
+                    millisecondsSince(started)
+                );
+                return program;
+            }
+
+            rejectedCount++;
+            logWarning("Cached binary of program %s was rejected, compiling it from sources", name.c_str());
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    GLuint program = linkShaderProgram(stages, name, cacheEnabled);
+    if (program == 0) { return 0; }
+
+    missesCount++;
+    logInfo("Compiled program %s in %.2f ms", name.c_str(), millisecondsSince(started));
+    if (cacheEnabled) { storeBinary(program, path); }
+    return program;
+}
+
+bool ShaderWatcher::start(
+    GLFWwindow *sharedWith,
+    std::vector<WatchedStage> const &watchedStages,
+    std::string const &programName,
+    ShaderProgramCache *programCache
+)
+{
+    stages = watchedStages;
+    name = programName;
+    cache = programCache;
+
+    // invisible window just for the context, it shares objects with the main one
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    contextWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, sharedWith);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (contextWindow == NULL)
+    {
+        logError("Couldn't create a shared context for compiling shaders");
+        return false;
+    }
+
+    running = true;
+    watcherThread = std::thread(&ShaderWatcher::watch, this);
+    return true;
+}
+
+void ShaderWatcher::stop()
+{
+    if (!running) { return; }
+
+    running = false;
+    watcherThread.join();
+    glfwDestroyWindow(contextWindow);
+    contextWindow = NULL;
+
+    std::lock_guard<std::mutex> lock(reloadedMutex);
+    if (reloadedProgram != 0)
+    {
+        glDeleteProgram(reloadedProgram);
+        reloadedProgram = 0;
+    }
+}
+
+GLuint ShaderWatcher::takeReloadedProgram()
+{
+    std::lock_guard<std::mutex> lock(reloadedMutex);
+    GLuint program = reloadedProgram;
+    reloadedProgram = 0;
+    return program;
+}
+
+void ShaderWatcher::watch()
+{
+    glfwMakeContextCurrent(contextWindow);
+
+    std::vector<std::filesystem::file_time_type> modified(stages.size());
+    for (size_t s = 0; s < stages.size(); s++)
+    {
+        std::error_code error;
+        modified[s] = std::filesystem::last_write_time(stages[s].path, error);
+    }
+
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+        bool changed = false;
+        for (size_t s = 0; s < stages.size(); s++)
+        {
+            std::error_code error;
+            auto writeTime = std::filesystem::last_write_time(stages[s].path, error);
+            if (!error && writeTime != modified[s])
+            {
+                modified[s] = writeTime;
+                changed = true;
+            }
+        }
+        if (!changed) { continue; }
+
+        std::vector<ShaderStage> sources;
+        bool loaded = true;
+        for (auto const &stage : stages)
+        {
+            std::string source;
+            if (!readFile(stage.path, source))
+            {
+                logError("Couldn't read shader %s", stage.path.string().c_str());
+                loaded = false;
+                break;
+            }
+            sources.push_back({ stage.type, source });
+        }
+        if (!loaded) { continue; }
+
+        logInfo("Shader files of program %s changed, recompiling it", name.c_str());
+        GLuint program = cache != NULL
+            ? cache->loadProgram(sources, name)
+            : compileShaderProgram(sources, name);
+        // on errors the old program just stays in use
+        if (program == 0) { continue; }
+
+        // the program has to be complete before the main context starts using it
+        glFinish();
+        {
+            std::lock_guard<std::mutex> lock(reloadedMutex);
+            if (reloadedProgram != 0) { glDeleteProgram(reloadedProgram); }
+            reloadedProgram = program;
+        }
+        // wakes up the main loop if it's waiting for events in power saving mode
+        glfwPostEmptyEvent();
+    }
+
+    glfwMakeContextCurrent(NULL);
+}
+
+bool loadShaderFiles(
+    std::vector<ShaderWatcher::WatchedStage> const &files,
+    std::vector<ShaderStage> const &defaults,
+    std::vector<ShaderStage> &stages
+)
+{
+    stages.clear();
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        std::filesystem::path const &path = files[f].path;
+        std::error_code error;
+        if (!std::filesystem::exists(path, error) && f < defaults.size())
+        {
+            std::filesystem::create_directories(path.parent_path(), error);
+            std::string const &source = defaults[f].source;
+            if (writeFile(path, source.data(), source.size()))
+            {
+                logInfo("Wrote default shader to %s", path.string().c_str());
+            }
+        }
+
+        std::string source;
+        if (!readFile(path, source))
+        {
+            logError("Couldn't read shader %s", path.string().c_str());
+            return false;
+        }
+        stages.push_back({ files[f].type, source });
+    }
+    return true;
+}
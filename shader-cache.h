@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+struct ShaderStage
+{
+    GLenum type;
+    std::string source;
+};
+
+// compiles and links the stages, prints complete info logs on errors, returns 0 on failure
+GLuint compileShaderProgram(std::vector<ShaderStage> const &stages, std::string const &name);
+
+// Caches linked programs on disk with glGetProgramBinary(). The key is a hash
+// of the sources together with GL_VENDOR/GL_RENDERER/GL_VERSION, so a driver
+// update simply misses the cache. If the driver rejects a cached binary anyway,
+// the program is compiled from the sources and the cache entry is replaced
+class ShaderProgramCache
+{
+public:
+    // empty directory disables the cache
+    void setDirectory(std::filesystem::path const &cacheDirectory);
+    GLuint loadProgram(std::vector<ShaderStage> const &stages, std::string const &name);
+
+    int hits() const { return hitsCount; }
+    int misses() const { return missesCount; }
+    int rejected() const { return rejectedCount; }
+
+private:
+    std::filesystem::path directory;
+    std::atomic<int> hitsCount{0},
+                     missesCount{0},
+                     rejectedCount{0};
+
+    std::filesystem::path entryPath(std::vector<ShaderStage> const &stages, std::string const &name) const;
+    GLuint loadBinary(std::filesystem::path const &path);
+    void storeBinary(GLuint program, std::filesystem::path const &path);
+};
+
+// Watches shader files and recompiles the program when any of them changes.
+// Compilation happens on a background thread with its own GL context
+// (shared with the main one), so the rendering loop only has to swap
+// the program name once it's ready, and there is no frame hitch
+class ShaderWatcher
+{
+public:
+    struct WatchedStage
+    {
+        GLenum type;
+        std::filesystem::path path;
+    };
+
+    // has to be called from the main thread (GLFW creates windows only there),
+    // sharedWith is the window with the main context
+    bool start(
+        GLFWwindow *sharedWith,
+        std::vector<WatchedStage> const &watchedStages,
+        std::string const &programName,
+        ShaderProgramCache *programCache
+    );
+    void stop();
+
+    // returns a new program if there is one (the caller owns it), or 0
+    GLuint takeReloadedProgram();
+
+private:
+    GLFWwindow *contextWindow = NULL;
+    std::vector<WatchedStage> stages;
+    std::string name;
+    ShaderProgramCache *cache = NULL;
+    std::thread watcherThread;
+    std::atomic<bool> running{false};
+    std::mutex reloadedMutex;
+    GLuint reloadedProgram = 0;
+
+    void watch();
+};
+
+// reads the stages from the files, writing default sources to missing files first,
+// so there is something to edit
+bool loadShaderFiles(
+    std::vector<ShaderWatcher::WatchedStage> const &files,
+    std::vector<ShaderStage> const &defaults,
+    std::vector<ShaderStage> &stages
+);
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "startup.h"
+#include "logger.h"
+
+StartupPipeline::StartupPipeline()
+{
+    started = std::chrono::steady_clock::now();
+}
+
+StartupPipeline::~StartupPipeline()
+{
+    joinWorkers();
+}
+
+void StartupPipeline::joinWorkers()
+{
+    for (auto &worker : workers)
+    {
+        if (worker.second.joinable()) { worker.second.join(); }
+    }
+}
+
+double StartupPipeline::millisecondsSinceStart() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+void StartupPipeline::addStage(Stage const &stage)
+{
+    std::lock_guard<std::mutex> lock(stagesMutex);
+    stages.push_back(stage);
+}
+
+bool StartupPipeline::run(std::string const &name, std::function<bool()> const &stage)
+{
+    double stageStarted = millisecondsSinceStart();
+    bool result = stage();
+    addStage({ name, false, false, stageStarted, millisecondsSinceStart() - stageStarted });
+    return result;
+}
+
+void StartupPipeline::runAsync(std::string const &name, std::function<bool()> stage)
+{
+    results[name] = false;
+    // the map entry is created before the thread starts, so the thread can write into it
+    bool *result = &results[name];
+    workers[name] = std::thread(
+        [this, name, stage, result]()
+        {
+            double stageStarted = millisecondsSinceStart();
+            *result = stage();
+            addStage({ name, true, false, stageStarted, millisecondsSinceStart() - stageStarted });
+        }
+    );
+}
+
+bool StartupPipeline::wait(std::string const &name)
+{
+    auto worker = workers.find(name);
+    if (worker == workers.end()) { return false; }
+
+    // only the time the main thread was actually blocked
+    double waitStarted = millisecondsSinceStart();
+    if (worker->second.joinable()) { worker->second.join(); }
+    addStage({ name, false, true, waitStarted, millisecondsSinceStart() - waitStarted });
+    return results[name];
+}
+
+void StartupPipeline::firstFrame()
+{
+    if (!firstFrameReached()) { firstFrameMilliseconds = millisecondsSinceStart(); }
+}
+
+void StartupPipeline::printReport()
+{
+    std::vector<Stage> sortedStages;
+    {
+        std::lock_guard<std::mutex> lock(stagesMutex);
+        sortedStages = stages;
+    }
+    std::sort(
+        sortedStages.begin(),
+        sortedStages.end(),
+        [](Stage const &a, Stage const &b) { return a.startMilliseconds < b.startMilliseconds; }
+    );
+
+    double workMilliseconds = 0.0;
+    logInfo("Startup report (milliseconds since start):");
+    logInfo("    %-28s %-8s %10s %10s", "stage", "thread", "start", "duration");
+    for (auto const &stage : sortedStages)
+    {
+        std::string name = stage.waiting ? "waiting for " + stage.name : stage.name;
+        logInfo(
+            "    %-28s %-8s %10.2f %10.2f",
+            name.c_str(),
+            stage.onWorker ? "worker" : "main",
+            stage.startMilliseconds,
+            stage.durationMilliseconds
+        );
+        if (!stage.waiting) { workMilliseconds += stage.durationMilliseconds; }
+    }
+    // if stages overlap, the sum of their durations is bigger than the time it all took
+    logInfo("    stages took %.2f ms in total, time to first frame: %.2f ms", workMilliseconds, firstFrameMilliseconds);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+// Startup stages with their dependencies: CPU-only stages (file I/O, font atlas
+// baking, generating scene data) run on worker threads, while the main thread
+// creates the window and the context, and then waits for a worker stage
+// only right before it needs its results (GL uploads stay on the main thread)
+class StartupPipeline
+{
+public:
+    StartupPipeline();
+    // joins workers that were never waited for
+    ~StartupPipeline();
+
+    // runs the stage on the calling thread, returns its result
+    bool run(std::string const &name, std::function<bool()> const &stage);
+    // runs the stage on a worker thread
+    void runAsync(std::string const &name, std::function<bool()> stage);
+    // blocks until the worker stage finishes, returns its result
+    bool wait(std::string const &name);
+    // blocks until every worker finishes, before failing startup
+    // destroys whatever the workers are writing into
+    void joinWorkers();
+
+    // the first frame is the end of startup
+    void firstFrame();
+    bool firstFrameReached() const { return firstFrameMilliseconds > 0.0; }
+    double timeToFirstFrame() const { return firstFrameMilliseconds; }
+
+    // per-stage wall time and time to the first frame
+    void printReport();
+
+private:
+    struct Stage
+    {
+        std::string name;
+        bool onWorker;
+        bool waiting;
+        double startMilliseconds;
+        double durationMilliseconds;
+    };
+
+    std::chrono::steady_clock::time_point started;
+    double firstFrameMilliseconds = 0.0;
+    std::mutex stagesMutex;
+    std::vector<Stage> stages;
+    std::map<std::string, std::thread> workers;
+    std::map<std::string, bool> results;
+
+    double millisecondsSinceStart() const;
+    void addStage(Stage const &stage);
+};
@@ -0,0 +1,31 @@
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "statistics.h"
+
+double percentile(std::vector<double> const &sortedValues, double p)
+{
+    if (sortedValues.empty()) { return 0.0; }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sortedValues.size()));
+    if (rank > 0) { rank--; }
+    return sortedValues[std::min(rank, sortedValues.size() - 1)];
+}
+
+TimingStatistics calculateTimingStatistics(std::vector<double> values)
+{
+    TimingStatistics statistics;
+    if (values.empty()) { return statistics; }
+
+    std::sort(values.begin(), values.end());
+    double total = std::accumulate(values.begin(), values.end(), 0.0);
+
+    statistics.count = values.size();
+    statistics.total = total;
+    statistics.min = values.front();
+    statistics.median = percentile(values, 50.0);
+    statistics.p99 = percentile(values, 99.0);
+    statistics.max = values.back();
+    statistics.mean = total / values.size();
+    return statistics;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// in the same units as the measured values
+struct TimingStatistics
+{
+    size_t count = 0;
+    double total = 0.0;
+    double min = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+};
+
+// nearest-rank percentile, p is in [0, 100], values have to be sorted
+double percentile(std::vector<double> const &sortedValues, double p);
+
+TimingStatistics calculateTimingStatistics(std::vector<double> values);
@@ -0,0 +1,152 @@
+#include <chrono>
+
+#include "stream-buffer.h"
+#include "logger.h"
+
+bool StreamBuffer::initialize(GLenum bufferTarget, size_t initialPartitionSize, bool persistent)
+{
+    target = bufferTarget;
+    persistentMapping = persistent && (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage);
+    glGenBuffers(1, &bufferName);
+    allocate(initialPartitionSize);
+    return bufferName != 0;
+}
+
+void StreamBuffer::shutdown()
+{
+    for (GLsync &partitionFence : fences)
+    {
+        if (partitionFence != NULL) { glDeleteSync(partitionFence); }
+        partitionFence = NULL;
+    }
+    // deleting the buffer unmaps it
+    persistentPointer = NULL;
+    if (bufferName != 0) { glDeleteBuffers(1, &bufferName); }
+    bufferName = 0;
+}
+
+void StreamBuffer::allocate(size_t newPartitionSize)
+{
+    // the old storage is orphaned: GPU keeps reading it for the frames in flight,
+    // so the fences of the old partitions don't matter anymore
+    for (GLsync &partitionFence : fences)
+    {
+        if (partitionFence != NULL) { glDeleteSync(partitionFence); }
+        partitionFence = NULL;
+    }
+    partitionSize = newPartitionSize;
+    currentPartition = 0;
+    if (persistentMapping)
+    {
+        // immutable storage can't be reallocated, so it is a new buffer,
+        // and the old one is deleted once GPU is done with it
+        if (persistentPointer != NULL)
+        {
+            glDeleteBuffers(1, &bufferName);
+            glGenBuffers(1, &bufferName);
+        }
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBindBuffer(target, bufferName);
+        glBufferStorage(target, partitionSize * partitionsCount, NULL, flags);
+        persistentPointer = static_cast<unsigned char *>(
+            glMapBufferRange(target, 0, partitionSize * partitionsCount, flags)
+        );
+        glBindBuffer(target, 0);
+        if (persistentPointer != NULL) { return; }
+
+        logWarning("Couldn't map stream buffer persistently, mapping it every frame instead");
+        persistentMapping = false;
+        glDeleteBuffers(1, &bufferName);
+        glGenBuffers(1, &bufferName);
+    }
+    glBindBuffer(target, bufferName);
+    glBufferData(target, partitionSize * partitionsCount, NULL, GL_STREAM_DRAW);
+    glBindBuffer(target, 0);
+}
+
+void StreamBuffer::waitForFence(int partition)
+{
+    GLsync &partitionFence = fences[partition];
+    if (partitionFence == NULL) { return; }
+
+    // first just check, without waiting
+    GLenum result = glClientWaitSync(partitionFence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        fenceWaitsCount++;
+        auto waitStart = std::chrono::steady_clock::now();
+        // one second is more than enough, anything longer means the GPU is lost
+        const GLuint64 timeout = 1000000000;
+        do
+        {
+            result = glClientWaitSync(partitionFence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        }
+        while (result == GL_TIMEOUT_EXPIRED);
+        fenceWaitTime += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - waitStart
+        ).count();
+    }
+    if (result == GL_WAIT_FAILED)
+    {
+        logError("Waiting for a stream buffer fence failed");
+    }
+
+    glDeleteSync(partitionFence);
+    partitionFence = NULL;
+}
+
+void *StreamBuffer::beginWrite(size_t size)
+{
+    if (size > partitionSize)
+    {
+        size_t newPartitionSize = partitionSize;
+        while (newPartitionSize < size) { newPartitionSize *= 2; }
+        allocate(newPartitionSize);
+    }
+    else
+    {
+        currentPartition = (currentPartition + 1) % partitionsCount;
+    }
+
+    waitForFence(currentPartition);
+    // coherent mapping, so there is nothing else to do
+    if (persistentPointer != NULL) { return persistentPointer + offset(); }
+
+    glBindBuffer(target, bufferName);
+    void *pointer = glMapBufferRange(
+        target,
+        offset(),
+        size,
+        GL_MAP_WRITE_BIT
+            | GL_MAP_UNSYNCHRONIZED_BIT
+            | GL_MAP_INVALIDATE_RANGE_BIT
+            | GL_MAP_FLUSH_EXPLICIT_BIT
+    );
+    glBindBuffer(target, 0);
+    return pointer;
+}
+
+void StreamBuffer::endWrite(size_t bytesWritten)
+{
+    if (persistentPointer != NULL)
+    {
+        writesCount++;
+        return;
+    }
+
+    glBindBuffer(target, bufferName);
+    if (bytesWritten > 0)
+    {
+        glFlushMappedBufferRange(target, 0, bytesWritten);
+    }
+    glUnmapBuffer(target);
+    glBindBuffer(target, 0);
+    writesCount++;
+}
+
+void StreamBuffer::fence()
+{
+    GLsync &partitionFence = fences[currentPartition];
+    if (partitionFence != NULL) { glDeleteSync(partitionFence); }
+    partitionFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Ring buffer for data that changes every frame. The buffer is split into
+// partitions, every frame writes into the next one through an unsynchronized
+// mapping (so the driver neither copies nor waits), and a fence placed after
+// the draw calls that read the partition tells when it can be written again.
+// With 3 partitions CPU only has to wait if GPU is more than 2 frames behind.
+// Persistent buffers (GL 4.4 or ARB_buffer_storage) are mapped only once,
+// so writing a frame doesn't make any GL calls at all
+class StreamBuffer
+{
+public:
+    static const int partitionsCount = 3;
+
+    // falls back to mapping every frame if persistent mapping is not supported
+    bool initialize(GLenum target, size_t partitionSize, bool persistent = false);
+    void shutdown();
+
+    // maps the next partition (waiting for its fence if GPU still reads it)
+    // and returns a pointer to write to, the partition grows if size doesn't fit
+    void *beginWrite(size_t size);
+    // unmaps the partition, data is ready to be used by draw calls
+    void endWrite(size_t bytesWritten);
+    // to be called after the last draw call that uses the current partition
+    void fence();
+
+    GLuint buffer() const { return bufferName; }
+    bool persistentlyMapped() const { return persistentPointer != NULL; }
+    // offset of the current partition in bytes
+    size_t offset() const { return currentPartition * partitionSize; }
+
+    uint64_t writes() const { return writesCount; }
+    // how many times CPU had to wait because GPU was still using a partition
+    uint64_t fenceWaits() const { return fenceWaitsCount; }
+    double fenceWaitMilliseconds() const { return fenceWaitTime; }
+
+private:
+    GLenum target = GL_ARRAY_BUFFER;
+    GLuint bufferName = 0;
+    size_t partitionSize = 0;
+    int currentPartition = 0;
+    GLsync fences[partitionsCount] = {};
+    bool persistentMapping = false;
+    // the whole buffer, when it is persistently mapped
+    unsigned char *persistentPointer = NULL;
+    uint64_t writesCount = 0;
+    uint64_t fenceWaitsCount = 0;
+    double fenceWaitTime = 0.0;
+
+    void allocate(size_t newPartitionSize);
+    void waitForFence(int partition);
+};
@@ -0,0 +1,235 @@
+// Tails the telemetry of a running application (started with --telemetry)
+// and prints percentiles of the recent frames every interval. Reading the
+// shared memory doesn't affect the application in any way, so it can be
+// polled as often as needed
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+
+#include "telemetry.h"
+#include "statistics.h"
+
+namespace
+{
+    struct ReaderOptions
+    {
+        std::string name = telemetryDefaultName;
+        // how often the percentiles are printed
+        int intervalMilliseconds = 1000;
+        // over how many of the last frames
+        size_t window = 600;
+        // exit after that many reports (not counting waiting for the application), 0 is never
+        int reports = 0;
+    };
+
+    // how often new records are picked up, well within the ring at any frame rate
+    const std::chrono::milliseconds pollInterval(5);
+
+    void printUsage(std::string const &executableName)
+    {
+        std::cout << "Usage: " << executableName << " [options]\n\n"
+                  << "  --name NAME        shared memory segment (default: " << telemetryDefaultName << ")\n"
+                  << "  --interval MS      print percentiles every MS milliseconds (default: 1000)\n"
+                  << "  --window N         percentiles of the last N frames (default: 600)\n"
+                  << "  --reports N        exit after N reports (default: 0, never; waiting doesn't count)\n"
+                  << "  -h, --help         show this help\n";
+    }
+
+    bool parsePositive(std::string const &value, long &result)
+    {
+        char *end = NULL;
+        long parsed = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || parsed < 0) { return false; }
+        result = parsed;
+        return true;
+    }
+
+    template<typename Field>
+    void printPercentiles(std::deque<TelemetryRecord> const &records, const char *label, Field field)
+    {
+        std::vector<double> values;
+        values.reserve(records.size());
+        for (TelemetryRecord const &record : records) { values.push_back(field(record)); }
+        // nearest-rank, the same as in the benchmarks
+        std::sort(values.begin(), values.end());
+        double median = percentile(values, 50.0),
+               p90 = percentile(values, 90.0),
+               p99 = percentile(values, 99.0),
+               max = percentile(values, 100.0);
+        std::cout << "  " << std::left << std::setw(24) << label << std::right
+                  << " p50 " << std::setw(9) << median
+                  << "  p90 " << std::setw(9) << p90
+                  << "  p99 " << std::setw(9) << p99
+                  << "  max " << std::setw(9) << max << "\n";
+    }
+
+    void printReport(std::deque<TelemetryRecord> const &records, TelemetryReader const &reader, uint64_t lost)
+    {
+        TelemetryRecord const &last = records.back();
+        std::cout << "Frame " << last.frameIndex
+                  << ": last " << records.size() << " frames, "
+                  << last.renderedFrames << " rendered, "
+                  << last.skippedFrames << " skipped, "
+                  << lost << " lost by the reader\n";
+        printPercentiles(records, "frame, ms", [](TelemetryRecord const &r) { return r.frameMilliseconds; });
+        // zeros of frames without phase times would pull the percentiles down
+        std::deque<TelemetryRecord> cpuProfiled, gpuProfiled;
+        for (TelemetryRecord const &record : records)
+        {
+            if (record.cpuPhasesValid != 0) { cpuProfiled.push_back(record); }
+            if (record.gpuPhasesValid != 0) { gpuProfiled.push_back(record); }
+        }
+        if (cpuProfiled.empty() && gpuProfiled.empty())
+        {
+            std::cout << "  no phase times, the profiler is disabled (it always is in pipelined mode)\n";
+        }
+        for (int p = 0; p < reader.phasesCount(); p++)
+        {
+            std::string name = reader.phaseName(p);
+            if (!cpuProfiled.empty())
+            {
+                printPercentiles(cpuProfiled, (name + ", CPU ms").c_str(), [p](TelemetryRecord const &r) { return r.cpuPhaseMilliseconds[p]; });
+            }
+            if (!gpuProfiled.empty())
+            {
+                printPercentiles(gpuProfiled, (name + ", GPU ms").c_str(), [p](TelemetryRecord const &r) { return r.gpuPhaseMilliseconds[p]; });
+            }
+        }
+        printPercentiles(records, "allocations", [](TelemetryRecord const &r) { return static_cast<double>(r.allocations); });
+        printPercentiles(records, "allocated, KB", [](TelemetryRecord const &r) { return r.allocatedBytes / 1024.0; });
+        printPercentiles(records, "scene draw calls", [](TelemetryRecord const &r) { return static_cast<double>(r.sceneDrawCalls); });
+        printPercentiles(records, "scene triangles", [](TelemetryRecord const &r) { return static_cast<double>(r.sceneTriangles); });
+        printPercentiles(records, "Dear ImGui draw calls", [](TelemetryRecord const &r) { return static_cast<double>(r.imguiDrawCalls); });
+        printPercentiles(records, "Dear ImGui vertices", [](TelemetryRecord const &r) { return static_cast<double>(r.imguiVertices); });
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ReaderOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        std::string value = hasValue ? argv[i + 1] : "";
+        long number = 0;
+
+        if (argument == "-h" || argument == "--help")
+        {
+            printUsage(argv[0]);
+            return EXIT_SUCCESS;
+        }
+        else if (argument == "--name" && hasValue)
+        {
+            options.name = value;
+            i++;
+        }
+        else if (argument == "--interval" && hasValue && parsePositive(value, number) && number > 0)
+        {
+            options.intervalMilliseconds = static_cast<int>(number);
+            i++;
+        }
+        else if (argument == "--window" && hasValue && parsePositive(value, number) && number > 0)
+        {
+            options.window = static_cast<size_t>(number);
+            i++;
+        }
+        else if (argument == "--reports" && hasValue && parsePositive(value, number))
+        {
+            options.reports = static_cast<int>(number);
+            i++;
+        }
+        else
+        {
+            std::cerr << "[ERROR] Unknown or incomplete argument: " << argument << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto reader = std::make_unique<TelemetryReader>();
+    std::deque<TelemetryRecord> records;
+    uint64_t nextIndex = 0;
+    uint64_t lost = 0;
+    int reportsPrinted = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+    auto lastRecord = lastReport;
+    std::cout << std::fixed << std::setprecision(3);
+
+    while (options.reports == 0 || reportsPrinted < options.reports)
+    {
+        // the application creates a new segment every run, so when nothing is published
+        // for a while, that may be a new run (or just a window that waits for events)
+        auto now = std::chrono::steady_clock::now();
+        bool stale = now - lastRecord > std::chrono::milliseconds(options.intervalMilliseconds * 2);
+        if (!reader->isOpen() || stale)
+        {
+            auto candidate = std::make_unique<TelemetryReader>();
+            bool sameSegment = reader->isOpen() && candidate->open(options.name)
+                && candidate->published() == reader->published();
+            if (!sameSegment && candidate->isOpen())
+            {
+                reader = std::move(candidate);
+                // only the records from now on, the older ones may be from long ago
+                nextIndex = reader->published();
+                records.clear();
+                lost = 0;
+            }
+            else if (!reader->isOpen() && candidate->open(options.name))
+            {
+                reader = std::move(candidate);
+                nextIndex = reader->published();
+            }
+            lastRecord = now;
+        }
+
+        uint64_t fresh = 0;
+        if (reader->isOpen())
+        {
+            uint64_t published = reader->published();
+            // the writer is a whole ring ahead, what it has overwritten is lost
+            if (published - nextIndex > reader->capacity())
+            {
+                lost += published - nextIndex - reader->capacity();
+                nextIndex = published - reader->capacity();
+            }
+            for (; nextIndex < published; nextIndex++)
+            {
+                TelemetryRecord record;
+                if (!reader->read(nextIndex, record))
+                {
+                    lost++;
+                    continue;
+                }
+                records.push_back(record);
+                if (records.size() > options.window) { records.pop_front(); }
+                fresh++;
+            }
+        }
+        if (fresh > 0) { lastRecord = now; }
+
+        if (now - lastReport >= std::chrono::milliseconds(options.intervalMilliseconds))
+        {
+            lastReport = now;
+            if (records.empty()) { std::cout << "Waiting for " << options.name << "..." << std::endl; }
+            else
+            {
+                printReport(records, *reader, lost);
+                reportsPrinted++;
+            }
+        }
+
+        std::this_thread::sleep_for(pollInterval);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "telemetry.h"
+
+namespace
+{
+    uint64_t steadyMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    size_t segmentSize(uint32_t capacity)
+    {
+        return sizeof(TelemetryHeader) + sizeof(TelemetrySlot) * capacity;
+    }
+
+#ifdef _WIN32
+    // named file mappings don't have the leading slash of POSIX names
+    std::wstring mappingName(std::string const &name)
+    {
+        std::string local = "Local\\" + (name.empty() || name[0] != '/' ? name : name.substr(1));
+        return std::wstring(local.begin(), local.end());
+    }
+#endif
+}
+
+TelemetryWriter::~TelemetryWriter()
+{
+    close();
+}
+
+bool TelemetryWriter::open(std::string const &name, uint32_t capacity, const char *const phaseNames[], int phasesCount)
+{
+    close();
+    if (capacity == 0) { return false; }
+    size_t size = segmentSize(capacity);
+
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingW(
+        INVALID_HANDLE_VALUE,
+        NULL,
+        PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+        static_cast<DWORD>(size & 0xFFFFFFFF),
+        mappingName(name).c_str()
+    );
+    if (mapping == NULL) { return false; }
+    void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == NULL)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    // a mapping that a reader still has open keeps the contents of the previous run
+    std::memset(view, 0, size);
+    mappingHandle = mapping;
+#else
+    // readers of the previous run keep the old segment,
+    // and they'll notice that nothing is published there anymore
+    shm_unlink(name.c_str());
+    int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (file < 0) { return false; }
+    if (ftruncate(file, static_cast<off_t>(size)) != 0)
+    {
+        ::close(file);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+
+    segmentName = name;
+    mappedSize = size;
+    header = static_cast<TelemetryHeader *>(view);
+    slots = reinterpret_cast<TelemetrySlot *>(static_cast<unsigned char *>(view) + sizeof(TelemetryHeader));
+    header->version = telemetryVersion;
+    header->recordSize = sizeof(TelemetryRecord);
+    header->capacity = capacity;
+    header->phasesCount = static_cast<uint32_t>(std::min(phasesCount, telemetryPhasesMax));
+    for (uint32_t p = 0; p < header->phasesCount; p++)
+    {
+        std::strncpy(header->phaseNames[p], phaseNames[p], telemetryPhaseNameLength - 1);
+    }
+    header->published.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < capacity; i++) { slots[i].sequence.store(0, std::memory_order_relaxed); }
+    header->magic.store(telemetryMagic, std::memory_order_release);
+    openedMicroseconds = steadyMicroseconds();
+    return true;
+}
+
+void TelemetryWriter::close()
+{
+    if (header == NULL) { return; }
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle(mappingHandle);
+    mappingHandle = NULL;
+#else
+    munmap(header, mappedSize);
+    shm_unlink(segmentName.c_str());
+#endif
+    header = NULL;
+    slots = NULL;
+    mappedSize = 0;
+}
+
+uint64_t TelemetryWriter::microsecondsSinceOpen() const
+{
+    return steadyMicroseconds() - openedMicroseconds;
+}
+
+void TelemetryWriter::publish(TelemetryRecord const &record)
+{
+    if (header == NULL) { return; }
+
+    uint64_t index = header->published.load(std::memory_order_relaxed);
+    TelemetrySlot &slot = slots[index % header->capacity];
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    // odd: readers that copy the record now will discard it
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.record, &record, sizeof(TelemetryRecord));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    header->published.store(index + 1, std::memory_order_release);
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    close();
+}
+
+bool TelemetryReader::open(std::string const &name)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, mappingName(name).c_str());
+    if (mapping == NULL) { return false; }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION information;
+    if (view == NULL || VirtualQuery(view, &information, sizeof(information)) == 0)
+    {
+        if (view != NULL) { UnmapViewOfFile(view); }
+        CloseHandle(mapping);
+        return false;
+    }
+    size_t size = information.RegionSize;
+    mappingHandle = mapping;
+#else
+    int file = shm_open(name.c_str(), O_RDONLY, 0);
+    if (file < 0) { return false; }
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0 || static_cast<size_t>(fileStatus.st_size) < sizeof(TelemetryHeader))
+    {
+        ::close(file);
+        return false;
+    }
+    size_t size = static_cast<size_t>(fileStatus.st_size);
+    void *view = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED) { return false; }
+#endif
+
+    header = static_cast<const TelemetryHeader *>(view);
+    slots = reinterpret_cast<const TelemetrySlot *>(static_cast<const unsigned char *>(view) + sizeof(TelemetryHeader));
+    mappedSize = size;
+    bool valid = size >= sizeof(TelemetryHeader)
+        && header->magic.load(std::memory_order_acquire) == telemetryMagic
+        && header->version == telemetryVersion
+        && header->recordSize == sizeof(TelemetryRecord)
+        && header->capacity > 0
+        && size >= segmentSize(header->capacity)
+        && header->phasesCount <= static_cast<uint32_t>(telemetryPhasesMax);
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryReader::close()
+{
+    if (header == NULL) { return; }
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle(mappingHandle);
+    mappingHandle = NULL;
+#else
+    munmap(const_cast<TelemetryHeader *>(header), mappedSize);
+#endif
+    header = NULL;
+    slots = NULL;
+    mappedSize = 0;
+}
+
+bool TelemetryReader::read(uint64_t index, TelemetryRecord &record) const
+{
+    if (index >= published() || published() - index > header->capacity) { return false; }
+
+    const TelemetrySlot &slot = slots[index % header->capacity];
+    // every lap over the ring adds 2 to the sequence, so the record of that index
+    // is there only if the sequence is exactly what the writer left after it
+    uint64_t expected = (index / header->capacity + 1) * 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) { return false; }
+    std::memcpy(&record, &slot.record, sizeof(TelemetryRecord));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
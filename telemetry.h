@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+
+const uint32_t telemetryMagic = 0x4D4C4554; // "TELM"
+const uint32_t telemetryVersion = 2;
+const int telemetryPhasesMax = 8;
+const size_t telemetryPhaseNameLength = 24;
+// about 10 seconds at 100 FPS
+const uint32_t telemetryDefaultCapacity = 1024;
+const char *const telemetryDefaultName = "/glfw-imgui-telemetry";
+
+// One frame, only fixed size fields, so other tools (in any language)
+// can read it right from the shared memory
+struct TelemetryRecord
+{
+    uint64_t frameIndex = 0;
+    // since the segment was created
+    uint64_t timestampMicroseconds = 0;
+    // from the end of the previous frame to the end of this one, including waiting
+    double frameMilliseconds = 0.0;
+    // CPU times of the phases of this frame, GPU times are known only
+    // a few frames later, so they are of gpuFrameIndex
+    double cpuPhaseMilliseconds[telemetryPhasesMax] = {};
+    double gpuPhaseMilliseconds[telemetryPhasesMax] = {};
+    uint64_t gpuFrameIndex = 0;
+    // 0 if the times above are missing (the profiler is disabled, as in pipelined mode,
+    // or GPU times aren't resolved yet), they are zeros then, not zero durations
+    uint64_t cpuPhasesValid = 0;
+    uint64_t gpuPhasesValid = 0;
+    // 0 if the frame was skipped by power saving (the counters below are totals)
+    uint64_t rendered = 0;
+    uint64_t renderedFrames = 0;
+    uint64_t skippedFrames = 0;
+    // heap allocations of the UI thread during the frame
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t imguiAllocations = 0;
+    uint64_t sceneDrawCalls = 0;
+    uint64_t sceneTriangles = 0;
+    uint64_t imguiDrawCalls = 0;
+    uint64_t imguiVertices = 0;
+};
+
+// The start of the segment, followed by capacity slots
+struct TelemetryHeader
+{
+    // written last, so a reader never sees a half initialized segment
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint32_t phasesCount;
+    uint32_t reserved;
+    char phaseNames[telemetryPhasesMax][telemetryPhaseNameLength];
+    // records published so far, the last one is in the slot (published - 1) % capacity
+    alignas(64) std::atomic<uint64_t> published;
+};
+
+// A seqlock per slot: the sequence is odd while the record is being written,
+// so a reader copies the record and only keeps it if the sequence was even
+// and hasn't changed meanwhile (otherwise the writer has lapped it)
+struct alignas(64) TelemetrySlot
+{
+    std::atomic<uint64_t> sequence;
+    TelemetryRecord record;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry needs lock-free 64-bit atomics");
+
+// Publishes a record per frame into a named shared memory segment
+// (shm_open or a named file mapping). Creating the segment makes syscalls,
+// publishing is only a few stores into the mapping, without any locks,
+// so it doesn't disturb the frame loop
+class TelemetryWriter
+{
+public:
+    TelemetryWriter() = default;
+    ~TelemetryWriter();
+    TelemetryWriter(TelemetryWriter const &) = delete;
+    TelemetryWriter &operator=(TelemetryWriter const &) = delete;
+
+    // replaces a segment left by a previous run
+    bool open(std::string const &name, uint32_t capacity, const char *const phaseNames[], int phasesCount);
+    // removes the segment, readers that have it mapped keep their mapping
+    void close();
+    bool isOpen() const { return header != NULL; }
+
+    // one thread only
+    void publish(TelemetryRecord const &record);
+    uint64_t microsecondsSinceOpen() const;
+
+private:
+    std::string segmentName;
+    TelemetryHeader *header = NULL;
+    TelemetrySlot *slots = NULL;
+    size_t mappedSize = 0;
+    uint64_t openedMicroseconds = 0;
+#ifdef _WIN32
+    void *mappingHandle = NULL;
+#endif
+};
+
+// Reads the records from another process, never blocks the writer
+class TelemetryReader
+{
+public:
+    TelemetryReader() = default;
+    ~TelemetryReader();
+    TelemetryReader(TelemetryReader const &) = delete;
+    TelemetryReader &operator=(TelemetryReader const &) = delete;
+
+    // fails if there is no such segment or it has a different layout
+    bool open(std::string const &name);
+    void close();
+    bool isOpen() const { return header != NULL; }
+
+    uint64_t published() const { return header->published.load(std::memory_order_acquire); }
+    uint32_t capacity() const { return header->capacity; }
+    int phasesCount() const { return static_cast<int>(header->phasesCount); }
+    const char *phaseName(int phase) const { return header->phaseNames[phase]; }
+
+    // false if the record has already been overwritten (or is being written)
+    bool read(uint64_t index, TelemetryRecord &record) const;
+
+private:
+    const TelemetryHeader *header = NULL;
+    const TelemetrySlot *slots = NULL;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void *mappingHandle = NULL;
+#endif
+};
@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cstring>
+
+#include "texture-streamer.h"
+#include "logger.h"
+
+namespace
+{
+    // enough for the requests of a few frames without waiting for update()
+    const size_t spareTexturesCount = 16;
+
+    const unsigned char placeholderColor[4] = { 96, 96, 96, 255 };
+    const unsigned char failedColor[4] = { 255, 0, 255, 255 };
+
+    ImTextureID textureID(GLuint texture)
+    {
+        return (ImTextureID)(intptr_t)texture;
+    }
+
+    void setPixel(GLuint texture, const unsigned char color[4])
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, color);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+
+    // the smallest level of the full mip chain is 1x1
+    int lastMipLevel(int width, int height)
+    {
+        int level = 0;
+        for (int size = std::max(width, height); size > 1; size /= 2) { level++; }
+        return level;
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // GL objects can't be deleted here anymore, but the threads have to be stopped
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    lock.unlock();
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+}
+
+bool TextureStreamer::initialize(TextureStreamerSettings const &streamerSettings)
+{
+    settings = streamerSettings;
+    placeholder = createPlaceholderTexture();
+    if (!pixelBuffers.initialize(GL_PIXEL_UNPACK_BUFFER, settings.pixelBufferSize, true))
+    {
+        logError("Couldn't create pixel buffers for texture streaming");
+        shutdown();
+        return false;
+    }
+    for (size_t i = 0; i < spareTexturesCount; i++) { spareTextures.push_back(createPlaceholderTexture()); }
+
+    int workersCount = settings.workers;
+    if (workersCount <= 0) { workersCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2); }
+    stopping = false;
+    for (int i = 0; i < workersCount; i++) { workers.emplace_back(&TextureStreamer::workerLoop, this); }
+    logInfo(
+        "Texture streaming: %d decoding threads, %zu MB budget, %zu MB uploads per frame%s",
+        workersCount,
+        settings.memoryBudget / (1024 * 1024),
+        settings.uploadBudget / (1024 * 1024),
+        pixelBuffers.persistentlyMapped() ? ", persistently mapped pixel buffers" : ""
+    );
+    return true;
+}
+
+void TextureStreamer::shutdown()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    lock.unlock();
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+    workers.clear();
+
+    for (auto &entry : entries)
+    {
+        if (entry.second->texture != 0) { glDeleteTextures(1, &entry.second->texture); }
+    }
+    if (!spareTextures.empty()) { glDeleteTextures(static_cast<GLsizei>(spareTextures.size()), spareTextures.data()); }
+    if (placeholder != 0) { glDeleteTextures(1, &placeholder); }
+    pixelBuffers.shutdown();
+
+    entries.clear();
+    decodeQueue.clear();
+    uploadQueue.clear();
+    spareTextures.clear();
+    waitingForTexture.clear();
+    placeholder = 0;
+    residentBytes = 0;
+}
+
+GLuint TextureStreamer::createPlaceholderTexture()
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    setPixel(texture, placeholderColor);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+ImTextureID TextureStreamer::texture(std::string const &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Entry> &slot = entries[path];
+    if (!slot)
+    {
+        slot.reset(new Entry());
+        slot->path = path;
+        if (!spareTextures.empty())
+        {
+            slot->texture = spareTextures.back();
+            spareTextures.pop_back();
+        }
+        else { waitingForTexture.push_back(slot.get()); }
+        decodeQueue.push_back(slot.get());
+        workAvailable.notify_one();
+    }
+    else if (slot->state == State::Evicted)
+    {
+        slot->state = State::Queued;
+        decodeQueue.push_back(slot.get());
+        workAvailable.notify_one();
+    }
+    slot->lastUsedFrame = frame.load(std::memory_order_relaxed);
+    return textureID(slot->texture != 0 ? slot->texture : placeholder);
+}
+
+bool TextureStreamer::imageSize(std::string const &path, int &width, int &height)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(path);
+    if (found == entries.end() || found->second->width == 0) { return false; }
+    width = found->second->width;
+    height = found->second->height;
+    return true;
+}
+
+void TextureStreamer::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        workAvailable.wait(lock, [this]() { return stopping || !decodeQueue.empty(); });
+        if (stopping) { return; }
+
+        Entry *entry = decodeQueue.front();
+        decodeQueue.pop_front();
+        entry->state = State::Decoding;
+        std::string path = entry->path;
+        lock.unlock();
+
+        DecodedImage image;
+        bool decoded = decodeImage(path, image);
+
+        lock.lock();
+        if (decoded)
+        {
+            entry->image = std::move(image);
+            entry->width = entry->image.width;
+            entry->height = entry->image.height;
+            entry->uploadedRows = 0;
+            entry->state = State::Decoded;
+        }
+        else { entry->state = State::Failed; }
+        // failed ones too, update() gives them the "failed" color
+        uploadQueue.push_back(entry);
+    }
+}
+
+void TextureStreamer::beginUpload(Entry &entry)
+{
+    // level 0 gets its storage now, but until all of it is uploaded
+    // only the last level with the placeholder color is visible
+    int last = lastMipLevel(entry.width, entry.height);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, entry.width, entry.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    if (last > 0)
+    {
+        glTexImage2D(GL_TEXTURE_2D, last, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderColor);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+    }
+    residentBytes += static_cast<size_t>(entry.width) * entry.height * 4;
+}
+
+size_t TextureStreamer::uploadRows(Entry &entry, size_t budget)
+{
+    size_t rowBytes = static_cast<size_t>(entry.width) * 4;
+    size_t rowsLeft = static_cast<size_t>(entry.height - entry.uploadedRows);
+    size_t rows = std::min(rowsLeft, std::max<size_t>(1, settings.pixelBufferSize / rowBytes));
+    rows = std::min(rows, std::max<size_t>(1, budget / rowBytes));
+    size_t bytes = rows * rowBytes;
+
+    // mapping can fail without persistent buffers, the rows are tried again next frame
+    void *destination = pixelBuffers.beginWrite(bytes);
+    if (destination == NULL) { return 0; }
+    std::memcpy(destination, entry.image.pixels.data() + entry.uploadedRows * rowBytes, bytes);
+    pixelBuffers.endWrite(bytes);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers.buffer());
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0,
+        0, entry.uploadedRows, entry.width, static_cast<GLsizei>(rows),
+        GL_RGBA, GL_UNSIGNED_BYTE,
+        (const void *)(uintptr_t)pixelBuffers.offset()
+    );
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // the partition can be written again once the copy from it is done
+    pixelBuffers.fence();
+
+    entry.uploadedRows += static_cast<int>(rows);
+    return bytes;
+}
+
+void TextureStreamer::evict(Entry &entry)
+{
+    // the name stays, so the ID that UI has is still valid
+    setPixel(entry.texture, placeholderColor);
+    residentBytes -= static_cast<size_t>(entry.width) * entry.height * 4;
+    entry.state = State::Evicted;
+    evictionsCount++;
+}
+
+void TextureStreamer::update()
+{
+    if (!initialized()) { return; }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (Entry *entry : waitingForTexture) { entry->texture = createPlaceholderTexture(); }
+    waitingForTexture.clear();
+    while (spareTextures.size() < spareTexturesCount) { spareTextures.push_back(createPlaceholderTexture()); }
+
+    size_t uploaded = 0;
+    while (uploaded < settings.uploadBudget && !uploadQueue.empty())
+    {
+        Entry *entry = uploadQueue.front();
+        if (entry->state == State::Failed)
+        {
+            setPixel(entry->texture, failedColor);
+            uploadQueue.pop_front();
+            continue;
+        }
+        if (entry->state == State::Decoded)
+        {
+            beginUpload(*entry);
+            entry->state = State::Uploading;
+        }
+
+        // workers don't touch the entries in the upload queue,
+        // so copying the pixels doesn't need to block them
+        lock.unlock();
+        size_t bytes = uploadRows(*entry, settings.uploadBudget - uploaded);
+        lock.lock();
+        if (bytes == 0) { break; }
+        uploaded += bytes;
+
+        if (entry->uploadedRows == entry->height)
+        {
+            glBindTexture(GL_TEXTURE_2D, entry->texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            entry->image = DecodedImage();
+            entry->state = State::Resident;
+            uploadQueue.pop_front();
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    uploadedLastFrame = uploaded;
+
+    // the ones used in this frame stay, even if that is over the budget
+    uint64_t currentFrame = frame.load(std::memory_order_relaxed);
+    while (residentBytes > settings.memoryBudget)
+    {
+        Entry *oldest = NULL;
+        for (auto &item : entries)
+        {
+            Entry *entry = item.second.get();
+            if (
+                entry->state == State::Resident
+                && entry->lastUsedFrame < currentFrame
+                && (oldest == NULL || entry->lastUsedFrame < oldest->lastUsedFrame)
+            )
+            {
+                oldest = entry;
+            }
+        }
+        if (oldest == NULL) { break; }
+        evict(*oldest);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+TextureStreamerStatistics TextureStreamer::statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TextureStreamerStatistics result;
+    for (auto &item : entries)
+    {
+        result.textures++;
+        switch (item.second->state)
+        {
+        case State::Queued:
+        case State::Decoding:
+        case State::Decoded:
+            result.decoding++;
+            break;
+        case State::Uploading:
+            result.uploading++;
+            break;
+        case State::Resident:
+            result.resident++;
+            break;
+        case State::Evicted:
+            result.evicted++;
+            break;
+        case State::Failed:
+            result.failed++;
+            break;
+        }
+    }
+    result.residentBytes = residentBytes;
+    result.uploadedLastFrame = uploadedLastFrame;
+    result.evictions = evictionsCount;
+    return result;
+}
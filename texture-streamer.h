@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <dearimgui/imgui.h>
+
+#include "stream-buffer.h"
+#include "image-decoder.h"
+
+struct TextureStreamerSettings
+{
+    // decoding threads, 0 is half of the cores
+    int workers = 0;
+    // textures that were not used for the longest time are evicted above that
+    size_t memoryBudget = 256 * 1024 * 1024;
+    // pixel data uploaded per frame at most (at least one chunk is uploaded)
+    size_t uploadBudget = 8 * 1024 * 1024;
+    // size of a pixel buffer in the ring, uploads go in chunks of that size
+    size_t pixelBufferSize = 4 * 1024 * 1024;
+};
+
+struct TextureStreamerStatistics
+{
+    int textures = 0;
+    int resident = 0;
+    int decoding = 0;
+    int uploading = 0;
+    int evicted = 0;
+    int failed = 0;
+    // GPU memory of resident textures and of the ones being uploaded
+    size_t residentBytes = 0;
+    size_t uploadedLastFrame = 0;
+    uint64_t evictions = 0;
+};
+
+// Loads images in the background and streams them into textures.
+// Images are decoded by a pool of worker threads, pixel data is uploaded
+// through a ring of pixel buffer objects (StreamBuffer) with a budget
+// per frame, and textures that were not used for the longest time are
+// evicted once they take more memory than the budget.
+// texture() gives a texture ID right away, which shows a placeholder until
+// the image is completely uploaded: while uploading, only its smallest
+// mip level (one pixel of the placeholder color) is visible
+class TextureStreamer
+{
+public:
+    TextureStreamer() = default;
+    ~TextureStreamer();
+    TextureStreamer(TextureStreamer const &) = delete;
+    TextureStreamer &operator=(TextureStreamer const &) = delete;
+
+    // GL thread
+    bool initialize(TextureStreamerSettings const &settings);
+    void shutdown();
+    bool initialized() const { return placeholder != 0; }
+
+    // any thread (the UI one), requests the image if it's not there yet
+    // and marks it as used in this frame; from the next update() on the ID
+    // is the same every time, even after the texture is evicted
+    ImTextureID texture(std::string const &path);
+    // the size of the image, if it's already decoded
+    bool imageSize(std::string const &path, int &width, int &height);
+
+    // GL thread, once per frame: gives textures to new requests,
+    // uploads within the budget and evicts over the memory budget
+    void update();
+
+    TextureStreamerStatistics statistics();
+
+private:
+    enum class State
+    {
+        Queued,
+        Decoding,
+        Decoded,
+        Uploading,
+        Resident,
+        Evicted,
+        Failed
+    };
+
+    struct Entry
+    {
+        std::string path;
+        State state = State::Queued;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        // decoded pixels, only until they are uploaded
+        DecodedImage image;
+        int uploadedRows = 0;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    TextureStreamerSettings settings;
+    GLuint placeholder = 0;
+    StreamBuffer pixelBuffers;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    std::deque<Entry *> decodeQueue;
+    // decoded, in the order they are uploaded
+    std::deque<Entry *> uploadQueue;
+    // texture names created in advance, so requests from other threads get one right away
+    std::vector<GLuint> spareTextures;
+    std::vector<Entry *> waitingForTexture;
+    std::atomic<uint64_t> frame{1};
+
+    size_t residentBytes = 0;
+    size_t uploadedLastFrame = 0;
+    uint64_t evictionsCount = 0;
+
+    void workerLoop();
+    GLuint createPlaceholderTexture();
+    void beginUpload(Entry &entry);
+    // returns the bytes uploaded, 0 if the pixel buffer couldn't be mapped
+    size_t uploadRows(Entry &entry, size_t budget);
+    void evict(Entry &entry);
+};
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "time-series.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TIME_SERIES_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TIME_SERIES_NEON
+#endif
+
+namespace
+{
+    // adds min/max of n entries to min/max
+    void minMaxSpan(const float *mins, const float *maxs, size_t n, float &min, float &max)
+    {
+        size_t i = 0;
+#if defined(TIME_SERIES_SSE)
+        if (n >= 8)
+        {
+            __m128 min0 = _mm_loadu_ps(mins),
+                   min1 = _mm_loadu_ps(mins + 4),
+                   max0 = _mm_loadu_ps(maxs),
+                   max1 = _mm_loadu_ps(maxs + 4);
+            for (i = 8; i + 8 <= n; i += 8)
+            {
+                min0 = _mm_min_ps(min0, _mm_loadu_ps(mins + i));
+                min1 = _mm_min_ps(min1, _mm_loadu_ps(mins + i + 4));
+                max0 = _mm_max_ps(max0, _mm_loadu_ps(maxs + i));
+                max1 = _mm_max_ps(max1, _mm_loadu_ps(maxs + i + 4));
+            }
+            __m128 vmin = _mm_min_ps(min0, min1),
+                   vmax = _mm_max_ps(max0, max1);
+            vmin = _mm_min_ps(vmin, _mm_movehl_ps(vmin, vmin));
+            vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+            vmin = _mm_min_ss(vmin, _mm_shuffle_ps(vmin, vmin, 1));
+            vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 1));
+            min = std::min(min, _mm_cvtss_f32(vmin));
+            max = std::max(max, _mm_cvtss_f32(vmax));
+        }
+#elif defined(TIME_SERIES_NEON)
+        if (n >= 8)
+        {
+            float32x4_t min0 = vld1q_f32(mins),
+                        min1 = vld1q_f32(mins + 4),
+                        max0 = vld1q_f32(maxs),
+                        max1 = vld1q_f32(maxs + 4);
+            for (i = 8; i + 8 <= n; i += 8)
+            {
+                min0 = vminq_f32(min0, vld1q_f32(mins + i));
+                min1 = vminq_f32(min1, vld1q_f32(mins + i + 4));
+                max0 = vmaxq_f32(max0, vld1q_f32(maxs + i));
+                max1 = vmaxq_f32(max1, vld1q_f32(maxs + i + 4));
+            }
+            float32x4_t vmin = vminq_f32(min0, min1),
+                        vmax = vmaxq_f32(max0, max1);
+            float32x2_t pairMin = vpmin_f32(vget_low_f32(vmin), vget_high_f32(vmin)),
+                        pairMax = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+            min = std::min(min, vget_lane_f32(vpmin_f32(pairMin, pairMin), 0));
+            max = std::max(max, vget_lane_f32(vpmax_f32(pairMax, pairMax), 0));
+        }
+#endif
+        for (; i < n; i++)
+        {
+            min = std::min(min, mins[i]);
+            max = std::max(max, maxs[i]);
+        }
+    }
+
+    // min/max of every block of 8 entries
+    void reduceBlocks(const float *mins, const float *maxs, size_t blocks, float *outMins, float *outMaxs)
+    {
+        size_t b = 0;
+#if defined(TIME_SERIES_SSE)
+        // 4 blocks at a time: each is folded into one vector, and after
+        // transposing, lane j of the folded vectors holds block j
+        for (; b + 4 <= blocks; b += 4)
+        {
+            const float *blockMins = mins + b * 8,
+                        *blockMaxs = maxs + b * 8;
+            __m128 min0 = _mm_min_ps(_mm_loadu_ps(blockMins), _mm_loadu_ps(blockMins + 4)),
+                   min1 = _mm_min_ps(_mm_loadu_ps(blockMins + 8), _mm_loadu_ps(blockMins + 12)),
+                   min2 = _mm_min_ps(_mm_loadu_ps(blockMins + 16), _mm_loadu_ps(blockMins + 20)),
+                   min3 = _mm_min_ps(_mm_loadu_ps(blockMins + 24), _mm_loadu_ps(blockMins + 28));
+            __m128 max0 = _mm_max_ps(_mm_loadu_ps(blockMaxs), _mm_loadu_ps(blockMaxs + 4)),
+                   max1 = _mm_max_ps(_mm_loadu_ps(blockMaxs + 8), _mm_loadu_ps(blockMaxs + 12)),
+                   max2 = _mm_max_ps(_mm_loadu_ps(blockMaxs + 16), _mm_loadu_ps(blockMaxs + 20)),
+                   max3 = _mm_max_ps(_mm_loadu_ps(blockMaxs + 24), _mm_loadu_ps(blockMaxs + 28));
+            _MM_TRANSPOSE4_PS(min0, min1, min2, min3);
+            _MM_TRANSPOSE4_PS(max0, max1, max2, max3);
+            _mm_storeu_ps(outMins + b, _mm_min_ps(_mm_min_ps(min0, min1), _mm_min_ps(min2, min3)));
+            _mm_storeu_ps(outMaxs + b, _mm_max_ps(_mm_max_ps(max0, max1), _mm_max_ps(max2, max3)));
+        }
+#endif
+        for (; b < blocks; b++)
+        {
+            float min = std::numeric_limits<float>::max(),
+                  max = std::numeric_limits<float>::lowest();
+            minMaxSpan(mins + b * 8, maxs + b * 8, 8, min, max);
+            outMins[b] = min;
+            outMaxs[b] = max;
+        }
+    }
+}
+
+TimeSeriesRing::TimeSeriesRing(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity) { size <<= 1; }
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+}
+
+void TimeSeriesRing::push(float value)
+{
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[index & mask];
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+size_t TimeSeriesRing::drain(std::vector<float> &samples)
+{
+    size_t drained = 0;
+    // only what is there already, otherwise fast producers could keep it here forever
+    uint64_t end = writeIndex.load(std::memory_order_relaxed);
+    while (readIndex < end)
+    {
+        Slot &slot = slots[readIndex & mask];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == readIndex + 1)
+        {
+            float value = slot.value.load(std::memory_order_relaxed);
+            // a producer that has lapped the consumer could have overwritten it meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                samples.push_back(value);
+                drained++;
+                readIndex++;
+                continue;
+            }
+        }
+        else if (sequence <= readIndex)
+        {
+            // not written yet (or still being written)
+            break;
+        }
+
+        // overwritten, skipping to the oldest sample that is still there
+        uint64_t oldest = writeIndex.load(std::memory_order_relaxed) - mask;
+        uint64_t skipped = oldest > readIndex ? oldest - readIndex : 1;
+        droppedCount.fetch_add(skipped, std::memory_order_relaxed);
+        readIndex += skipped;
+    }
+    return drained;
+}
+
+void MinMaxPyramid::append(const float *values, size_t count)
+{
+    while (count > 0)
+    {
+        if (chunks.empty() || chunks.back()->samples.size() == chunkSize)
+        {
+            std::unique_ptr<Chunk> chunk = std::move(spareChunk);
+            if (chunk == NULL)
+            {
+                chunk.reset(new Chunk());
+                chunk->samples.reserve(chunkSize);
+            }
+            chunks.push_back(std::move(chunk));
+            chunkMins.push_back(std::numeric_limits<float>::max());
+            chunkMaxs.push_back(std::numeric_limits<float>::lowest());
+        }
+
+        Chunk &chunk = *chunks.back();
+        size_t taken = std::min(count, chunkSize - chunk.samples.size());
+        chunk.samples.insert(chunk.samples.end(), values, values + taken);
+        chunk.updateLevels();
+        minMaxSpan(values, values, taken, chunkMins.back(), chunkMaxs.back());
+
+        samplesCount += taken;
+        values += taken;
+        count -= taken;
+    }
+}
+
+void MinMaxPyramid::clear()
+{
+    chunks.clear();
+    chunkMins.clear();
+    chunkMaxs.clear();
+    samplesCount = 0;
+}
+
+size_t MinMaxPyramid::dropOldest(size_t count)
+{
+    if (chunks.empty()) { return 0; }
+
+    size_t dropChunks = std::min((count + chunkSize - 1) / chunkSize, chunks.size() - 1);
+    for (size_t c = 0; c < dropChunks; c++)
+    {
+        spareChunk = std::move(chunks.front());
+        chunks.pop_front();
+        // keeping the memory of the vectors
+        spareChunk->samples.clear();
+        for (Level &level : spareChunk->levels)
+        {
+            level.mins.clear();
+            level.maxs.clear();
+        }
+    }
+    chunkMins.erase(chunkMins.begin(), chunkMins.begin() + dropChunks);
+    chunkMaxs.erase(chunkMaxs.begin(), chunkMaxs.begin() + dropChunks);
+    // only complete chunks are dropped
+    samplesCount -= dropChunks * chunkSize;
+    return dropChunks * chunkSize;
+}
+
+void MinMaxPyramid::Chunk::updateLevels()
+{
+    const float *belowMins = samples.data(),
+                *belowMaxs = samples.data();
+    size_t belowCount = samples.size();
+    for (size_t l = 0; belowCount >= blockSize; l++)
+    {
+        if (l == levels.size()) { levels.emplace_back(); }
+        Level &level = levels[l];
+
+        // only new complete blocks
+        size_t done = level.mins.size(),
+               blocks = belowCount / blockSize;
+        level.mins.resize(blocks);
+        level.maxs.resize(blocks);
+        reduceBlocks(
+            belowMins + done * blockSize,
+            belowMaxs + done * blockSize,
+            blocks - done,
+            level.mins.data() + done,
+            level.maxs.data() + done
+        );
+
+        belowMins = level.mins.data();
+        belowMaxs = level.maxs.data();
+        belowCount = blocks;
+    }
+}
+
+void MinMaxPyramid::Chunk::rangeMinMax(size_t first, size_t last, float &min, float &max) const
+{
+    const float *mins = samples.data(),
+                *maxs = samples.data();
+    for (size_t l = 0;; l++)
+    {
+        // blocks of the level above that are completely within the range
+        size_t firstBlock = (first + blockSize - 1) / blockSize,
+               lastBlock = last / blockSize;
+        if (l == levels.size() || firstBlock >= lastBlock)
+        {
+            minMaxSpan(mins + first, maxs + first, last - first, min, max);
+            return;
+        }
+
+        // the ends of the range that don't make a whole block
+        minMaxSpan(mins + first, maxs + first, firstBlock * blockSize - first, min, max);
+        minMaxSpan(mins + lastBlock * blockSize, maxs + lastBlock * blockSize, last - lastBlock * blockSize, min, max);
+
+        first = firstBlock;
+        last = lastBlock;
+        mins = levels[l].mins.data();
+        maxs = levels[l].maxs.data();
+    }
+}
+
+void MinMaxPyramid::rangeMinMax(size_t first, size_t last, float &min, float &max) const
+{
+    min = std::numeric_limits<float>::max();
+    max = std::numeric_limits<float>::lowest();
+
+    size_t firstChunk = first / chunkSize,
+           lastChunk = (last - 1) / chunkSize;
+    if (firstChunk == lastChunk)
+    {
+        chunks[firstChunk]->rangeMinMax(first % chunkSize, last - firstChunk * chunkSize, min, max);
+        return;
+    }
+
+    // the chunks in between are covered completely
+    chunks[firstChunk]->rangeMinMax(first % chunkSize, chunkSize, min, max);
+    minMaxSpan(
+        chunkMins.data() + firstChunk + 1,
+        chunkMaxs.data() + firstChunk + 1,
+        lastChunk - firstChunk - 1,
+        min,
+        max
+    );
+    chunks[lastChunk]->rangeMinMax(0, last - lastChunk * chunkSize, min, max);
+}
+
+void MinMaxPyramid::decimate(double first, double last, int columns, float *mins, float *maxs) const
+{
+    double samplesPerColumn = (last - first) / columns;
+    for (int c = 0; c < columns; c++)
+    {
+        // neighbouring columns share the sample on their border, so the line has no gaps
+        double from = std::max(0.0, std::floor(first + c * samplesPerColumn)),
+               to = std::min(static_cast<double>(samplesCount), std::ceil(first + (c + 1) * samplesPerColumn));
+        if (from >= to)
+        {
+            mins[c] = maxs[c] = std::numeric_limits<float>::quiet_NaN();
+            continue;
+        }
+        rangeMinMax(static_cast<size_t>(from), static_cast<size_t>(to), mins[c], maxs[c]);
+    }
+}
+
+TimeSeries::TimeSeries(size_t ringCapacity, size_t maxSamples)
+    : ring(ringCapacity), limit(maxSamples)
+{
+}
+
+size_t TimeSeries::update()
+{
+    drained.clear();
+    size_t count = ring.drain(drained);
+    if (count == 0) { return 0; }
+
+    pyramid.append(drained.data(), drained.size());
+    total += count;
+    // whole chunks of the oldest samples, so it's cheap even though it happens often
+    if (pyramid.size() > limit) { pyramid.dropOldest(pyramid.size() - limit); }
+    return count;
+}
+
+void TimeSeries::clear()
+{
+    drained.clear();
+    ring.drain(drained);
+    pyramid.clear();
+    total = 0;
+}
+
+void TimeSeriesPlot::draw(const char *label, TimeSeries const &series, ImVec2 size, ImU32 color)
+{
+    if (size.x <= 0.0f) { size.x = std::max(ImGui::GetContentRegionAvail().x, 1.0f); }
+    if (size.y <= 0.0f) { size.y = ImGui::GetTextLineHeight() * 6.0f; }
+    ImVec2 topLeft = ImGui::GetCursorScreenPos();
+    ImVec2 bottomRight = ImVec2(topLeft.x + size.x, topLeft.y + size.y);
+    ImGui::InvisibleButton(label, size);
+    bool hovered = ImGui::IsItemHovered();
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(topLeft, bottomRight, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+    MinMaxPyramid const &history = series.history();
+    double count = static_cast<double>(history.size());
+    int columns = static_cast<int>(size.x);
+    if (history.size() < 2 || columns < 1)
+    {
+        drawList->AddText(ImVec2(topLeft.x + 4.0f, topLeft.y + 2.0f), ImGui::GetColorU32(ImGuiCol_Text), label);
+        return;
+    }
+
+    // zooming keeps the sample under the cursor in place
+    const double minimumVisible = 8.0;
+    double visible = visibleSamples > 0.0 ? std::min(visibleSamples, count) : count;
+    if (followLatest) { firstSample = count - visible; }
+    ImGuiIO &io = ImGui::GetIO();
+    if (hovered && io.MouseWheel != 0.0f)
+    {
+        double anchor = (io.MousePos.x - topLeft.x) / size.x;
+        double anchorSample = firstSample + anchor * visible;
+        visible = std::max(std::min(visible * std::pow(0.8, io.MouseWheel), count), std::min(minimumVisible, count));
+        visibleSamples = visible;
+        firstSample = anchorSample - anchor * visible;
+        followLatest = false;
+    }
+    if (ImGui::IsItemActive() && io.MouseDelta.x != 0.0f)
+    {
+        firstSample -= io.MouseDelta.x * visible / size.x;
+        followLatest = false;
+    }
+    if (hovered && ImGui::IsMouseDoubleClicked(0))
+    {
+        visibleSamples = 0.0;
+        visible = count;
+        followLatest = true;
+    }
+    firstSample = std::max(0.0, std::min(firstSample, count - visible));
+    // scrolled to the end, so new samples keep it moving
+    if (firstSample >= count - visible) { followLatest = true; }
+
+    columnMins.resize(columns);
+    columnMaxs.resize(columns);
+    history.decimate(firstSample, firstSample + visible, columns, columnMins.data(), columnMaxs.data());
+
+    float low = std::numeric_limits<float>::max(),
+          high = std::numeric_limits<float>::lowest();
+    int validColumns = 0;
+    for (int c = 0; c < columns; c++)
+    {
+        if (std::isnan(columnMins[c])) { continue; }
+        low = std::min(low, columnMins[c]);
+        high = std::max(high, columnMaxs[c]);
+        validColumns++;
+    }
+    if (high - low < 1e-6f)
+    {
+        low -= 1.0f;
+        high += 1.0f;
+    }
+
+    // a vertex pair (column max and min) per pixel, neighbouring pairs make a band
+    drawList->PushClipRect(topLeft, bottomRight, true);
+    if (validColumns > 1)
+    {
+        if (color == 0) { color = ImGui::GetColorU32(ImGuiCol_PlotLines); }
+        ImVec2 uv = ImGui::GetFontTexUvWhitePixel();
+        float scale = (size.y - 2.0f) / (high - low);
+        drawList->PrimReserve((validColumns - 1) * 6, validColumns * 2);
+        bool firstPair = true;
+        for (int c = 0; c < columns; c++)
+        {
+            if (std::isnan(columnMins[c])) { continue; }
+            float x = topLeft.x + c + 0.5f,
+                  top = bottomRight.y - 1.0f - (columnMaxs[c] - low) * scale,
+                  bottom = bottomRight.y - 1.0f - (columnMins[c] - low) * scale;
+            // flat columns are still a pixel thick
+            if (bottom - top < 1.0f)
+            {
+                float middle = (top + bottom) * 0.5f;
+                top = middle - 0.5f;
+                bottom = middle + 0.5f;
+            }
+
+            ImDrawIdx index = static_cast<ImDrawIdx>(drawList->_VtxCurrentIdx);
+            drawList->PrimWriteVtx(ImVec2(x, top), uv, color);
+            drawList->PrimWriteVtx(ImVec2(x, bottom), uv, color);
+            if (!firstPair)
+            {
+                drawList->PrimWriteIdx(static_cast<ImDrawIdx>(index - 2));
+                drawList->PrimWriteIdx(static_cast<ImDrawIdx>(index - 1));
+                drawList->PrimWriteIdx(static_cast<ImDrawIdx>(index + 1));
+                drawList->PrimWriteIdx(static_cast<ImDrawIdx>(index - 2));
+                drawList->PrimWriteIdx(static_cast<ImDrawIdx>(index + 1));
+                drawList->PrimWriteIdx(index);
+            }
+            firstPair = false;
+        }
+    }
+
+    char overlay[128];
+    std::snprintf(
+        overlay,
+        sizeof(overlay),
+        "%s: %.3f [%.3f, %.3f], %.0f of %.0f samples",
+        label,
+        history.sample(history.size() - 1),
+        low,
+        high,
+        visible,
+        count
+    );
+    drawList->AddText(ImVec2(topLeft.x + 4.0f, topLeft.y + 2.0f), ImGui::GetColorU32(ImGuiCol_Text), overlay);
+    drawList->PopClipRect();
+
+    if (hovered)
+    {
+        int c = std::max(0, std::min(columns - 1, static_cast<int>(io.MousePos.x - topLeft.x)));
+        double sample = firstSample + (c + 0.5) * visible / columns;
+        if (!std::isnan(columnMins[c]))
+        {
+            ImGui::SetTooltip("sample %.0f\nmin %.4f\nmax %.4f", sample, columnMins[c], columnMaxs[c]);
+        }
+    }
+}
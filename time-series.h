@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include <dearimgui/imgui.h>
+
+// Lock-free multi-producer ring of samples: any thread can push without
+// waiting, and a single consumer drains them. If the consumer falls behind
+// by more than the capacity, the oldest samples are lost (and counted)
+class TimeSeriesRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit TimeSeriesRing(size_t capacity);
+
+    void push(float value);
+    // consumer only, appends everything available to samples
+    size_t drain(std::vector<float> &samples);
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        // index of the sample in the slot plus one, 0 means empty
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<float> value{0.0f};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> writeIndex{0};
+    alignas(64) uint64_t readIndex = 0;
+    std::atomic<uint64_t> droppedCount{0};
+};
+
+// Min/max pyramid over the samples: every level keeps min and max of blocks
+// of 8 entries of the level below, so min/max of any range takes a few
+// entries per level instead of going through all the samples.
+// Samples are stored in chunks with a pyramid of their own, so the oldest
+// ones are dropped a whole chunk at a time, without touching the rest
+class MinMaxPyramid
+{
+public:
+    static const size_t blockSize = 8;
+    // 8^5, so a complete chunk has a single entry on its top level
+    static const size_t chunkSize = 32768;
+
+    void append(const float *values, size_t count);
+    void clear();
+    // drops whole chunks of the oldest samples, enough to drop at least count of them,
+    // but never the chunk that is being filled, returns how many were dropped
+    size_t dropOldest(size_t count);
+
+    size_t size() const { return samplesCount; }
+    float sample(size_t index) const { return chunks[index / chunkSize]->samples[index % chunkSize]; }
+    // of the [first, last) range, which must not be empty
+    void rangeMinMax(size_t first, size_t last, float &min, float &max) const;
+    // min/max of every column for [first, last) range split into columns,
+    // columns without samples get NaN
+    void decimate(double first, double last, int columns, float *mins, float *maxs) const;
+
+private:
+    struct Level
+    {
+        std::vector<float> mins;
+        std::vector<float> maxs;
+    };
+
+    struct Chunk
+    {
+        std::vector<float> samples;
+        // levels[0] is built from samples
+        std::vector<Level> levels;
+
+        void updateLevels();
+        // adds min/max of the [first, last) range to min/max
+        void rangeMinMax(size_t first, size_t last, float &min, float &max) const;
+    };
+
+    std::deque<std::unique_ptr<Chunk>> chunks;
+    // min/max of every chunk, for ranges that cover whole chunks
+    std::vector<float> chunkMins;
+    std::vector<float> chunkMaxs;
+    size_t samplesCount = 0;
+    // the last dropped chunk, reused with its memory for the next one
+    std::unique_ptr<Chunk> spareChunk;
+};
+
+// time series that producers push into from any thread,
+// and the UI thread moves them into the pyramid for plotting
+class TimeSeries
+{
+public:
+    explicit TimeSeries(size_t ringCapacity = 1 << 20, size_t maxSamples = 16 << 20);
+
+    // any thread
+    void push(float value) { ring.push(value); }
+    // UI thread, moves new samples from the ring to the pyramid
+    size_t update();
+    void clear();
+
+    MinMaxPyramid const &history() const { return pyramid; }
+    uint64_t totalSamples() const { return total; }
+    uint64_t dropped() const { return ring.dropped(); }
+
+private:
+    TimeSeriesRing ring;
+    MinMaxPyramid pyramid;
+    size_t limit;
+    uint64_t total = 0;
+    std::vector<float> drained;
+};
+
+// Plot of a time series drawn straight into the window's draw list, with one
+// vertex pair (column min and max) per horizontal pixel at any zoom level.
+// Wheel zooms, dragging pans, double click goes back to following the latest samples
+class TimeSeriesPlot
+{
+public:
+    // visible range in samples, 0 means all of them
+    double visibleSamples = 0.0;
+
+    void draw(const char *label, TimeSeries const &series, ImVec2 size, ImU32 color = 0);
+
+private:
+    // start of the visible range when not following the latest samples
+    double firstSample = 0.0;
+    bool followLatest = true;
+    std::vector<float> columnMins;
+    std::vector<float> columnMaxs;
+};